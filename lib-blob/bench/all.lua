@@ -0,0 +1,8 @@
+--Runs every lib-blob benchmark; an optional argument limits the run to cases whose name contains it.
+--	blobbench all.lua > baseline.jsonl
+require("readwrite")
+require("resize")
+require("copy")
+require("bits")
+require("numbers")
+require("utf8")
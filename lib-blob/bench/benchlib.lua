@@ -0,0 +1,105 @@
+--Shared harness for the lib-blob benchmark drivers; run them through blobbench, which provides the global 'bench' table.
+--Every case prints one JSON object per line, so runs can be diffed or loaded into a spreadsheet directly:
+--	{"bench":"write","fields":4,"size":64,"iters":65536,"ns_per_op":..,"bytes_per_s":..,"allocs_per_op":..,"blob_allocs_per_op":..}
+do
+	local blob = require("blob")
+	
+	local harness =
+	{
+		mintime = 50e6,		--each repeat runs for at least this many nanoseconds
+		repeats = 5,		--the fastest repeat is reported
+		filter = (arg and arg[1]) or nil	--only run cases whose name contains this
+	}
+	
+	local function jsonvalue(v)
+		if type(v) == "number" then
+			if v ~= v or v == math.huge or v == -math.huge then
+				return "null"
+			elseif v == math.floor(v) and math.abs(v) < 2^53 then
+				return string.format("%d", v)
+			else
+				return string.format("%.6g", v)
+			end
+		elseif type(v) == "boolean" then
+			return tostring(v)
+		else
+			return string.format("%q", tostring(v))
+		end
+	end
+	
+	local function emit(name, params, fields)
+		local keys = { }
+		for k in pairs(params) do
+			keys[#keys + 1] = k
+		end
+		table.sort(keys)
+		
+		local out = { string.format("\"bench\":%s", jsonvalue(name)) }
+		for _, k in ipairs(keys) do
+			out[#out + 1] = string.format("%q:%s", k, jsonvalue(params[k]))
+		end
+		for _, field in ipairs(fields) do
+			out[#out + 1] = string.format("%q:%s", field[1], jsonvalue(field[2]))
+		end
+		io.write("{", table.concat(out, ","), "}\n")
+		io.flush()
+	end
+	
+	local function allocs()
+		local a, r = bench.allocs()
+		return (a + r)
+	end
+	
+	--Runs fn(n), which must perform n operations, and reports per-operation figures; bytes is the payload one operation moves.
+	function harness.run(name, params, bytes, fn)
+		if harness.filter ~= nil and not string.find(name, harness.filter, 1, true) then
+			return
+		end
+		
+		--calibrate: double the iteration count until one repeat takes long enough to time reliably
+		local n = 1
+		while true do
+			local start = bench.now()
+			fn(n)
+			if (bench.now() - start) >= harness.mintime or n >= 2^30 then
+				break
+			end
+			n = (n * 2)
+		end
+		
+		local best, bestallocs, bestblob
+		for r = 1, harness.repeats do
+			collectgarbage()
+			local a0 = allocs()
+			local b0 = blob.stats().total.reallocs
+			local start = bench.now()
+			fn(n)
+			local elapsed = (bench.now() - start)
+			local a1 = allocs()
+			local b1 = blob.stats().total.reallocs
+			
+			if best == nil or elapsed < best then
+				best = elapsed
+				bestallocs = (a1 - a0)
+				bestblob = (b1 - b0)
+			end
+		end
+		
+		local nsperop = (best / n)
+		emit(name, params,
+		{
+			{ "iters", n },
+			{ "ns_per_op", nsperop },
+			{ "bytes_per_s", ((bytes > 0) and ((bytes * 1e9) / nsperop) or 0) },
+			{ "allocs_per_op", (bestallocs / n) },
+			{ "blob_allocs_per_op", (bestblob / n) }
+		})
+	end
+	
+	--Builds a string of exactly size bytes.
+	function harness.payload(size)
+		return string.rep("\90", size)
+	end
+	
+	return harness
+end
@@ -0,0 +1,37 @@
+--Bit field reads: random access, a bit cursor and bulk unpacking, across field widths.
+do
+	local blob = require("blob")
+	local harness = require("benchlib")
+	
+	local widths = { 3, 13, 32, 61 }
+	local count = 1024
+	
+	for _, width in ipairs(widths) do
+		local b = blob.new(16)
+		b:write(0, harness.payload(math.ceil((width * count) / 8)))
+		local bytes = ((width * count) / 8)
+		
+		harness.run("readbits", { width = width, fields = count }, bytes, function(n)
+			for i = 1, n do
+				local pos = 0
+				for k = 1, count do
+					b:readbits(pos, width)
+					pos = (pos + width)
+				end
+			end
+		end)
+		harness.run("bitcursor", { width = width, fields = count }, bytes, function(n)
+			for i = 1, n do
+				local cur = b:bitcursor()
+				for k = 1, count do
+					cur:read(width)
+				end
+			end
+		end)
+		harness.run("unpackbits", { width = width, fields = count }, bytes, function(n)
+			for i = 1, n do
+				b:unpackbits(0, width, count)
+			end
+		end)
+	end
+end
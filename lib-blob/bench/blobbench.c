@@ -0,0 +1,186 @@
+//blobbench is a standalone lua host for the lib-blob benchmark scripts in this directory.
+//lib-blob is linked in statically and preloaded as 'blob'; a global 'bench' table adds a monotonic clock and a count of lua_Alloc calls.
+//
+//Build against lua 5.2, e.g.:
+//	cc -O2 -I<lua include> -I.. blobbench.c ../luablob.c ../blobsearch.c ../blobcompress.c ../blobencode.c ../blobbits.c ../blobnumber.c ../blobutf8.c -llua -lm -o blobbench
+//Run from this directory:
+//	blobbench all.lua [filter]
+//The behaviour tests in ../test run through the same host, e.g. ../bench/blobbench all.lua from that directory.
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "luablob.h"
+
+#if defined(_WIN32)
+	#include <windows.h>
+#else
+	#include <time.h>
+#endif
+
+#ifdef MSVC_VER
+	#define LUA_CFUNCTION_F int __cdecl
+#else
+	#define LUA_CFUNCTION_F int
+#endif
+
+typedef struct blobbench_allocstats_s
+{
+	size_t allocs;		//calls that obtained a new block
+	size_t reallocs;	//calls that resized an existing block
+	size_t frees;
+} blobbench_allocstats;
+
+void *blobbench_alloc(void *ud, void *ptr, size_t osize, size_t nsize)
+{
+	blobbench_allocstats *stats;
+
+	stats = (blobbench_allocstats *)ud;
+	if (nsize == 0)
+	{
+		if (ptr != NULL)
+		{
+			++(stats->frees);
+		}
+		free(ptr);
+		return NULL;
+	}
+
+	if (ptr == NULL)
+	{
+		++(stats->allocs);
+	}
+	else if (nsize != osize)
+	{
+		++(stats->reallocs);
+	}
+	return realloc(ptr, nsize);
+}
+
+LUA_CFUNCTION_F lua_bench_now(lua_State *L)
+{	//STACK: ?
+#if defined(_WIN32)
+	LARGE_INTEGER freq;
+	LARGE_INTEGER now;
+
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+	lua_pushnumber(L, (((lua_Number)now.QuadPart) * 1e9) / ((lua_Number)freq.QuadPart));
+#else
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	lua_pushnumber(L, (((lua_Number)now.tv_sec) * 1e9) + ((lua_Number)now.tv_nsec));
+#endif
+
+	return 1;	//RETURN: nanoseconds
+}
+
+LUA_CFUNCTION_F lua_bench_allocs(lua_State *L)
+{	//STACK: ?
+	blobbench_allocstats *stats;
+
+	lua_getallocf(L, (void **)&stats);
+	lua_pushnumber(L, (lua_Number)stats->allocs);	//STACK: ? allocs
+	lua_pushnumber(L, (lua_Number)stats->reallocs);	//STACK: ? allocs reallocs
+	lua_pushnumber(L, (lua_Number)stats->frees);	//STACK: ? allocs reallocs frees
+
+	return 3;	//RETURN: allocs reallocs frees
+}
+
+LUA_CFUNCTION_F lua_bench_traceback(lua_State *L)
+{	//STACK: msg
+	luaL_traceback(L, L, lua_tostring(L, 1), 1);	//STACK: msg traceback
+
+	return 1;	//RETURN: traceback
+}
+
+const luaL_Reg blobbench_funcs[] =
+{
+	{"now", &lua_bench_now},
+	{"allocs", &lua_bench_allocs},
+	{NULL, NULL}
+};
+
+int main(int argc, char **argv)
+{
+	blobbench_allocstats stats;
+	lua_State *L;
+	const char *sep;
+	int result;
+	int i;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s script.lua [args...]\n", argv[0]);
+		return 2;
+	}
+
+	memset(&stats, 0, sizeof(stats));
+	L = lua_newstate(&blobbench_alloc, &stats);
+	if (L == NULL)
+	{
+		fprintf(stderr, "unable to create lua state\n");
+		return 1;
+	}
+	luaL_openlibs(L);
+
+	lua_getglobal(L, "package");				//STACK: package
+	lua_getfield(L, -1, "preload");				//STACK: package preload
+	lua_pushcfunction(L, &luaopen_blob);		//STACK: package preload luaopen_blob
+	lua_setfield(L, -2, "blob");				//STACK: package preload
+	lua_pop(L, 1);								//STACK: package
+
+	//let the drivers require the harness from the directory the script lives in
+	sep = strrchr(argv[1], '/');
+	if (sep == NULL)
+	{
+		sep = strrchr(argv[1], '\\');
+	}
+	if (sep != NULL)
+	{
+		lua_pushlstring(L, argv[1], (size_t)(sep - argv[1] + 1));	//STACK: package dir
+	}
+	else
+	{
+		lua_pushliteral(L, "./");				//STACK: package dir
+	}
+	lua_pushliteral(L, "?.lua;");				//STACK: package dir '?.lua;'
+	lua_getfield(L, -3, "path");				//STACK: package dir '?.lua;' path
+	lua_concat(L, 3);							//STACK: package path
+	lua_setfield(L, -2, "path");				//STACK: package
+	lua_pop(L, 1);								//STACK:
+
+	lua_newtable(L);							//STACK: bench
+	luaL_setfuncs(L, blobbench_funcs, 0);
+	lua_setglobal(L, "bench");					//STACK:
+
+	lua_createtable(L, (argc - 2), 1);			//STACK: arg
+	for (i = 1; i < argc; ++i)
+	{
+		lua_pushstring(L, argv[i]);				//STACK: arg argv[i]
+		lua_rawseti(L, -2, (i - 1));			//STACK: arg
+	}
+	lua_setglobal(L, "arg");					//STACK:
+
+	lua_pushcfunction(L, &lua_bench_traceback);	//STACK: traceback
+	result = luaL_loadfile(L, argv[1]);			//STACK: traceback chunk
+	if (result == LUA_OK)
+	{
+		for (i = 2; i < argc; ++i)
+		{
+			lua_pushstring(L, argv[i]);			//STACK: traceback chunk args...
+		}
+		result = lua_pcall(L, (argc - 2), 0, 1);	//STACK: traceback
+	}
+	if (result != LUA_OK)
+	{
+		fprintf(stderr, "%s\n", lua_tostring(L, -1));
+	}
+
+	lua_close(L);
+	return ((result == LUA_OK) ? 0 : 1);
+}
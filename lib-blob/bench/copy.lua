@@ -0,0 +1,44 @@
+--__tostring and blob-to-blob copies.
+do
+	local blob = require("blob")
+	local harness = require("benchlib")
+	
+	local sizes = { 16, 1024, 65536, 1048576 }
+	
+	for _, size in ipairs(sizes) do
+		local src = blob.new(16)
+		src:write(0, harness.payload(size))
+		local dest = blob.new(16)
+		dest:write(0, harness.payload(size))
+		
+		harness.run("tostring", { size = size }, size, function(n)
+			for i = 1, n do
+				tostring(src)
+			end
+		end)
+		
+		--write with a blob value; offset 1 keeps the destination from simply sharing the source's storage
+		local info = { type = "blob", value = src }
+		harness.run("copy", { size = size, via = "write" }, size, function(n)
+			for i = 1, n do
+				dest:write(1, info)
+			end
+		end)
+		
+		--read with a destination blob
+		local readinfo = { type = "blob", len = size, dest = dest }
+		harness.run("copy", { size = size, via = "read" }, size, function(n)
+			for i = 1, n do
+				src:read(0, readinfo)
+			end
+		end)
+		
+		--read into a fresh blob each time
+		local newinfo = { type = "blob", len = size }
+		harness.run("copy", { size = size, via = "readnew" }, size, function(n)
+			for i = 1, n do
+				src:read(0, newinfo)
+			end
+		end)
+	end
+end
@@ -0,0 +1,55 @@
+--Numeric text: parsing and formatting in place against the tostring, match and tonumber route they replace.
+do
+	local blob = require("blob")
+	local harness = require("benchlib")
+	
+	local samples = { 7, 4096, 1234567890, 18446744073709549568 }
+	local count = 256
+	
+	for _, value in ipairs(samples) do
+		local text = string.format("%.0f", value)
+		local line = blob.new(64)
+		line:write(0, text .. "\r\n")
+		local bytes = (#text * count)
+		
+		harness.run("parseint", { digits = #text, values = count }, bytes, function(n)
+			for i = 1, n do
+				for k = 1, count do
+					line:parseint(0)
+				end
+			end
+		end)
+		harness.run("parseint_match", { digits = #text, values = count }, bytes, function(n)
+			for i = 1, n do
+				for k = 1, count do
+					tonumber(tostring(line):match("%s*(%d+)%s*\r\n"))
+				end
+			end
+		end)
+		harness.run("writeint", { digits = #text, values = count }, bytes, function(n)
+			for i = 1, n do
+				for k = 1, count do
+					line:writeint(0, value)
+				end
+			end
+		end)
+	end
+	
+	local b = blob.new(64)
+	local text = "-12345.6789e-3"
+	b:write(0, text)
+	harness.run("parsenum", { chars = #text, values = count }, (#text * count), function(n)
+		for i = 1, n do
+			for k = 1, count do
+				b:parsenum(0)
+			end
+		end
+	end)
+	harness.run("writenum", { chars = #text, values = count }, (#text * count), function(n)
+		for i = 1, n do
+			for k = 1, count do
+				b:writenum(0, -12.3456789)
+			end
+		end
+	end)
+end
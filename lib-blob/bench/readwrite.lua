@@ -0,0 +1,66 @@
+--lua_blob_read, lua_blob_write and cursors over a grid of field counts and payload sizes.
+do
+	local blob = require("blob")
+	local harness = require("benchlib")
+	local unpack = table.unpack
+	
+	local fieldcounts = { 1, 4, 16, 64 }
+	local sizes = { 16, 256, 4096, 65536 }
+	
+	for _, fields in ipairs(fieldcounts) do
+		--fixed width scalars; the payload is the field itself
+		local writeargs = { 0 }
+		local readargs = { 0 }
+		for i = 1, fields do
+			writeargs[#writeargs + 1] = { type = "u32", value = i }
+			readargs[#readargs + 1] = "u32"
+		end
+		
+		local b = blob.new(16)
+		b:write(unpack(writeargs))
+		
+		harness.run("write", { fields = fields, size = 4, type = "u32" }, (fields * 4), function(n)
+			for i = 1, n do
+				b:write(unpack(writeargs))
+			end
+		end)
+		harness.run("read", { fields = fields, size = 4, type = "u32" }, (fields * 4), function(n)
+			for i = 1, n do
+				b:read(unpack(readargs))
+			end
+		end)
+		harness.run("cursor", { fields = fields, size = 4, type = "u32" }, (fields * 4), function(n)
+			for i = 1, n do
+				local cur = b:cursor()
+				for k = 1, fields do
+					cur:u32()
+				end
+			end
+		end)
+		
+		--strings
+		for _, size in ipairs(sizes) do
+			local payload = harness.payload(size)
+			writeargs = { 0 }
+			readargs = { 0 }
+			for i = 1, fields do
+				writeargs[#writeargs + 1] = payload
+				readargs[#readargs + 1] = { type = "str", len = size }
+			end
+			
+			b = blob.new(16)
+			b:write(unpack(writeargs))
+			
+			harness.run("write", { fields = fields, size = size, type = "str" }, (fields * size), function(n)
+				for i = 1, n do
+					b:write(unpack(writeargs))
+				end
+			end)
+			harness.run("read", { fields = fields, size = size, type = "str" }, (fields * size), function(n)
+				for i = 1, n do
+					b:read(unpack(readargs))
+				end
+			end)
+		end
+	end
+end
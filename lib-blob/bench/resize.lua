@@ -0,0 +1,35 @@
+--gmb_resize under each allocation mode: growing a fresh blob to its final size in fixed steps, zero-filled and uninitialized.
+do
+	local blob = require("blob")
+	local harness = require("benchlib")
+	
+	local modes = { "basic", "tight", "loose", "geometric", "pool", "aligned", "hugepage" }
+	local sizes = { 4096, 65536, 1048576, 8388608 }
+	local steps = 64
+	local raw = { uninitialized = true }
+	
+	for _, mode in ipairs(modes) do
+		for _, size in ipairs(sizes) do
+			local step = (size / steps)
+			
+			harness.run("resize", { mode = mode, size = size, steps = steps, zero = true }, size, function(n)
+				for i = 1, n do
+					local b = blob.new(16, mode)
+					for k = 1, steps do
+						b:resize(k * step)
+					end
+					b:free()
+				end
+			end)
+			harness.run("resize", { mode = mode, size = size, steps = steps, zero = false }, size, function(n)
+				for i = 1, n do
+					local b = blob.new(16, mode)
+					for k = 1, steps do
+						b:resize((k * step), raw)
+					end
+					b:free()
+				end
+			end)
+		end
+	end
+end
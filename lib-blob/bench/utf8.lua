@@ -0,0 +1,33 @@
+--UTF-8 validation and UTF-16LE transcoding over ASCII, mostly Latin and CJK text.
+do
+	local blob = require("blob")
+	local harness = require("benchlib")
+	
+	local texts = { ascii = "payload ", latin = "na\xc3\xafve caf\xc3\xa9 ", cjk = "\xe6\x96\x87\xe5\xad\x97\xe5\x88\x97 " }
+	local size = 65536
+	
+	for _, kind in ipairs({ "ascii", "latin", "cjk" }) do
+		local text = string.rep(texts[kind], math.ceil(size / #texts[kind]))
+		text = text:sub(1, (#text - (#text % #texts[kind])))
+		local src = blob.new(16)
+		src:write(0, text)
+		local wide = src:utf16le()
+		local dest = blob.new(16)
+		
+		harness.run("isutf8", { text = kind, size = #src }, #src, function(n)
+			for i = 1, n do
+				src:isutf8()
+			end
+		end)
+		harness.run("utf16le", { text = kind, size = #src }, #src, function(n)
+			for i = 1, n do
+				src:utf16le(dest, 0)
+			end
+		end)
+		harness.run("fromutf16le", { text = kind, size = #wide }, #wide, function(n)
+			for i = 1, n do
+				blob.fromutf16le(wide, dest, 0)
+			end
+		end)
+	end
+end
@@ -0,0 +1,281 @@
+//Bit field access; whole 64-bit words where the field and the data allow it, a byte at a time at the edges.
+
+#include "blobbits.h"
+
+#define blobbits_mask(width) (((width) >= 64) ? ~((uint64_t)0) : ((((uint64_t)1) << (width)) - 1))
+
+//Written byte by byte so that it is endian neutral; compilers fold these into a single (byte swapped) load or store.
+static uint64_t blobbits_loadle(const unsigned char *p)
+{
+	return ((uint64_t)p[0]) | (((uint64_t)p[1]) << 8) | (((uint64_t)p[2]) << 16) | (((uint64_t)p[3]) << 24) |
+		(((uint64_t)p[4]) << 32) | (((uint64_t)p[5]) << 40) | (((uint64_t)p[6]) << 48) | (((uint64_t)p[7]) << 56);
+}
+static uint64_t blobbits_loadbe(const unsigned char *p)
+{
+	return (((uint64_t)p[0]) << 56) | (((uint64_t)p[1]) << 48) | (((uint64_t)p[2]) << 40) | (((uint64_t)p[3]) << 32) |
+		(((uint64_t)p[4]) << 24) | (((uint64_t)p[5]) << 16) | (((uint64_t)p[6]) << 8) | ((uint64_t)p[7]);
+}
+static void blobbits_storele(unsigned char *p, uint64_t v)
+{
+	int i;
+
+	for (i = 0; i < 8; ++i)
+	{
+		p[i] = (unsigned char)(v >> (i * 8));
+	}
+}
+static void blobbits_storebe(unsigned char *p, uint64_t v)
+{
+	int i;
+
+	for (i = 0; i < 8; ++i)
+	{
+		p[i] = (unsigned char)(v >> (56 - (i * 8)));
+	}
+}
+
+int blobbits_inbounds(size_t len, size_t bitpos, size_t nbits)
+{
+	size_t byte = (bitpos >> 3);
+	size_t rem;
+
+	if (byte > len)
+	{
+		return 0;
+	}
+	rem = (len - byte);
+	if (rem > (((size_t)-1) >> 3))
+	{
+		return 1;
+	}
+
+	return ((rem << 3) >= (bitpos & 7)) && (nbits <= ((rem << 3) - (bitpos & 7)));
+}
+
+uint64_t blobbits_read(const void *data, size_t len, size_t bitpos, int width, int order)
+{
+	const unsigned char *p = (const unsigned char *)data;
+	size_t byte = (bitpos >> 3);
+	int shift = (int)(bitpos & 7);
+	uint64_t v;
+	int got;
+	int take;
+	int off;
+
+	if ((shift + width) <= 64 && (len - byte) >= 8)
+	{
+		if (order == BLOBBITS_LSB)
+		{
+			return ((blobbits_loadle(p + byte) >> shift) & blobbits_mask(width));
+		}
+		return ((blobbits_loadbe(p + byte) << shift) >> (64 - width));
+	}
+
+	v = 0;
+	for (got = 0; got < width; got += take)
+	{
+		byte = (bitpos >> 3);
+		off = (int)(bitpos & 7);
+		take = (((8 - off) < (width - got)) ? (8 - off) : (width - got));
+		if (order == BLOBBITS_LSB)
+		{
+			v |= (((uint64_t)((p[byte] >> off) & blobbits_mask(take))) << got);
+		}
+		else
+		{
+			v = ((v << take) | ((p[byte] >> (8 - off - take)) & blobbits_mask(take)));
+		}
+		bitpos += take;
+	}
+
+	return v;
+}
+
+void blobbits_write(void *data, size_t len, size_t bitpos, int width, uint64_t value, int order)
+{
+	unsigned char *p = (unsigned char *)data;
+	size_t byte = (bitpos >> 3);
+	int shift = (int)(bitpos & 7);
+	uint64_t m;
+	uint64_t w;
+	int got;
+	int take;
+	int off;
+	int lo;
+
+	value &= blobbits_mask(width);
+	if ((shift + width) <= 64 && (len - byte) >= 8)
+	{
+		if (order == BLOBBITS_LSB)
+		{
+			m = (blobbits_mask(width) << shift);
+			w = blobbits_loadle(p + byte);
+			blobbits_storele((p + byte), ((w & ~m) | (value << shift)));
+		}
+		else
+		{
+			lo = (64 - shift - width);
+			m = (blobbits_mask(width) << lo);
+			w = blobbits_loadbe(p + byte);
+			blobbits_storebe((p + byte), ((w & ~m) | (value << lo)));
+		}
+		return;
+	}
+
+	for (got = 0; got < width; got += take)
+	{
+		byte = (bitpos >> 3);
+		off = (int)(bitpos & 7);
+		take = (((8 - off) < (width - got)) ? (8 - off) : (width - got));
+		if (order == BLOBBITS_LSB)
+		{
+			lo = off;
+			w = ((value >> got) & blobbits_mask(take));
+		}
+		else
+		{
+			lo = (8 - off - take);
+			w = ((value >> (width - got - take)) & blobbits_mask(take));
+		}
+		m = (blobbits_mask(take) << lo);
+		p[byte] = (unsigned char)((p[byte] & ~m) | (w << lo));
+		bitpos += take;
+	}
+}
+
+void blobbits_reader_init(blobbits_reader *r, size_t bitpos, int order)
+{
+	r->buf = 0;
+	r->bitpos = bitpos;
+	r->count = 0;
+	r->order = order;
+}
+
+//Tops the buffer up to at least 57 bits where the data allows; buffered bits always end on a byte boundary.
+static void blobbits_refill(blobbits_reader *r, const unsigned char *p, size_t len)
+{
+	size_t next;
+	uint64_t w;
+	int skip;
+	int n;
+
+	if (r->count == 0)
+	{
+		r->buf = 0;
+		next = (r->bitpos >> 3);
+		skip = (int)(r->bitpos & 7);
+	}
+	else
+	{
+		next = ((r->bitpos + r->count) >> 3);
+		skip = 0;
+	}
+	if (next >= len)
+	{
+		return;
+	}
+
+	if ((len - next) >= 8)
+	{
+		n = ((64 - r->count) >> 3);
+		if (r->order == BLOBBITS_LSB)
+		{
+			w = (blobbits_loadle(p + next) >> skip);
+			r->buf |= (w << r->count);
+		}
+		else
+		{
+			w = (blobbits_loadbe(p + next) << skip);
+			r->buf |= (w >> r->count);
+		}
+		r->count += ((n << 3) - skip);
+	}
+	else
+	{
+		while (r->count <= 56 && next < len)
+		{
+			w = p[next++];
+			n = (8 - skip);
+			if (r->order == BLOBBITS_LSB)
+			{
+				r->buf |= ((w >> skip) << r->count);
+			}
+			else
+			{
+				r->buf |= ((((w << skip) & 0xFF) << 56) >> r->count);
+			}
+			r->count += n;
+			skip = 0;
+		}
+	}
+
+	//drop the partial byte that a word load may have pulled in past the last whole byte
+	if (r->count < 64)
+	{
+		if (r->order == BLOBBITS_LSB)
+		{
+			r->buf &= blobbits_mask(r->count);
+		}
+		else
+		{
+			r->buf &= ~(blobbits_mask(64 - r->count));
+		}
+	}
+}
+
+//Takes width bits (1..56) from the buffer, which the caller has made sure holds them.
+static uint64_t blobbits_take(blobbits_reader *r, int width)
+{
+	uint64_t v;
+
+	if (r->order == BLOBBITS_LSB)
+	{
+		v = (r->buf & blobbits_mask(width));
+		r->buf >>= width;
+	}
+	else
+	{
+		v = (r->buf >> (64 - width));
+		r->buf <<= width;
+	}
+	r->count -= width;
+	r->bitpos += width;
+
+	return v;
+}
+
+int blobbits_reader_read(blobbits_reader *r, const void *data, size_t len, int width, uint64_t *value)
+{
+	const unsigned char *p = (const unsigned char *)data;
+	uint64_t hi;
+	uint64_t lo;
+
+	if (!blobbits_inbounds(len, r->bitpos, (size_t)width))
+	{
+		return 0;
+	}
+
+	if (width > 56)
+	{
+		//a refill can only promise 57 bits, so wide fields are taken in two halves
+		if (r->count < 32)
+		{
+			blobbits_refill(r, p, len);
+		}
+		hi = blobbits_take(r, 32);
+		if (r->count < (width - 32))
+		{
+			blobbits_refill(r, p, len);
+		}
+		lo = blobbits_take(r, (width - 32));
+		*value = ((r->order == BLOBBITS_LSB) ? (hi | (lo << 32)) : ((hi << (width - 32)) | lo));
+		return 1;
+	}
+
+	if (r->count < width)
+	{
+		blobbits_refill(r, p, len);
+	}
+	*value = blobbits_take(r, width);
+	return 1;
+}
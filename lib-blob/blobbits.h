@@ -0,0 +1,34 @@
+#ifndef BLOBBITS_H
+#define BLOBBITS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//Bit numbering within the data: LSB counts bit 0 as the least significant bit of byte 0 and assembles fields low bits first (deflate style);
+//MSB counts bit 0 as the most significant bit of byte 0 and assembles fields high bits first (network and most telemetry formats).
+#define BLOBBITS_LSB 0
+#define BLOBBITS_MSB 1
+#define BLOBBITS_MAXWIDTH 64
+
+//True when nbits bits starting at bitpos lie within len bytes.
+int blobbits_inbounds(size_t len, size_t bitpos, size_t nbits);
+
+//Random access to a width bit field (1..64); the caller checks blobbits_inbounds first.
+uint64_t blobbits_read(const void *data, size_t len, size_t bitpos, int width, int order);
+void blobbits_write(void *data, size_t len, size_t bitpos, int width, uint64_t value, int order);
+
+//A sequential reader that keeps up to 64 upcoming bits buffered and refills them a word at a time.
+//The storage is passed on every call rather than kept, since a blob may move it between calls.
+typedef struct blobbits_reader_s
+{
+	uint64_t buf;
+	size_t bitpos;		//position of the next unread bit
+	int count;			//buffered bits
+	int order;
+} blobbits_reader;
+
+void blobbits_reader_init(blobbits_reader *r, size_t bitpos, int order);
+//Returns 0 and consumes nothing when fewer than width bits remain.
+int blobbits_reader_read(blobbits_reader *r, const void *data, size_t len, int width, uint64_t *value);
+
+#endif
@@ -0,0 +1,347 @@
+//LZ4-style block compression; the block layout follows the LZ4 block format so the same decoder rules apply.
+
+#include "blobcompress.h"
+
+#include <string.h>
+
+#define BLOBCOMPRESS_MINMATCH 4
+#define BLOBCOMPRESS_MFLIMIT 12			//a match may not start within the last 12 bytes
+#define BLOBCOMPRESS_LASTLITERALS 5		//and the last 5 bytes are always literals
+#define BLOBCOMPRESS_MAXOFFSET 65535
+#define BLOBCOMPRESS_SKIPTRIGGER 6		//after 2^6 failed probes the search starts stepping further ahead
+
+static int blobcompress_hashlog(int level)
+{
+	if (level < BLOBCOMPRESS_MINLEVEL)
+	{
+		level = BLOBCOMPRESS_MINLEVEL;
+	}
+	if (level > BLOBCOMPRESS_MAXLEVEL)
+	{
+		level = BLOBCOMPRESS_MAXLEVEL;
+	}
+
+	//bigger tables remember more candidates; level 1 matches the reference LZ4 table (4096 entries)
+	return ((level < 5) ? (11 + level) : 16);
+}
+
+static uint32_t blobcompress_read32(const unsigned char *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(uint32_t));
+	return v;
+}
+
+static uint32_t blobcompress_hash(uint32_t seq, int hashlog)
+{
+	return ((seq * 2654435761U) >> (32 - hashlog));
+}
+
+static uint64_t blobcompress_read64(const unsigned char *p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(uint64_t));
+	return v;
+}
+
+//Counts the equal bytes at a and b, stopping at limit; compares a word at a time and locates the first difference from the xor.
+static size_t blobcompress_count(const unsigned char *a, const unsigned char *b, const unsigned char *limit)
+{
+	const unsigned char *start = a;
+	uint64_t diff;
+
+	while ((limit - a) >= 8)
+	{
+		diff = (blobcompress_read64(a) ^ blobcompress_read64(b));
+		if (diff != 0)
+		{
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+			return ((size_t)(a - start) + (size_t)(__builtin_ctzll(diff) >> 3));
+#else
+			break;
+#endif
+		}
+		a += 8;
+		b += 8;
+	}
+	while (a < limit && *a == *b)
+	{
+		++a;
+		++b;
+	}
+
+	return (size_t)(a - start);
+}
+
+static unsigned char *blobcompress_putlength(unsigned char *op, size_t len)
+{
+	while (len >= 255)
+	{
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = (unsigned char)len;
+	return op;
+}
+
+size_t blobcompress_workspace(int level)
+{
+	return ((((size_t)1) << blobcompress_hashlog(level)) * sizeof(uint32_t));
+}
+
+size_t blobcompress_compress(const void *src, size_t srclen, void *dest, size_t destcap, int level, void *workspace)
+{
+	const unsigned char *base = (const unsigned char *)src;
+	const unsigned char *ip = base;
+	const unsigned char *anchor = base;
+	const unsigned char *iend = (base + srclen);
+	const unsigned char *mflimit;
+	const unsigned char *matchlimit;
+	const unsigned char *ref;
+	unsigned char *op = (unsigned char *)dest;
+	unsigned char *oend = (op + destcap);
+	unsigned char *token;
+	uint32_t *table = (uint32_t *)workspace;
+	int hashlog;
+	uint32_t h;
+	size_t litlen;
+	size_t matchlen;
+	unsigned int probes;
+
+	hashlog = blobcompress_hashlog(level);
+	memset(table, 0, blobcompress_workspace(level));
+
+	if (srclen >= (BLOBCOMPRESS_MFLIMIT + 1))
+	{
+		mflimit = (iend - BLOBCOMPRESS_MFLIMIT);
+		matchlimit = (iend - BLOBCOMPRESS_LASTLITERALS);
+
+		++ip;
+		while (ip <= mflimit)
+		{
+			//find the next match; every probe also records the current position
+			probes = (1 << BLOBCOMPRESS_SKIPTRIGGER);
+			for (;;)
+			{
+				h = blobcompress_hash(blobcompress_read32(ip), hashlog);
+				ref = (base + table[h]);
+				table[h] = (uint32_t)(ip - base);
+				if (ref < ip && (size_t)(ip - ref) <= BLOBCOMPRESS_MAXOFFSET && blobcompress_read32(ref) == blobcompress_read32(ip))
+				{
+					break;
+				}
+
+				ip += (probes++ >> BLOBCOMPRESS_SKIPTRIGGER);
+				if (ip > mflimit)
+				{
+					goto lastliterals;
+				}
+			}
+
+			while (ip > anchor && ref > base && ip[-1] == ref[-1])
+			{
+				--ip;
+				--ref;
+			}
+
+			matchlen = (BLOBCOMPRESS_MINMATCH + blobcompress_count((ip + BLOBCOMPRESS_MINMATCH), (ref + BLOBCOMPRESS_MINMATCH), matchlimit));
+
+			litlen = (size_t)(ip - anchor);
+			if ((size_t)(oend - op) < (1 + (litlen / 255) + 1 + litlen + 2 + ((matchlen - BLOBCOMPRESS_MINMATCH) / 255) + 1 + BLOBCOMPRESS_LASTLITERALS))
+			{
+				return 0;
+			}
+
+			token = op++;
+			if (litlen >= 15)
+			{
+				*token = (15 << 4);
+				op = blobcompress_putlength(op, (litlen - 15));
+			}
+			else
+			{
+				*token = (unsigned char)(litlen << 4);
+			}
+			memcpy(op, anchor, litlen);
+			op += litlen;
+
+			*op++ = (unsigned char)((ip - ref) & 0xFF);
+			*op++ = (unsigned char)(((ip - ref) >> 8) & 0xFF);
+
+			if ((matchlen - BLOBCOMPRESS_MINMATCH) >= 15)
+			{
+				*token |= 15;
+				op = blobcompress_putlength(op, (matchlen - BLOBCOMPRESS_MINMATCH - 15));
+			}
+			else
+			{
+				*token |= (unsigned char)(matchlen - BLOBCOMPRESS_MINMATCH);
+			}
+
+			ip += matchlen;
+			anchor = ip;
+
+			//seed the table with a position inside the match so back-to-back repeats are found immediately
+			if (ip <= mflimit)
+			{
+				table[blobcompress_hash(blobcompress_read32(ip - 2), hashlog)] = (uint32_t)((ip - 2) - base);
+			}
+		}
+	}
+
+lastliterals:
+	litlen = (size_t)(iend - anchor);
+	if ((size_t)(oend - op) < (1 + (litlen / 255) + 1 + litlen))
+	{
+		return 0;
+	}
+	token = op++;
+	if (litlen >= 15)
+	{
+		*token = (15 << 4);
+		op = blobcompress_putlength(op, (litlen - 15));
+	}
+	else
+	{
+		*token = (unsigned char)(litlen << 4);
+	}
+	memcpy(op, anchor, litlen);
+	op += litlen;
+
+	return (size_t)(op - (unsigned char *)dest);
+}
+
+size_t blobcompress_decompress(const void *src, size_t srclen, void *dest, size_t destcap)
+{
+	const unsigned char *ip = (const unsigned char *)src;
+	const unsigned char *iend = (ip + srclen);
+	unsigned char *op = (unsigned char *)dest;
+	unsigned char *ostart = op;
+	unsigned char *oend = (op + destcap);
+	const unsigned char *match;
+	unsigned char *mend;
+	unsigned int token;
+	size_t len;
+	size_t offset;
+	unsigned char b;
+
+	if (srclen == 0)
+	{
+		return ((size_t)-1);
+	}
+
+	for (;;)
+	{
+		token = *ip++;
+		len = (token >> 4);
+
+		//fast path for the common sequence: short literal run and short match, far from both ends, so every copy can be a fixed size
+		if (len != 15 && (token & 15) != 15 && (iend - ip) >= 18 && (oend - op) >= 32)
+		{
+			memcpy(op, ip, 16);
+			op += len;
+			ip += len;
+
+			offset = (((size_t)ip[0]) | (((size_t)ip[1]) << 8));
+			if (offset >= 8 && offset <= (size_t)(op - ostart))
+			{
+				ip += 2;
+				match = (op - offset);
+				memcpy(op, match, 8);
+				memcpy((op + 8), (match + 8), 8);
+				memcpy((op + 16), (match + 16), 2);
+				op += ((token & 15) + BLOBCOMPRESS_MINMATCH);
+				continue;
+			}
+		}
+		else
+		{
+			if (len == 15)
+			{
+				do
+				{
+					if (ip >= iend)
+					{
+						return ((size_t)-1);
+					}
+					b = *ip++;
+					len += b;
+				}
+				while (b == 255);
+			}
+			if (len > (size_t)(iend - ip) || len > (size_t)(oend - op))
+			{
+				return ((size_t)-1);
+			}
+			memcpy(op, ip, len);
+			op += len;
+			ip += len;
+
+			if (ip == iend)
+			{
+				break;	//the last sequence is literals only
+			}
+		}
+
+		if ((iend - ip) < 2)
+		{
+			return ((size_t)-1);
+		}
+		offset = (((size_t)ip[0]) | (((size_t)ip[1]) << 8));
+		ip += 2;
+		if (offset == 0 || offset > (size_t)(op - ostart))
+		{
+			return ((size_t)-1);
+		}
+
+		len = (token & 15);
+		if (len == 15)
+		{
+			do
+			{
+				if (ip >= iend)
+				{
+					return ((size_t)-1);
+				}
+				b = *ip++;
+				len += b;
+			}
+			while (b == 255);
+		}
+		len += BLOBCOMPRESS_MINMATCH;
+		if (len > (size_t)(oend - op))
+		{
+			return ((size_t)-1);
+		}
+
+		match = (op - offset);
+		if (offset >= 8 && (size_t)(oend - op) >= (len + 8))
+		{
+			//chunks never overlap their own source when the distance is at least the chunk size, and there is room to round up
+			mend = (op + len);
+			do
+			{
+				memcpy(op, match, 8);
+				op += 8;
+				match += 8;
+			}
+			while (op < mend);
+			op = mend;
+		}
+		else
+		{
+			//short distances are repeating patterns; copy byte by byte so each byte sees the ones just written
+			while (len-- > 0)
+			{
+				*op++ = *match++;
+			}
+		}
+
+		if (ip >= iend)
+		{
+			return ((size_t)-1);	//a block has to end with a literal run
+		}
+	}
+
+	return (size_t)(op - ostart);
+}
@@ -0,0 +1,24 @@
+#ifndef BLOBCOMPRESS_H
+#define BLOBCOMPRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//An LZ4-style block codec: greedy hash-chain-free matching over a 64kb window, byte-aligned sequences, no entropy stage.
+
+#define BLOBCOMPRESS_MINLEVEL 1
+#define BLOBCOMPRESS_MAXLEVEL 9
+
+//Worst case compressed size for srclen input bytes.
+#define blobcompress_bound(srclen) ((srclen) + ((srclen) / 255) + 16)
+
+//Bytes of scratch memory the compressor needs at a given level.
+size_t blobcompress_workspace(int level);
+
+//Returns the compressed size, or 0 if dest was too small.
+size_t blobcompress_compress(const void *src, size_t srclen, void *dest, size_t destcap, int level, void *workspace);
+
+//Returns the decompressed size, or (size_t)-1 if src is malformed or would overflow dest.
+size_t blobcompress_decompress(const void *src, size_t srclen, void *dest, size_t destcap);
+
+#endif
@@ -0,0 +1,365 @@
+//Hex and base64 text encodings; SSSE3/AVX2 when the compiler targets them, table driven scalar otherwise.
+//There is no runtime dispatch, so a default x86-64 build uses the scalar code.
+
+#include "blobencode.h"
+
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define BLOBENCODE_AVX2
+#endif
+#if defined(__SSSE3__) || defined(__AVX__)
+	#include <tmmintrin.h>
+	#define BLOBENCODE_SSSE3
+#endif
+
+static const char blobencode_hexdigits[16] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
+
+static const char blobencode_base64std[64] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char blobencode_base64url[64] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+//Digit values for both alphabets, 0xFF for everything else (including '=').
+static unsigned char blobencode_base64values[256];
+static unsigned char blobencode_hexvalues[256];
+static int blobencode_tablesready = 0;
+
+static void blobencode_inittables(void)
+{
+	int i;
+
+	if (blobencode_tablesready)
+	{
+		return;
+	}
+
+	memset(blobencode_base64values, 0xFF, sizeof(blobencode_base64values));
+	for (i = 0; i < 64; ++i)
+	{
+		blobencode_base64values[(unsigned char)blobencode_base64std[i]] = (unsigned char)i;
+		blobencode_base64values[(unsigned char)blobencode_base64url[i]] = (unsigned char)i;
+	}
+
+	memset(blobencode_hexvalues, 0xFF, sizeof(blobencode_hexvalues));
+	for (i = 0; i < 10; ++i)
+	{
+		blobencode_hexvalues['0' + i] = (unsigned char)i;
+	}
+	for (i = 0; i < 6; ++i)
+	{
+		blobencode_hexvalues['a' + i] = (unsigned char)(10 + i);
+		blobencode_hexvalues['A' + i] = (unsigned char)(10 + i);
+	}
+
+	//the tables are identical whichever thread builds them, so a racing second build is harmless
+	blobencode_tablesready = 1;
+}
+
+void blobencode_tohex(const void *src, size_t len, char *dest)
+{
+	const unsigned char *p = (const unsigned char *)src;
+	size_t i = 0;
+#if defined(BLOBENCODE_AVX2)
+	__m256i lut32 = _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+	__m256i nib32 = _mm256_set1_epi8(0x0F);
+	__m256i v32;
+	__m256i hi32;
+	__m256i lo32;
+#endif
+#if defined(BLOBENCODE_SSSE3)
+	__m128i lut16 = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+	__m128i nib16 = _mm_set1_epi8(0x0F);
+	__m128i v16;
+	__m128i hi16;
+	__m128i lo16;
+#endif
+
+#if defined(BLOBENCODE_AVX2)
+	for (; (len - i) >= 32; i += 32)
+	{
+		v32 = _mm256_loadu_si256((const __m256i *)(p + i));
+		hi32 = _mm256_shuffle_epi8(lut32, _mm256_and_si256(_mm256_srli_epi16(v32, 4), nib32));
+		lo32 = _mm256_shuffle_epi8(lut32, _mm256_and_si256(v32, nib32));
+
+		//the unpacks interleave within each 128 bit lane, so the lanes are put back in order on the way out
+		v32 = _mm256_unpacklo_epi8(hi32, lo32);
+		hi32 = _mm256_unpackhi_epi8(hi32, lo32);
+		_mm256_storeu_si256((__m256i *)(dest + (i * 2)), _mm256_permute2x128_si256(v32, hi32, 0x20));
+		_mm256_storeu_si256((__m256i *)(dest + (i * 2) + 32), _mm256_permute2x128_si256(v32, hi32, 0x31));
+	}
+#endif
+#if defined(BLOBENCODE_SSSE3)
+	for (; (len - i) >= 16; i += 16)
+	{
+		v16 = _mm_loadu_si128((const __m128i *)(p + i));
+		hi16 = _mm_shuffle_epi8(lut16, _mm_and_si128(_mm_srli_epi16(v16, 4), nib16));
+		lo16 = _mm_shuffle_epi8(lut16, _mm_and_si128(v16, nib16));
+		_mm_storeu_si128((__m128i *)(dest + (i * 2)), _mm_unpacklo_epi8(hi16, lo16));
+		_mm_storeu_si128((__m128i *)(dest + (i * 2) + 16), _mm_unpackhi_epi8(hi16, lo16));
+	}
+#endif
+
+	for (; i < len; ++i)
+	{
+		dest[i * 2] = blobencode_hexdigits[p[i] >> 4];
+		dest[(i * 2) + 1] = blobencode_hexdigits[p[i] & 0x0F];
+	}
+}
+
+size_t blobencode_fromhex(const char *src, size_t len, void *dest)
+{
+	const unsigned char *s = (const unsigned char *)src;
+	unsigned char *out = (unsigned char *)dest;
+	unsigned char hi;
+	unsigned char lo;
+	size_t i = 0;
+#if defined(BLOBENCODE_SSSE3)
+	__m128i v;
+	__m128i lower;
+	__m128i isdigit;
+	__m128i isalpha;
+	__m128i values[2];
+	int k;
+	int valid;
+#endif
+
+	if (len & 1)
+	{
+		return ((size_t)-1);
+	}
+
+#if defined(BLOBENCODE_SSSE3)
+	for (; (len - i) >= 32; i += 32)
+	{
+		valid = 0xFFFF;
+		for (k = 0; k < 2; ++k)
+		{
+			//signed compares also reject every byte >= 0x80, which reads as negative
+			v = _mm_loadu_si128((const __m128i *)(s + i + (k * 16)));
+			lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+			isdigit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), v));
+			isalpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('f' + 1), lower));
+			valid &= _mm_movemask_epi8(_mm_or_si128(isdigit, isalpha));
+
+			values[k] = _mm_or_si128(_mm_and_si128(isdigit, _mm_sub_epi8(v, _mm_set1_epi8('0'))), _mm_and_si128(isalpha, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+			//each pair of nibbles becomes (high * 16) + low in a 16 bit lane
+			values[k] = _mm_maddubs_epi16(values[k], _mm_set1_epi16(0x0110));
+		}
+		if (valid != 0xFFFF)
+		{
+			return ((size_t)-1);
+		}
+
+		_mm_storeu_si128((__m128i *)(out + (i / 2)), _mm_packus_epi16(values[0], values[1]));
+	}
+#endif
+
+	blobencode_inittables();
+	for (; i < len; i += 2)
+	{
+		hi = blobencode_hexvalues[s[i]];
+		lo = blobencode_hexvalues[s[i + 1]];
+		if ((hi | lo) == 0xFF)
+		{
+			return ((size_t)-1);
+		}
+		out[i / 2] = (unsigned char)((hi << 4) | lo);
+	}
+
+	return (len / 2);
+}
+
+size_t blobencode_base64len(size_t len, int urlsafe)
+{
+	if (urlsafe)
+	{
+		return (((len / 3) * 4) + (((len % 3) == 0) ? 0 : ((len % 3) + 1)));
+	}
+
+	return (((len + 2) / 3) * 4);
+}
+
+#if defined(BLOBENCODE_SSSE3)
+//Spreads 12 input bytes over 16 lanes of 6 bit indexes, then maps them to characters with one shuffle; the shuffle
+//picks a per-range offset (A-Z, a-z, 0-9, and the two alphabet specific characters) that is added to the index.
+static __m128i blobencode_base64block(__m128i in, __m128i offsets)
+{
+	__m128i t0;
+	__m128i t1;
+	__m128i indices;
+	__m128i range;
+
+	in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+	t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+	t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+	indices = _mm_or_si128(t0, t1);
+
+	range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+	range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+	return _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, range));
+}
+#endif
+
+size_t blobencode_tobase64(const void *src, size_t len, char *dest, int urlsafe)
+{
+	const unsigned char *p = (const unsigned char *)src;
+	const char *alphabet = (urlsafe ? blobencode_base64url : blobencode_base64std);
+	char *out = dest;
+	uint32_t triple;
+	size_t i = 0;
+#if defined(BLOBENCODE_SSSE3)
+	__m128i offsets;
+
+	if (urlsafe)
+	{
+		offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '-' - 62, '_' - 63, 'A', 0, 0);
+	}
+	else
+	{
+		offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+	}
+
+	//each step consumes 12 bytes but loads 16
+	for (; (len - i) >= 16; i += 12)
+	{
+		_mm_storeu_si128((__m128i *)out, blobencode_base64block(_mm_loadu_si128((const __m128i *)(p + i)), offsets));
+		out += 16;
+	}
+#endif
+
+	for (; (len - i) >= 3; i += 3)
+	{
+		triple = ((((uint32_t)p[i]) << 16) | (((uint32_t)p[i + 1]) << 8) | ((uint32_t)p[i + 2]));
+		*out++ = alphabet[(triple >> 18) & 0x3F];
+		*out++ = alphabet[(triple >> 12) & 0x3F];
+		*out++ = alphabet[(triple >> 6) & 0x3F];
+		*out++ = alphabet[triple & 0x3F];
+	}
+
+	if ((len - i) > 0)
+	{
+		triple = (((uint32_t)p[i]) << 16);
+		if ((len - i) == 2)
+		{
+			triple |= (((uint32_t)p[i + 1]) << 8);
+		}
+
+		*out++ = alphabet[(triple >> 18) & 0x3F];
+		*out++ = alphabet[(triple >> 12) & 0x3F];
+		if ((len - i) == 2)
+		{
+			*out++ = alphabet[(triple >> 6) & 0x3F];
+		}
+		else if (!urlsafe)
+		{
+			*out++ = '=';
+		}
+		if (!urlsafe)
+		{
+			*out++ = '=';
+		}
+	}
+
+	return (size_t)(out - dest);
+}
+
+size_t blobencode_frombase64(const char *src, size_t len, void *dest)
+{
+	const unsigned char *s = (const unsigned char *)src;
+	unsigned char *out = (unsigned char *)dest;
+	unsigned char c[4];
+	size_t i = 0;
+	size_t k;
+#if defined(BLOBENCODE_SSSE3)
+	__m128i v;
+	__m128i hi;
+	__m128i shift;
+	__m128i bad;
+#endif
+
+	//padding is optional, but when present the input must be whole quanta
+	if (len > 0 && s[len - 1] == '=')
+	{
+		if ((len & 3) != 0)
+		{
+			return ((size_t)-1);
+		}
+		--len;
+		if (s[len - 1] == '=')
+		{
+			--len;
+		}
+	}
+	if ((len & 3) == 1)
+	{
+		return ((size_t)-1);
+	}
+
+#if defined(BLOBENCODE_SSSE3)
+	//standard alphabet only; a block with anything else (including url-safe characters) drops to the scalar loop, which decides
+	//from the same starting point. Validation checks each byte's high nibble against a bitmask of the rows valid for its low nibble.
+	for (; (i + 24) <= len; i += 16)
+	{
+		v = _mm_loadu_si128((const __m128i *)(s + i));
+		hi = _mm_and_si128(_mm_srli_epi32(v, 4), _mm_set1_epi8(0x0F));
+		bad = _mm_cmpeq_epi8(_mm_and_si128(
+			_mm_shuffle_epi8(_mm_setr_epi8((char)0xA8, (char)0xF8, (char)0xF8, (char)0xF8, (char)0xF8, (char)0xF8, (char)0xF8, (char)0xF8, (char)0xF8, (char)0xF8, (char)0xF0, 0x54, 0x50, 0x50, 0x50, 0x54), _mm_and_si128(v, _mm_set1_epi8(0x0F))),
+			_mm_shuffle_epi8(_mm_setr_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char)0x80, 0, 0, 0, 0, 0, 0, 0, 0), hi)), _mm_setzero_si128());
+		if (_mm_movemask_epi8(bad) != 0)
+		{
+			break;
+		}
+
+		//'+' and '/' share a row, so '/' takes 3 off the row's offset
+		shift = _mm_shuffle_epi8(_mm_setr_epi8(0, 0, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0), hi);
+		shift = _mm_add_epi8(shift, _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('/')), _mm_set1_epi8(-3)));
+		v = _mm_add_epi8(v, shift);
+
+		//pack four 6 bit values into three bytes per 32 bit lane, then squeeze out the fourth byte of each lane
+		v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+		v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+		v = _mm_shuffle_epi8(v, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+		_mm_storeu_si128((__m128i *)out, v);
+		out += 12;
+	}
+#endif
+
+	blobencode_inittables();
+	for (; (len - i) >= 4; i += 4)
+	{
+		c[0] = blobencode_base64values[s[i]];
+		c[1] = blobencode_base64values[s[i + 1]];
+		c[2] = blobencode_base64values[s[i + 2]];
+		c[3] = blobencode_base64values[s[i + 3]];
+		if ((c[0] | c[1] | c[2] | c[3]) == 0xFF)
+		{
+			return ((size_t)-1);
+		}
+
+		*out++ = (unsigned char)((c[0] << 2) | (c[1] >> 4));
+		*out++ = (unsigned char)((c[1] << 4) | (c[2] >> 2));
+		*out++ = (unsigned char)((c[2] << 6) | c[3]);
+	}
+
+	if ((len - i) > 0)
+	{
+		c[2] = 0;
+		for (k = 0; k < (len - i); ++k)
+		{
+			c[k] = blobencode_base64values[s[i + k]];
+			if (c[k] == 0xFF)
+			{
+				return ((size_t)-1);
+			}
+		}
+
+		*out++ = (unsigned char)((c[0] << 2) | (c[1] >> 4));
+		if ((len - i) == 3)
+		{
+			*out++ = (unsigned char)((c[1] << 4) | (c[2] >> 2));
+		}
+	}
+
+	return (size_t)(out - (unsigned char *)dest);
+}
@@ -0,0 +1,20 @@
+#ifndef BLOBENCODE_H
+#define BLOBENCODE_H
+
+#include <stddef.h>
+
+#define blobencode_hexlen(len) ((len) * 2)
+#define blobencode_base64max(len) ((((len) / 4) * 3) + 2)		//upper bound on the decoded size of len base64 characters
+
+//Lowercase hex; writes exactly blobencode_hexlen(len) characters.
+void blobencode_tohex(const void *src, size_t len, char *dest);
+//Accepts either case; returns len / 2, or (size_t)-1 if len is odd or a character is not a hex digit.
+size_t blobencode_fromhex(const char *src, size_t len, void *dest);
+
+//Standard base64 is padded with '='; the url-safe alphabet ('-', '_') is written without padding.
+size_t blobencode_base64len(size_t len, int urlsafe);
+size_t blobencode_tobase64(const void *src, size_t len, char *dest, int urlsafe);
+//Accepts both alphabets with or without padding; returns the decoded size, or (size_t)-1 on malformed input.
+size_t blobencode_frombase64(const char *src, size_t len, void *dest);
+
+#endif
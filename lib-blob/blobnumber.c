@@ -0,0 +1,303 @@
+//ASCII number parsing and formatting; decimal digits are taken eight at a time with SWAR arithmetic on 64-bit words.
+
+#include "blobnumber.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOBNUMBER_SIGDIGITS 19			//decimal digits that always fit in a uint64_t
+#define BLOBNUMBER_EXACTPOW 22			//10^22 is the largest power of ten a double holds exactly
+#define BLOBNUMBER_EXACTMANT (((uint64_t)1) << 53)
+
+static const double blobnumber_pow10[BLOBNUMBER_EXACTPOW + 1] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const char blobnumber_digitpairs[] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+static const char blobnumber_alphabet[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+//Value of a digit character in any base up to 36, or 36 for anything else.
+static int blobnumber_digit(unsigned char c)
+{
+	if (c >= '0' && c <= '9')
+	{
+		return (c - '0');
+	}
+	c |= 0x20;
+	if (c >= 'a' && c <= 'z')
+	{
+		return (c - 'a' + 10);
+	}
+
+	return 36;
+}
+
+//When p holds eight decimal digits, stores their value and returns 1. The first digit is the most significant.
+static int blobnumber_eightdigits(const unsigned char *p, uint32_t *value)
+{
+	uint64_t x;
+
+	x = ((uint64_t)p[0]) | (((uint64_t)p[1]) << 8) | (((uint64_t)p[2]) << 16) | (((uint64_t)p[3]) << 24) |
+		(((uint64_t)p[4]) << 32) | (((uint64_t)p[5]) << 40) | (((uint64_t)p[6]) << 48) | (((uint64_t)p[7]) << 56);
+
+	//every byte is 0x30..0x39 exactly when its high nibble is 3 and adding 6 does not carry out of the low nibble
+	if (((x & 0xF0F0F0F0F0F0F0F0ULL) | (((x + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) != 0x3333333333333333ULL)
+	{
+		return 0;
+	}
+
+	//fold adjacent digits into pairs, then pairs into fours, then fours into the whole value
+	x -= 0x3030303030303030ULL;
+	x = ((x * 10) + (x >> 8));
+	x = (((x & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) + (((x >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+	*value = (uint32_t)x;
+	return 1;
+}
+
+size_t blobnumber_parseint(const char *s, size_t len, int base, double *value)
+{
+	const unsigned char *p = (const unsigned char *)s;
+	uint64_t acc = 0;
+	double wide = 0;
+	uint32_t eight;
+	size_t i = 0;
+	size_t start;
+	int overflow = 0;
+	int negative = 0;
+	int d;
+
+	if (i < len && (p[i] == '-' || p[i] == '+'))
+	{
+		negative = (p[i] == '-');
+		++i;
+	}
+	start = i;
+
+	if (base == 10)
+	{
+		//acc * 10^8 + 99999999 stays below 2^64 while acc is below 1.8 * 10^11
+		while ((len - i) >= 8 && acc < 180000000000ULL && blobnumber_eightdigits((p + i), &eight))
+		{
+			acc = ((acc * 100000000) + eight);
+			i += 8;
+		}
+	}
+
+	for (; i < len; ++i)
+	{
+		d = blobnumber_digit(p[i]);
+		if (d >= base)
+		{
+			break;
+		}
+
+		if (!overflow)
+		{
+			if (acc > ((((uint64_t)-1) - (uint64_t)d) / (uint64_t)base))
+			{
+				overflow = 1;
+				wide = (double)acc;
+			}
+			else
+			{
+				acc = ((acc * (uint64_t)base) + (uint64_t)d);
+				continue;
+			}
+		}
+		wide = ((wide * base) + d);
+	}
+
+	if (i == start)
+	{
+		return 0;
+	}
+
+	*value = (overflow ? wide : (double)acc);
+	if (negative)
+	{
+		*value = -(*value);
+	}
+	return i;
+}
+
+//Accumulates a run of decimal digits into mant, counting the digits it holds in sig and those that no longer fit in dropped.
+static size_t blobnumber_digitrun(const unsigned char *p, size_t len, uint64_t *mant, int *sig, int *dropped)
+{
+	uint32_t eight;
+	size_t i = 0;
+	int d;
+
+	while ((len - i) >= 8 && (*sig + 8) <= BLOBNUMBER_SIGDIGITS && blobnumber_eightdigits((p + i), &eight))
+	{
+		*mant = ((*mant * 100000000) + eight);
+		*sig += ((*mant == 0) ? 0 : 8);
+		i += 8;
+	}
+
+	for (; i < len && p[i] >= '0' && p[i] <= '9'; ++i)
+	{
+		d = (p[i] - '0');
+		if (*sig < BLOBNUMBER_SIGDIGITS)
+		{
+			*mant = ((*mant * 10) + (uint64_t)d);
+			*sig += ((*mant == 0) ? 0 : 1);
+		}
+		else
+		{
+			++(*dropped);
+		}
+	}
+
+	return i;
+}
+
+size_t blobnumber_parsenum(const char *s, size_t len, double *value)
+{
+	const unsigned char *p = (const unsigned char *)s;
+	char local[64];
+	char *copy;
+	uint64_t mant = 0;
+	size_t i = 0;
+	size_t n;
+	size_t digits;
+	size_t j;
+	long exp10 = 0;
+	long e;
+	int sig = 0;
+	int dropped = 0;
+	int fracdropped;
+	int negative = 0;
+	int expnegative;
+
+	if (i < len && (p[i] == '-' || p[i] == '+'))
+	{
+		negative = (p[i] == '-');
+		++i;
+	}
+
+	n = blobnumber_digitrun((p + i), (len - i), &mant, &sig, &dropped);
+	i += n;
+	digits = n;
+	exp10 += dropped;
+	if (i < len && p[i] == '.')
+	{
+		j = (i + 1);
+		fracdropped = 0;
+		n = blobnumber_digitrun((p + j), (len - j), &mant, &sig, &fracdropped);
+		if (n != 0 || digits != 0)
+		{
+			//digits kept from the fraction scale the mantissa down; dropped ones only cost precision
+			exp10 -= (long)(n - (size_t)fracdropped);
+			digits += n;
+			dropped += fracdropped;
+			i = (j + n);
+		}
+	}
+	if (digits == 0)
+	{
+		return 0;
+	}
+
+	if (i < len && (p[i] == 'e' || p[i] == 'E'))
+	{
+		j = (i + 1);
+		expnegative = 0;
+		if (j < len && (p[j] == '-' || p[j] == '+'))
+		{
+			expnegative = (p[j] == '-');
+			++j;
+		}
+		if (j < len && p[j] >= '0' && p[j] <= '9')
+		{
+			e = 0;
+			for (; j < len && p[j] >= '0' && p[j] <= '9'; ++j)
+			{
+				if (e < 100000)
+				{
+					e = ((e * 10) + (p[j] - '0'));
+				}
+			}
+			exp10 += (expnegative ? -e : e);
+			i = j;
+		}
+	}
+
+	//Clinger's fast path: an exactly representable mantissa scaled by an exactly representable power of ten rounds correctly
+	if (mant == 0)
+	{
+		*value = (negative ? -0.0 : 0.0);
+		return i;
+	}
+	if (dropped == 0 && mant <= BLOBNUMBER_EXACTMANT && exp10 >= -BLOBNUMBER_EXACTPOW && exp10 <= BLOBNUMBER_EXACTPOW)
+	{
+		*value = ((exp10 < 0) ? ((double)mant / blobnumber_pow10[-exp10]) : ((double)mant * blobnumber_pow10[exp10]));
+		if (negative)
+		{
+			*value = -(*value);
+		}
+		return i;
+	}
+
+	//everything else goes to the C library, which rounds correctly on every platform we build on
+	copy = ((i < sizeof(local)) ? local : (char *)malloc(i + 1));
+	if (copy == NULL)
+	{
+		return 0;
+	}
+	memcpy(copy, s, i);
+	copy[i] = '\0';
+	*value = strtod(copy, NULL);
+	if (copy != local)
+	{
+		free(copy);
+	}
+	return i;
+}
+
+size_t blobnumber_formatuint(char *dest, uint64_t value, int base)
+{
+	char buf[BLOBNUMBER_UINTMAX];
+	char *p = (buf + sizeof(buf));
+	size_t len;
+	unsigned int pair;
+
+	if (base == 10)
+	{
+		while (value >= 100)
+		{
+			pair = (unsigned int)(value % 100);
+			value /= 100;
+			p -= 2;
+			p[0] = blobnumber_digitpairs[(pair * 2)];
+			p[1] = blobnumber_digitpairs[(pair * 2) + 1];
+		}
+		if (value >= 10)
+		{
+			p -= 2;
+			p[0] = blobnumber_digitpairs[(value * 2)];
+			p[1] = blobnumber_digitpairs[(value * 2) + 1];
+		}
+		else
+		{
+			*(--p) = (char)('0' + value);
+		}
+	}
+	else
+	{
+		do
+		{
+			*(--p) = blobnumber_alphabet[value % (uint64_t)base];
+			value /= (uint64_t)base;
+		} while (value != 0);
+	}
+
+	len = (size_t)((buf + sizeof(buf)) - p);
+	memcpy(dest, p, len);
+	return len;
+}
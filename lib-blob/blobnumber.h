@@ -0,0 +1,22 @@
+#ifndef BLOBNUMBER_H
+#define BLOBNUMBER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BLOBNUMBER_MINBASE 2
+#define BLOBNUMBER_MAXBASE 36
+#define BLOBNUMBER_UINTMAX 64		//room for any uint64_t in any base
+
+//Parses an optionally signed run of digits in base 2..36 (letters in either case) at the very start of s; no whitespace is skipped.
+//Returns the characters consumed, or 0 if there are no digits. Values past 2^64 keep accumulating as a double.
+size_t blobnumber_parseint(const char *s, size_t len, int base, double *value);
+
+//Parses an optionally signed decimal with optional fraction and exponent ('12', '-0.5', '3e-7'); no hex, inf or nan.
+//Returns the characters consumed, or 0 if there is no number. The result is correctly rounded.
+size_t blobnumber_parsenum(const char *s, size_t len, double *value);
+
+//Writes value in base 2..36 (lowercase letters) to dest, which must have room for BLOBNUMBER_UINTMAX characters; returns the length.
+size_t blobnumber_formatuint(char *dest, uint64_t value, int base);
+
+#endif
@@ -0,0 +1,289 @@
+//Byte and substring search over raw memory; SSE2/AVX2 when the compiler targets them, scalar otherwise.
+//There is no runtime dispatch: the AVX2 kernels are only built when the compiler itself targets AVX2 (-mavx2, -march=haswell or /arch:AVX2),
+//so a default x86-64 build uses the SSE2 kernels.
+
+#include "blobsearch.h"
+
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define BLOBSEARCH_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define BLOBSEARCH_SSE2
+#endif
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+static int blobsearch_ctz(uint32_t x)
+{
+	unsigned long i;
+	_BitScanForward(&i, x);
+	return (int)i;
+}
+	#define blobsearch_popcount(x) ((int)__popcnt(x))
+#elif defined(__GNUC__)
+	#define blobsearch_ctz(x) __builtin_ctz(x)
+	#define blobsearch_popcount(x) __builtin_popcount(x)
+#else
+static int blobsearch_ctz(uint32_t x)
+{
+	int i = 0;
+	while (!(x & 1))
+	{
+		x >>= 1;
+		++i;
+	}
+	return i;
+}
+static int blobsearch_popcount(uint32_t x)
+{
+	int i = 0;
+	while (x)
+	{
+		x &= (x - 1);
+		++i;
+	}
+	return i;
+}
+#endif
+
+size_t blobsearch_findbyte(const void *src, size_t len, unsigned char byte)
+{
+	const unsigned char *p = (const unsigned char *)src;
+	const unsigned char *hit;
+	size_t i = 0;
+#if defined(BLOBSEARCH_AVX2)
+	__m256i n32 = _mm256_set1_epi8((char)byte);
+	uint32_t m32;
+#endif
+#if defined(BLOBSEARCH_SSE2)
+	__m128i n16 = _mm_set1_epi8((char)byte);
+	uint32_t m16;
+#endif
+
+#if defined(BLOBSEARCH_AVX2)
+	for (; (i + 32) <= len; i += 32)
+	{
+		m32 = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + i)), n32));
+		if (m32 != 0)
+		{
+			return (i + blobsearch_ctz(m32));
+		}
+	}
+#endif
+#if defined(BLOBSEARCH_SSE2)
+	for (; (i + 16) <= len; i += 16)
+	{
+		m16 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i)), n16));
+		if (m16 != 0)
+		{
+			return (i + blobsearch_ctz(m16));
+		}
+	}
+#endif
+
+	//the tail, or everything on targets without SIMD; the C library's memchr is the best scalar option we have
+	hit = (const unsigned char *)memchr((p + i), byte, (len - i));
+	return ((hit == NULL) ? len : (size_t)(hit - p));
+}
+
+size_t blobsearch_find(const void *src, size_t len, const void *needle, size_t needlelen)
+{
+	const unsigned char *p = (const unsigned char *)src;
+	const unsigned char *n = (const unsigned char *)needle;
+	size_t i = 0;
+	size_t last;
+
+	if (needlelen == 0)
+	{
+		return 0;
+	}
+	if (needlelen > len)
+	{
+		return len;
+	}
+	if (needlelen == 1)
+	{
+		return blobsearch_findbyte(src, len, n[0]);
+	}
+
+	last = (len - needlelen);	//last valid match offset
+
+#if defined(BLOBSEARCH_SSE2)
+	{
+		//compare both the first and the last needle byte at every offset of a block at once; only offsets where both match are verified with memcmp
+		__m128i first = _mm_set1_epi8((char)n[0]);
+		__m128i lastb = _mm_set1_epi8((char)n[needlelen - 1]);
+		uint32_t mask;
+		int bit;
+
+		for (; (i + 16) <= (last + 1); i += 16)
+		{
+			mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(
+				_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i)), first),
+				_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i + needlelen - 1)), lastb)));
+			while (mask != 0)
+			{
+				bit = blobsearch_ctz(mask);
+				if (memcmp((p + i + bit + 1), (n + 1), (needlelen - 2)) == 0)
+				{
+					return (i + bit);
+				}
+				mask &= (mask - 1);
+			}
+		}
+	}
+#endif
+
+	while (i <= last)
+	{
+		i += blobsearch_findbyte((p + i), ((last + 1) - i), n[0]);
+		if (i > last)
+		{
+			break;
+		}
+		if (memcmp((p + i + 1), (n + 1), (needlelen - 1)) == 0)
+		{
+			return i;
+		}
+		++i;
+	}
+
+	return len;
+}
+
+size_t blobsearch_findany(const void *src, size_t len, const void *set, size_t setlen)
+{
+	const unsigned char *p = (const unsigned char *)src;
+	const unsigned char *s = (const unsigned char *)set;
+	uint32_t table[8];
+	size_t i = 0;
+	size_t k;
+
+	if (setlen == 0)
+	{
+		return len;
+	}
+	if (setlen == 1)
+	{
+		return blobsearch_findbyte(src, len, s[0]);
+	}
+
+#if defined(BLOBSEARCH_SSE2)
+	if (setlen <= 8)
+	{
+		//small sets are cheapest as one compare per member, OR'ed together
+		__m128i members[8];
+		__m128i block;
+		__m128i hits;
+		uint32_t mask;
+
+		for (k = 0; k < setlen; ++k)
+		{
+			members[k] = _mm_set1_epi8((char)s[k]);
+		}
+		for (; (i + 16) <= len; i += 16)
+		{
+			block = _mm_loadu_si128((const __m128i *)(p + i));
+			hits = _mm_cmpeq_epi8(block, members[0]);
+			for (k = 1; k < setlen; ++k)
+			{
+				hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, members[k]));
+			}
+			mask = (uint32_t)_mm_movemask_epi8(hits);
+			if (mask != 0)
+			{
+				return (i + blobsearch_ctz(mask));
+			}
+		}
+	}
+#endif
+
+	memset(table, 0, sizeof(table));
+	for (k = 0; k < setlen; ++k)
+	{
+		table[s[k] >> 5] |= (((uint32_t)1) << (s[k] & 31));
+	}
+	for (; i < len; ++i)
+	{
+		if (table[p[i] >> 5] & (((uint32_t)1) << (p[i] & 31)))
+		{
+			return i;
+		}
+	}
+
+	return len;
+}
+
+size_t blobsearch_count(const void *src, size_t len, unsigned char byte)
+{
+	const unsigned char *p = (const unsigned char *)src;
+	size_t i = 0;
+	size_t count = 0;
+#if defined(BLOBSEARCH_AVX2)
+	__m256i n32 = _mm256_set1_epi8((char)byte);
+#endif
+#if defined(BLOBSEARCH_SSE2)
+	__m128i n16 = _mm_set1_epi8((char)byte);
+#endif
+
+#if defined(BLOBSEARCH_AVX2)
+	for (; (i + 32) <= len; i += 32)
+	{
+		count += blobsearch_popcount((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + i)), n32)));
+	}
+#endif
+#if defined(BLOBSEARCH_SSE2)
+	for (; (i + 16) <= len; i += 16)
+	{
+		count += blobsearch_popcount((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i)), n16)));
+	}
+#endif
+
+	for (; i < len; ++i)
+	{
+		count += (p[i] == byte);
+	}
+
+	return count;
+}
+
+int blobsearch_compare(const void *a, size_t alen, const void *b, size_t blen)
+{
+	const unsigned char *pa = (const unsigned char *)a;
+	const unsigned char *pb = (const unsigned char *)b;
+	size_t len = ((alen < blen) ? alen : blen);
+	size_t i = 0;
+#if defined(BLOBSEARCH_SSE2)
+	uint32_t mask;
+#endif
+
+	if (pa != pb)
+	{
+#if defined(BLOBSEARCH_SSE2)
+		//skip equal 16 byte blocks; the first differing byte of a block is the lowest clear bit of the equality mask
+		for (; (i + 16) <= len; i += 16)
+		{
+			mask = ((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(pa + i)), _mm_loadu_si128((const __m128i *)(pb + i)))) ^ 0xFFFF);
+			if (mask != 0)
+			{
+				i += blobsearch_ctz(mask);
+				return (((int)pa[i]) - ((int)pb[i]));
+			}
+		}
+#endif
+		for (; i < len; ++i)
+		{
+			if (pa[i] != pb[i])
+			{
+				return (((int)pa[i]) - ((int)pb[i]));
+			}
+		}
+	}
+
+	return ((alen < blen) ? -1 : ((alen > blen) ? 1 : 0));
+}
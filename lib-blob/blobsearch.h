@@ -0,0 +1,16 @@
+#ifndef BLOBSEARCH_H
+#define BLOBSEARCH_H
+
+#include <stddef.h>
+
+//SIMD kernels are chosen at compile time from the instruction set the build targets; see blobsearch.c.
+//All of these return an offset relative to src, or len when nothing was found.
+size_t blobsearch_findbyte(const void *src, size_t len, unsigned char byte);
+size_t blobsearch_find(const void *src, size_t len, const void *needle, size_t needlelen);
+size_t blobsearch_findany(const void *src, size_t len, const void *set, size_t setlen);
+size_t blobsearch_count(const void *src, size_t len, unsigned char byte);
+
+//Lexicographic byte comparison; returns <0, 0 or >0 like memcmp, with the shorter input ordering first on a tie.
+int blobsearch_compare(const void *a, size_t alen, const void *b, size_t blen);
+
+#endif
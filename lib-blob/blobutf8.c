@@ -0,0 +1,458 @@
+//UTF-8 validation and UTF-16LE transcoding; an SSSE3 lookup table validator and SSE2 ASCII blocks when the compiler targets them.
+//There is no runtime dispatch, so a default x86-64 build gets the SSE2 blocks and a scalar validator.
+
+#include "blobutf8.h"
+
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__SSSE3__) || defined(__AVX__)
+	#include <tmmintrin.h>
+	#define BLOBUTF8_SSSE3
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define BLOBUTF8_SSE2
+	#define blobutf8_iszero(v) (_mm_movemask_epi8(_mm_cmpeq_epi8((v), _mm_setzero_si128())) == 0xFFFF)
+#endif
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+static int blobutf8_ctz(uint32_t x)
+{
+	unsigned long i;
+	_BitScanForward(&i, x);
+	return (int)i;
+}
+#elif defined(__GNUC__)
+	#define blobutf8_ctz(x) __builtin_ctz(x)
+#else
+static int blobutf8_ctz(uint32_t x)
+{
+	int i = 0;
+	while (!(x & 1))
+	{
+		x >>= 1;
+		++i;
+	}
+	return i;
+}
+#endif
+
+//Length of the valid sequence at p (which holds len > 0 bytes) with its code point in cp, or 0 if no valid sequence starts there.
+static size_t blobutf8_sequence(const unsigned char *p, size_t len, uint32_t *cp)
+{
+	unsigned char lo = 0x80;
+	unsigned char hi = 0xBF;
+	size_t n;
+	size_t i;
+
+	if (p[0] < 0x80)
+	{
+		*cp = p[0];
+		return 1;
+	}
+	if (p[0] < 0xC2 || p[0] > 0xF4)
+	{
+		return 0;
+	}
+
+	if (p[0] < 0xE0)
+	{
+		n = 2;
+		*cp = (p[0] & 0x1F);
+	}
+	else if (p[0] < 0xF0)
+	{
+		n = 3;
+		*cp = (p[0] & 0x0F);
+		if (p[0] == 0xE0)
+		{
+			lo = 0xA0;		//overlong
+		}
+		else if (p[0] == 0xED)
+		{
+			hi = 0x9F;		//surrogates
+		}
+	}
+	else
+	{
+		n = 4;
+		*cp = (p[0] & 0x07);
+		if (p[0] == 0xF0)
+		{
+			lo = 0x90;		//overlong
+		}
+		else if (p[0] == 0xF4)
+		{
+			hi = 0x8F;		//past U+10FFFF
+		}
+	}
+	if (len < n || p[1] < lo || p[1] > hi)
+	{
+		return 0;
+	}
+
+	*cp = ((*cp << 6) | (p[1] & 0x3F));
+	for (i = 2; i < n; ++i)
+	{
+		if ((p[i] & 0xC0) != 0x80)
+		{
+			return 0;
+		}
+		*cp = ((*cp << 6) | (p[i] & 0x3F));
+	}
+
+	return n;
+}
+
+//Length of the run of ASCII bytes at the start of p.
+static size_t blobutf8_asciirun(const unsigned char *p, size_t len)
+{
+	size_t i = 0;
+	uint64_t w;
+#if defined(BLOBUTF8_SSE2)
+	uint32_t m;
+
+	for (; (i + 16) <= len; i += 16)
+	{
+		m = (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(p + i)));
+		if (m != 0)
+		{
+			return (i + blobutf8_ctz(m));
+		}
+	}
+#endif
+
+	for (; (i + 8) <= len; i += 8)
+	{
+		memcpy(&w, (p + i), 8);
+		if ((w & 0x8080808080808080ULL) != 0)
+		{
+			break;
+		}
+	}
+	while (i < len && p[i] < 0x80)
+	{
+		++i;
+	}
+
+	return i;
+}
+
+static size_t blobutf8_validatescalar(const unsigned char *p, size_t len)
+{
+	uint32_t cp;
+	size_t i = 0;
+	size_t n;
+
+	while (i < len)
+	{
+		i += blobutf8_asciirun((p + i), (len - i));
+		if (i == len)
+		{
+			break;
+		}
+
+		n = blobutf8_sequence((p + i), (len - i), &cp);
+		if (n == 0)
+		{
+			return i;
+		}
+		i += n;
+	}
+
+	return len;
+}
+
+#if defined(BLOBUTF8_SSSE3)
+//Where a sequence that may run across offset i starts: the lead byte among the three bytes before it, or i itself.
+static size_t blobutf8_boundary(const unsigned char *p, size_t i)
+{
+	size_t k;
+
+	for (k = 1; k <= 3 && k <= i; ++k)
+	{
+		if (p[i - k] >= 0xC0)
+		{
+			return (i - k);
+		}
+		if (p[i - k] < 0x80)
+		{
+			break;
+		}
+	}
+
+	return i;
+}
+
+//Keiser and Lemire's validator: three nibble lookups classify every byte pair, and the only errors left over are continuation bytes
+//that a three or four byte lead two or three bytes back requires. Each error class is one bit, so a clean block ANDs down to zero.
+#define BLOBUTF8_TOO_SHORT (1 << 0)
+#define BLOBUTF8_TOO_LONG (1 << 1)
+#define BLOBUTF8_OVERLONG_3 (1 << 2)
+#define BLOBUTF8_TOO_LARGE (1 << 3)
+#define BLOBUTF8_SURROGATE (1 << 4)
+#define BLOBUTF8_OVERLONG_2 (1 << 5)
+#define BLOBUTF8_TOO_LARGE_1000 (1 << 6)
+#define BLOBUTF8_OVERLONG_4 (1 << 6)
+#define BLOBUTF8_TWO_CONTS (1 << 7)
+#define BLOBUTF8_CARRY (BLOBUTF8_TOO_SHORT | BLOBUTF8_TOO_LONG | BLOBUTF8_TWO_CONTS)
+
+static __m128i blobutf8_checkblock(__m128i input, __m128i prev)
+{
+	const __m128i nibble = _mm_set1_epi8(0x0F);
+	const __m128i byte1high = _mm_setr_epi8(
+		BLOBUTF8_TOO_LONG, BLOBUTF8_TOO_LONG, BLOBUTF8_TOO_LONG, BLOBUTF8_TOO_LONG,
+		BLOBUTF8_TOO_LONG, BLOBUTF8_TOO_LONG, BLOBUTF8_TOO_LONG, BLOBUTF8_TOO_LONG,
+		BLOBUTF8_TWO_CONTS, BLOBUTF8_TWO_CONTS, BLOBUTF8_TWO_CONTS, BLOBUTF8_TWO_CONTS,
+		(BLOBUTF8_TOO_SHORT | BLOBUTF8_OVERLONG_2),
+		BLOBUTF8_TOO_SHORT,
+		(BLOBUTF8_TOO_SHORT | BLOBUTF8_OVERLONG_3 | BLOBUTF8_SURROGATE),
+		(char)(BLOBUTF8_TOO_SHORT | BLOBUTF8_TOO_LARGE | BLOBUTF8_TOO_LARGE_1000 | BLOBUTF8_OVERLONG_4));
+	const __m128i byte1low = _mm_setr_epi8(
+		(BLOBUTF8_CARRY | BLOBUTF8_OVERLONG_3 | BLOBUTF8_OVERLONG_2 | BLOBUTF8_OVERLONG_4),
+		(BLOBUTF8_CARRY | BLOBUTF8_OVERLONG_2),
+		BLOBUTF8_CARRY,
+		BLOBUTF8_CARRY,
+		(BLOBUTF8_CARRY | BLOBUTF8_TOO_LARGE),
+		(BLOBUTF8_CARRY | BLOBUTF8_TOO_LARGE | BLOBUTF8_TOO_LARGE_1000),
+		(BLOBUTF8_CARRY | BLOBUTF8_TOO_LARGE | BLOBUTF8_TOO_LARGE_1000),
+		(BLOBUTF8_CARRY | BLOBUTF8_TOO_LARGE | BLOBUTF8_TOO_LARGE_1000),
+		(BLOBUTF8_CARRY | BLOBUTF8_TOO_LARGE | BLOBUTF8_TOO_LARGE_1000),
+		(BLOBUTF8_CARRY | BLOBUTF8_TOO_LARGE | BLOBUTF8_TOO_LARGE_1000),
+		(BLOBUTF8_CARRY | BLOBUTF8_TOO_LARGE | BLOBUTF8_TOO_LARGE_1000),
+		(BLOBUTF8_CARRY | BLOBUTF8_TOO_LARGE | BLOBUTF8_TOO_LARGE_1000),
+		(BLOBUTF8_CARRY | BLOBUTF8_TOO_LARGE | BLOBUTF8_TOO_LARGE_1000),
+		(BLOBUTF8_CARRY | BLOBUTF8_TOO_LARGE | BLOBUTF8_TOO_LARGE_1000 | BLOBUTF8_SURROGATE),
+		(BLOBUTF8_CARRY | BLOBUTF8_TOO_LARGE | BLOBUTF8_TOO_LARGE_1000),
+		(BLOBUTF8_CARRY | BLOBUTF8_TOO_LARGE | BLOBUTF8_TOO_LARGE_1000));
+	const __m128i byte2high = _mm_setr_epi8(
+		BLOBUTF8_TOO_SHORT, BLOBUTF8_TOO_SHORT, BLOBUTF8_TOO_SHORT, BLOBUTF8_TOO_SHORT,
+		BLOBUTF8_TOO_SHORT, BLOBUTF8_TOO_SHORT, BLOBUTF8_TOO_SHORT, BLOBUTF8_TOO_SHORT,
+		(char)(BLOBUTF8_TOO_LONG | BLOBUTF8_OVERLONG_2 | BLOBUTF8_TWO_CONTS | BLOBUTF8_OVERLONG_3 | BLOBUTF8_TOO_LARGE_1000 | BLOBUTF8_OVERLONG_4),
+		(char)(BLOBUTF8_TOO_LONG | BLOBUTF8_OVERLONG_2 | BLOBUTF8_TWO_CONTS | BLOBUTF8_OVERLONG_3 | BLOBUTF8_TOO_LARGE),
+		(char)(BLOBUTF8_TOO_LONG | BLOBUTF8_OVERLONG_2 | BLOBUTF8_TWO_CONTS | BLOBUTF8_SURROGATE | BLOBUTF8_TOO_LARGE),
+		(char)(BLOBUTF8_TOO_LONG | BLOBUTF8_OVERLONG_2 | BLOBUTF8_TWO_CONTS | BLOBUTF8_SURROGATE | BLOBUTF8_TOO_LARGE),
+		BLOBUTF8_TOO_SHORT, BLOBUTF8_TOO_SHORT, BLOBUTF8_TOO_SHORT, BLOBUTF8_TOO_SHORT);
+	__m128i prev1;
+	__m128i special;
+	__m128i third;
+	__m128i fourth;
+
+	prev1 = _mm_alignr_epi8(input, prev, 15);
+	special = _mm_and_si128(
+		_mm_and_si128(
+			_mm_shuffle_epi8(byte1high, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+			_mm_shuffle_epi8(byte1low, _mm_and_si128(prev1, nibble))),
+		_mm_shuffle_epi8(byte2high, _mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+
+	//the high bit of these is set where a three (four) byte lead sits two (three) bytes back
+	third = _mm_subs_epu8(_mm_alignr_epi8(input, prev, 14), _mm_set1_epi8((char)(0xE0 - 0x80)));
+	fourth = _mm_subs_epu8(_mm_alignr_epi8(input, prev, 13), _mm_set1_epi8((char)(0xF0 - 0x80)));
+
+	return _mm_xor_si128(_mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8((char)0x80)), special);
+}
+
+//Validates whole 16 byte blocks; returns where the scalar validator has to take over, which is either the tail or the sequence
+//that contains the first error.
+static size_t blobutf8_validateblocks(const unsigned char *p, size_t len)
+{
+	//a block ends in the middle of a sequence when one of its last three bytes leads a longer one
+	const __m128i maxtail = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+	__m128i prev = _mm_setzero_si128();
+	__m128i incomplete = _mm_setzero_si128();
+	__m128i input;
+	size_t i;
+
+	for (i = 0; (i + 16) <= len; i += 16)
+	{
+		input = _mm_loadu_si128((const __m128i *)(p + i));
+		if (_mm_movemask_epi8(input) == 0)
+		{
+			if (!blobutf8_iszero(incomplete))
+			{
+				return blobutf8_boundary(p, i);
+			}
+		}
+		else
+		{
+			if (!blobutf8_iszero(blobutf8_checkblock(input, prev)))
+			{
+				return blobutf8_boundary(p, i);
+			}
+			incomplete = _mm_subs_epu8(input, maxtail);
+		}
+		prev = input;
+	}
+
+	return blobutf8_boundary(p, i);
+}
+#endif
+
+size_t blobutf8_validate(const void *src, size_t len)
+{
+	const unsigned char *p = (const unsigned char *)src;
+	size_t i = 0;
+
+#if defined(BLOBUTF8_SSSE3)
+	i = blobutf8_validateblocks(p, len);
+#endif
+
+	return (i + blobutf8_validatescalar((p + i), (len - i)));
+}
+
+size_t blobutf8_toutf16le(const char *src, size_t len, void *dest)
+{
+	const unsigned char *p = (const unsigned char *)src;
+	unsigned char *out = (unsigned char *)dest;
+	uint32_t cp;
+	size_t i = 0;
+	size_t o = 0;
+	size_t n;
+#if defined(BLOBUTF8_SSE2)
+	__m128i block;
+	uint32_t m;
+#endif
+
+	while (i < len)
+	{
+#if defined(BLOBUTF8_SSE2)
+		//ASCII widens by interleaving with zero bytes; the whole block is always stored (the output has room for it, at two bytes per
+		//byte still to come) but only its leading ASCII run is kept, so mixed text gains as well
+		while ((len - i) >= 16)
+		{
+			block = _mm_loadu_si128((const __m128i *)(p + i));
+			_mm_storeu_si128((__m128i *)(out + o), _mm_unpacklo_epi8(block, _mm_setzero_si128()));
+			_mm_storeu_si128((__m128i *)(out + o + 16), _mm_unpackhi_epi8(block, _mm_setzero_si128()));
+			m = (uint32_t)_mm_movemask_epi8(block);
+			if (m != 0)
+			{
+				n = (size_t)blobutf8_ctz(m);
+				i += n;
+				o += (n * 2);
+				break;
+			}
+			i += 16;
+			o += 32;
+		}
+		if (i == len)
+		{
+			break;
+		}
+#endif
+
+		n = blobutf8_sequence((p + i), (len - i), &cp);
+		if (n == 0)
+		{
+			return ((size_t)-1);
+		}
+		i += n;
+
+		if (cp >= 0x10000)
+		{
+			cp -= 0x10000;
+			out[o] = (unsigned char)(cp >> 10);
+			out[o + 1] = (unsigned char)(0xD8 | (cp >> 18));
+			out[o + 2] = (unsigned char)cp;
+			out[o + 3] = (unsigned char)(0xDC | ((cp >> 8) & 0x03));
+			o += 4;
+		}
+		else
+		{
+			out[o] = (unsigned char)cp;
+			out[o + 1] = (unsigned char)(cp >> 8);
+			o += 2;
+		}
+	}
+
+	return o;
+}
+
+size_t blobutf8_fromutf16le(const char *src, size_t len, void *dest)
+{
+	const unsigned char *p = (const unsigned char *)src;
+	unsigned char *out = (unsigned char *)dest;
+	uint32_t cp;
+	uint32_t low;
+	size_t i = 0;
+	size_t o = 0;
+#if defined(BLOBUTF8_SSE2)
+	__m128i block;
+	size_t n;
+	uint32_t m;
+#endif
+
+	if ((len & 1) != 0)
+	{
+		return ((size_t)-1);
+	}
+
+	while (i < len)
+	{
+#if defined(BLOBUTF8_SSE2)
+		//ASCII units narrow to bytes with a saturating pack; as above, only the leading ASCII run of the stored block is kept
+		while ((len - i) >= 16)
+		{
+			block = _mm_loadu_si128((const __m128i *)(p + i));
+			_mm_storel_epi64((__m128i *)(out + o), _mm_packus_epi16(block, block));
+			m = ((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(block, _mm_set1_epi16((short)0xFF80)), _mm_setzero_si128())) ^ 0xFFFF);
+			if (m != 0)
+			{
+				n = ((size_t)blobutf8_ctz(m) / 2);
+				i += (n * 2);
+				o += n;
+				break;
+			}
+			i += 16;
+			o += 8;
+		}
+		if (i == len)
+		{
+			break;
+		}
+#endif
+
+		cp = (((uint32_t)p[i]) | (((uint32_t)p[i + 1]) << 8));
+		i += 2;
+		if (cp >= 0xD800 && cp <= 0xDFFF)
+		{
+			if (cp >= 0xDC00 || i == len)
+			{
+				return ((size_t)-1);
+			}
+			low = (((uint32_t)p[i]) | (((uint32_t)p[i + 1]) << 8));
+			if (low < 0xDC00 || low > 0xDFFF)
+			{
+				return ((size_t)-1);
+			}
+			i += 2;
+			cp = (0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00));
+		}
+
+		if (cp < 0x80)
+		{
+			out[o++] = (unsigned char)cp;
+		}
+		else if (cp < 0x800)
+		{
+			out[o++] = (unsigned char)(0xC0 | (cp >> 6));
+			out[o++] = (unsigned char)(0x80 | (cp & 0x3F));
+		}
+		else if (cp < 0x10000)
+		{
+			out[o++] = (unsigned char)(0xE0 | (cp >> 12));
+			out[o++] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+			out[o++] = (unsigned char)(0x80 | (cp & 0x3F));
+		}
+		else
+		{
+			out[o++] = (unsigned char)(0xF0 | (cp >> 18));
+			out[o++] = (unsigned char)(0x80 | ((cp >> 12) & 0x3F));
+			out[o++] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+			out[o++] = (unsigned char)(0x80 | (cp & 0x3F));
+		}
+	}
+
+	return o;
+}
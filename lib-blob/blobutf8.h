@@ -0,0 +1,17 @@
+#ifndef BLOBUTF8_H
+#define BLOBUTF8_H
+
+#include <stddef.h>
+
+#define blobutf8_utf16max(len) ((len) * 2)			//upper bound on the UTF-16LE size of len bytes of UTF-8
+#define blobutf8_utf8max(len) (((len) / 2) * 3)		//upper bound on the UTF-8 size of len bytes of UTF-16LE
+
+//Strict UTF-8 (no overlong forms, surrogates or code points past U+10FFFF); returns len when valid,
+//otherwise the offset of the first byte that does not start a valid sequence.
+size_t blobutf8_validate(const void *src, size_t len);
+
+//Both return the converted size, or (size_t)-1 on malformed input (including an odd UTF-16LE length or an unpaired surrogate).
+size_t blobutf8_toutf16le(const char *src, size_t len, void *dest);
+size_t blobutf8_fromutf16le(const char *src, size_t len, void *dest);
+
+#endif
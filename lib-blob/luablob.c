@@ -1,9 +1,32 @@
 #define LUABLOB_LIB
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+	#define _GNU_SOURCE		//mremap
+#endif
 #include "luablob.h"
+#include "blobsearch.h"
+#include "blobcompress.h"
+#include "blobencode.h"
+#include "blobbits.h"
+#include "blobnumber.h"
+#include "blobutf8.h"
 #include <lauxlib.h>
+#include <stdio.h>
 #include <string.h>
+#include <limits.h>
 #include <stdint.h>
 
+#if defined(_WIN32)
+	#include <windows.h>
+	#define LUABLOB_MAPFILE
+#elif defined(__unix__) || defined(__APPLE__)
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#define LUABLOB_MAPFILE
+#endif
+
 #ifdef MSVC_VER
 	#define LUA_CFUNCTION_F int __cdecl
 #else
@@ -12,6 +35,83 @@
 
 #define ptradd(p, o) ((void *)(((char *)(p)) + (o)))
 
+//True when [offset, offset + size) lies within limit bytes; written so that offset + size can never wrap.
+#define luablob_inbounds(offset, size, limit) ((offset) <= (limit) && (size) <= ((limit) - (offset)))
+
+//Byte swapping for the explicit endianness types; these compile down to single bswap instructions where the compiler offers them.
+#if defined(_MSC_VER)
+	#include <stdlib.h>
+	#define luablob_bswap16(x) _byteswap_ushort(x)
+	#define luablob_bswap32(x) _byteswap_ulong(x)
+	#define luablob_bswap64(x) _byteswap_uint64(x)
+#elif defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 8))
+	#define luablob_bswap16(x) __builtin_bswap16(x)
+	#define luablob_bswap32(x) __builtin_bswap32(x)
+	#define luablob_bswap64(x) __builtin_bswap64(x)
+#else
+	#define luablob_bswap16(x) ((uint16_t)((((uint16_t)(x)) >> 8) | (((uint16_t)(x)) << 8)))
+	#define luablob_bswap32(x) ((((uint32_t)(x)) >> 24) | ((((uint32_t)(x)) >> 8) & 0xFF00) | ((((uint32_t)(x)) << 8) & 0xFF0000) | (((uint32_t)(x)) << 24))
+	#define luablob_bswap64(x) ((((uint64_t)luablob_bswap32((uint32_t)(x))) << 32) | ((uint64_t)luablob_bswap32((uint32_t)(((uint64_t)(x)) >> 32))))
+#endif
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	#define LUABLOB_BIGENDIAN 1
+#else
+	#define LUABLOB_BIGENDIAN 0
+#endif
+
+//A view is a blob whose data lives inside another blob; it holds a reference to its parent so the storage outlives it.
+typedef struct luablob_viewinfo_s
+{
+	lua_State *L;
+	GenericMemoryBlob *parent;
+	size_t start;
+	int parentref;
+} luablob_viewinfo;
+
+size_t luablob_view_realloc(GenericMemoryBlob *blob, size_t nsize)
+{
+	//views are fixed windows; they may shrink but never grow past their original length
+	if (nsize > blob->allocsize)
+	{
+		return 0;
+	}
+
+	return blob->allocsize;
+}
+void luablob_view_free(GenericMemoryBlob *blob)
+{
+	luablob_viewinfo *info;
+	void *allocud = NULL;
+
+	info = (luablob_viewinfo *)blob->userdata;
+
+	lua_pushliteral(info->L, "luablob_parentref");	//STACK: ? 'luablob_parentref'
+	lua_gettable(info->L, LUA_REGISTRYINDEX);		//STACK: ? luablob_parentref
+	luaL_unref(info->L, -1, info->parentref);
+	lua_pop(info->L, 1);							//STACK: ?
+
+	lua_getallocf(info->L, &allocud)(allocud, info, sizeof(luablob_viewinfo), 0);
+}
+
+//Re-points a view at its parent's current storage, which may have moved since the view was last used.
+void luablob_view_sync(lua_State *L, GenericMemoryBlob *gmb)
+{
+	luablob_viewinfo *info;
+
+	info = (luablob_viewinfo *)gmb->userdata;
+	if (info->parent->data == NULL)
+	{
+		luaL_error(L, "unable to use view of freed blob");
+	}
+	if (!luablob_inbounds(info->start, gmb->usedsize, info->parent->usedsize))
+	{
+		luaL_error(L, "unable to use view; parent blob no longer contains the viewed range");
+	}
+
+	gmb->data = ptradd(info->parent->data, info->start);
+}
+
 LUA_CFUNCTION_F lua_luablob_mt___len(lua_State *L)
 {	//STACK: gmb ?
 	lua_pushinteger(L, (lua_Integer)(luablob_checkgmb(L, 1)->usedsize));	//STACK: u ? usedsize
@@ -23,28 +123,53 @@ LUA_CFUNCTION_F lua_luablob_mt___eq(lua_State *L)
 	GenericMemoryBlob *gmba;
 	GenericMemoryBlob *gmbb;
 
+	//== must not raise on freed blobs, so they are looked at before luablob_checkgmb would reject them; a freed blob only equals itself
 	gmba = (GenericMemoryBlob *)luaL_checkudata(L, 1, "luablob_mt");
 	gmbb = (GenericMemoryBlob *)luaL_checkudata(L, 2, "luablob_mt");
-
-	if (
-		(gmba == gmbb) ||
-		(
-			(gmba->data != NULL) &&
-			(gmba->data == gmbb->data)
-		)
-	)
+	if (gmba == gmbb || gmba->data == NULL || gmbb->data == NULL)
 	{
-		lua_pushboolean(L, 1);	//STACK: gmba gmbb true
-		return 1;				//RETURN: true
+		lua_pushboolean(L, (gmba == gmbb));	//STACK: gmba gmbb result
+		return 1;							//RETURN: result
 	}
+	gmba = luablob_checkgmb(L, 1);
+	gmbb = luablob_checkgmb(L, 2);
 
 	if (gmba->usedsize != gmbb->usedsize)
 	{
 		lua_pushboolean(L, 0);	//STACK: gmba gmbb false
 		return 1;				//RETURN: false
 	}
+	if (gmba->data == gmbb->data)
+	{
+		lua_pushboolean(L, 1);	//STACK: gmba gmbb true
+		return 1;				//RETURN: true
+	}
+
+	lua_pushboolean(L, (blobsearch_compare(gmba->data, gmba->usedsize, gmbb->data, gmbb->usedsize) == 0));	//STACK: gmba gmbb result
+	return 1;					//RETURN: result
+}
+
+LUA_CFUNCTION_F lua_luablob_mt___lt(lua_State *L)
+{	//STACK: gmba gmbb
+	GenericMemoryBlob *gmba;
+	GenericMemoryBlob *gmbb;
 
-	lua_pushboolean(L, (memcmp(gmba, gmbb, gmba->usedsize) == 0));	//STACK: u v result
+	gmba = luablob_checkgmb(L, 1);
+	gmbb = luablob_checkgmb(L, 2);
+
+	lua_pushboolean(L, (blobsearch_compare(gmba->data, gmba->usedsize, gmbb->data, gmbb->usedsize) < 0));	//STACK: gmba gmbb result
+	return 1;					//RETURN: result
+}
+
+LUA_CFUNCTION_F lua_luablob_mt___le(lua_State *L)
+{	//STACK: gmba gmbb
+	GenericMemoryBlob *gmba;
+	GenericMemoryBlob *gmbb;
+
+	gmba = luablob_checkgmb(L, 1);
+	gmbb = luablob_checkgmb(L, 2);
+
+	lua_pushboolean(L, (blobsearch_compare(gmba->data, gmba->usedsize, gmbb->data, gmbb->usedsize) <= 0));	//STACK: gmba gmbb result
 	return 1;					//RETURN: result
 }
 
@@ -53,6 +178,10 @@ LUA_CFUNCTION_F lua_luablob_mt___tostring(lua_State *L)
 	GenericMemoryBlob *gmb;
 
 	gmb = (GenericMemoryBlob *)luaL_checkudata(L, 1, "luablob_mt");
+	if (gmb->data != NULL && gmb->free == &luablob_view_free)
+	{
+		luablob_view_sync(L, gmb);
+	}
 	if (gmb->data == NULL || gmb->usedsize == 0)
 	{
 		lua_pushliteral(L, "{empty blob}");	//STACK: u ? '{empty blob}'
@@ -78,33 +207,56 @@ LUA_CFUNCTION_F  lua_luablob_mt___gc(lua_State *L)
 	return 1;
 }
 
+//Allocation mode used when none is given; see lua_blob_setdefaultmode.
+const char *const luablob_allocmodes[] = { "basic", "tight", "loose", "geometric", "pool", "aligned", "hugepage", NULL };
+const char *luablob_defaultmode = "basic";
+
+//Growth settings for the 'geometric' allocation mode; see lua_blob_setgrowth.
+size_t luablob_geometric_percent = 100;			//each reallocation grows the allocation by this percentage (100 = 2x)
+size_t luablob_geometric_cap = 0x4000000;		//but never by more than this many bytes at once (64mb)
+
 size_t luablob_lua_realloc_basic(GenericMemoryBlob *blob, size_t nsize)
 {
 	void *allocud = NULL;
+	void *data;
 
 	if ((nsize < blob->usedsize) || (nsize == 0))
 	{
 		return blob->allocsize;
 	}
 
-	blob->data = lua_getallocf(((lua_State *)blob->userdata), &allocud)(allocud, blob->data, blob->allocsize, nsize);
-	return ((blob->data == NULL) ? 0 : nsize);
+	data = lua_getallocf(((lua_State *)blob->userdata), &allocud)(allocud, blob->data, blob->allocsize, nsize);
+	if (data == NULL)
+	{
+		return 0;
+	}
+
+	blob->data = data;
+	return nsize;
 }
 size_t luablob_lua_realloc_tight(GenericMemoryBlob *blob, size_t nsize)
 {
 	void *allocud = NULL;
+	void *data;
 
 	if (nsize == 0)
 	{
 		return blob->allocsize;
 	}
 
-	blob->data = lua_getallocf(((lua_State *)blob->userdata), &allocud)(allocud, blob->data, blob->allocsize, nsize);
-	return ((blob->data == NULL) ? 0 : nsize);
+	data = lua_getallocf(((lua_State *)blob->userdata), &allocud)(allocud, blob->data, blob->allocsize, nsize);
+	if (data == NULL)
+	{
+		return 0;
+	}
+
+	blob->data = data;
+	return nsize;
 }
 size_t luablob_lua_realloc_loose(GenericMemoryBlob *blob, size_t nsize)
 {
 	void *allocud = NULL;
+	void *data;
 	size_t size;
 
 	if ((nsize < blob->usedsize) || (nsize == 0))
@@ -112,15 +264,23 @@ size_t luablob_lua_realloc_loose(GenericMemoryBlob *blob, size_t nsize)
 		return blob->allocsize;
 	}
 
-	//Round to nearest 4kb boundary.
-	size = ((nsize ^ 0x1000) & 0x0FFF);
+	//Round up to the next 4kb boundary.
+	size = ((nsize + 0x0FFF) & ~((size_t)0x0FFF));
+	if (size < nsize)
+	{
+		size = nsize;
+	}
+	if (size == blob->allocsize)
+	{
+		return size;
+	}
 
-	blob->data = lua_getallocf(((lua_State *)blob->userdata), &allocud)(allocud, blob->data, blob->allocsize, size);
-	if (blob->data == NULL)
+	data = lua_getallocf(((lua_State *)blob->userdata), &allocud)(allocud, blob->data, blob->allocsize, size);
+	if (data == NULL)
 	{
 		if (blob->allocsize >= nsize)
 		{
-			return nsize;
+			return blob->allocsize;
 		}
 		else
 		{
@@ -128,864 +288,5929 @@ size_t luablob_lua_realloc_loose(GenericMemoryBlob *blob, size_t nsize)
 		}
 	}
 
+	blob->data = data;
 	return size;
 }
-void luablob_lua_free(GenericMemoryBlob *blob)
+size_t luablob_lua_realloc_geometric(GenericMemoryBlob *blob, size_t nsize)
 {
 	void *allocud = NULL;
-	lua_getallocf(((lua_State *)blob->userdata), &allocud)(allocud, blob->data, blob->allocsize, 0);
-}
+	void *data;
+	size_t step;
+	size_t size;
 
-LUABLOB_API(void) luablob_newgmb(lua_State *L, GenericMemoryBlob *gmb, size_t initialsize, const char *allocmode)
-{
-	if (initialsize <= 0)
+	if ((nsize < blob->usedsize) || (nsize == 0))
 	{
-		luaL_error(L, "argument out of range; initial size must be greater than 0.");
+		return blob->allocsize;
+	}
+	if (nsize <= blob->allocsize)
+	{
+		return blob->allocsize;
 	}
 
-	if (strcmp(allocmode, "basic") == 0)
+	//Grow by a fixed fraction of the current allocation so that repeated appends cost amortized O(1).
+	step = (((blob->allocsize / 100) * luablob_geometric_percent) + (((blob->allocsize % 100) * luablob_geometric_percent) / 100));
+	if (step > luablob_geometric_cap)
 	{
-		gmb->realloc = &luablob_lua_realloc_basic;
+		step = luablob_geometric_cap;
 	}
-	else if (strcmp(allocmode, "tight") == 0)
+	size = (blob->allocsize + step);
+	if (size < nsize || size < blob->allocsize)
 	{
-		gmb->realloc = &luablob_lua_realloc_tight;
+		size = nsize;
 	}
-	else if (strcmp(allocmode, "loose") == 0)
+
+	data = lua_getallocf(((lua_State *)blob->userdata), &allocud)(allocud, blob->data, blob->allocsize, size);
+	if (data == NULL && size != nsize)
 	{
-		gmb->realloc = &luablob_lua_realloc_loose;
+		//fall back to an exact fit before giving up
+		size = nsize;
+		data = lua_getallocf(((lua_State *)blob->userdata), &allocud)(allocud, blob->data, blob->allocsize, size);
 	}
-	else
+	if (data == NULL)
 	{
-		luaL_error(L, "invalid argument; allocation mode '%s' is not supported; valid values are 'basic', 'tight', 'loose'");
+		return 0;
 	}
 
-	gmb->free = &luablob_lua_free;
-	gmb->usedsize = 0;
-	gmb->userdata = (void *)L;
-	gmb->allocsize = 0;
-	gmb->usedsize = 0;
-	gmb->data = NULL;
+	blob->data = data;
+	return size;
+}
+void luablob_lua_free(GenericMemoryBlob *blob)
+{
+	void *allocud = NULL;
+	lua_getallocf(((lua_State *)blob->userdata), &allocud)(allocud, blob->data, blob->allocsize, 0);
+}
 
-	if (!gmb_realloc(gmb, initialsize))
+//The 'aligned' and 'hugepage' allocation modes keep data on a LUABLOB_ALIGN boundary so SIMD kernels can use aligned loads.
+//The raw allocation starts a little before data; a small header just below data records where it starts and how it was obtained.
+#define LUABLOB_ALIGN 64				//cache line and AVX-512 vector width
+#define LUABLOB_ALIGN_PAD (2 * LUABLOB_ALIGN)	//room for the header plus the worst case misalignment of lua_Alloc
+#define LUABLOB_HUGEPAGE 0x200000		//2mb transparent huge pages
+
+#if defined(__linux__) && defined(MAP_ANONYMOUS) && defined(MADV_HUGEPAGE)
+	#define LUABLOB_HUGEPAGES
+#endif
+
+typedef struct luablob_alignhdr_s
+{
+	void *base;
+	size_t rawsize;
+	int mapped;		//base came from mmap rather than lua_Alloc
+} luablob_alignhdr;
+
+#define luablob_alignhdr_of(data) ((luablob_alignhdr *)ptradd((data), -(ptrdiff_t)sizeof(luablob_alignhdr)))
+
+//Blobs in the 'hugepage' mode at least this large are backed by anonymous mappings advised for huge pages; see lua_blob_sethugepages.
+size_t luablob_hugepage_threshold = LUABLOB_HUGEPAGE;
+
+size_t luablob_aligned_resize(GenericMemoryBlob *blob, size_t nsize, int huge)
+{
+	void *allocud = NULL;
+	lua_Alloc alloc;
+	luablob_alignhdr old;
+	luablob_alignhdr *hdr;
+	char *raw;
+	size_t rawsize;
+	size_t offset;
+
+	if ((nsize < blob->usedsize) || (nsize == 0))
 	{
-		luaL_error(L, "failed to allocate initial blob memory");
+		return blob->allocsize;
+	}
+	if (nsize > (SIZE_MAX - LUABLOB_ALIGN_PAD - LUABLOB_HUGEPAGE))
+	{
+		return 0;
 	}
-}
-
-LUA_CFUNCTION_F lua_blob_newblob(lua_State *L)
-{	//STACK: initialsize? allocmode? ?
-	size_t initialsize;
-	const char *allocmode;
-	GenericMemoryBlob gmb;
 
-	if (lua_gettop(L) > 0)
+	alloc = lua_getallocf(((lua_State *)blob->userdata), &allocud);
+	if (blob->data != NULL)
 	{
-		switch (lua_type(L, 1))
-		{
-			case LUA_TNUMBER:
-				initialsize = luaL_checkint(L, 1);
-				if (lua_gettop(L) > 1)
-				{
-					allocmode = luaL_checkstring(L, 2);
-				}
-				else
-				{
-					allocmode = "basic";
-				}
-				break;
-			case LUA_TSTRING:
-				allocmode = luaL_checkstring(L, 1);
-				initialsize = sizeof(lua_Number);
-				break;
-			default:
-				luaL_error(L, "invalid argument; expected allocation size (number) or allocation mode (string)");
-		}
+		old = *luablob_alignhdr_of(blob->data);
 	}
 	else
 	{
-		initialsize = sizeof(lua_Number);
-		allocmode = "basic";
+		old.base = NULL;
+		old.rawsize = 0;
+		old.mapped = 0;
 	}
 
-	luablob_newgmb(L, &gmb, initialsize, allocmode);
-	luablob_pushgmb(L, gmb);	//STACK: initialsize? allocmode? ? gmb
-
-	return 1;					//RETURN: gmb
-}
-
-void lua_blob_read_type(lua_State *L, GenericMemoryBlob *gmb, unsigned int *offset, const char *type)
-{	//STACK:	start:	?
-	//			end:	? value
-	unsigned int size;
-	unsigned int i;
-	const char *str;
-
-	luaL_checkstack(L, 1, NULL);
-
-	if (strcmp(type, "cstr") == 0)
+#ifdef LUABLOB_HUGEPAGES
+	if (huge && nsize >= luablob_hugepage_threshold)
 	{
-		str = (const char *)gmb->data;
-		for (i = *offset; i < gmb->usedsize; i += sizeof(char))
+		//Whole huge pages; data sits one alignment unit into the mapping with the header just below it.
+		rawsize = ((nsize + LUABLOB_ALIGN + (LUABLOB_HUGEPAGE - 1)) & ~((size_t)(LUABLOB_HUGEPAGE - 1)));
+		if (old.mapped && rawsize == old.rawsize)
 		{
-			if (*(str + i) == '\0')
-			{
-				lua_pushstring(L, (str + *offset));
-				return;
-			}
+			return (rawsize - LUABLOB_ALIGN);
 		}
 
-		luaL_error(L, "unable to read data; bounds out of range");
-	}
-	else if (strcmp(type, "u8str") == 0)
-	{
-		if ((*offset + sizeof(uint8_t)) > gmb->usedsize)
+		if (old.mapped)
 		{
-			luaL_error(L, "unable to read data; bounds out of range");
+			raw = (char *)mremap(old.base, old.rawsize, rawsize, MREMAP_MAYMOVE);
 		}
-		size = *((uint8_t *)ptradd(gmb->data, *offset));
-		*offset += sizeof(uint8_t);
-
-		if ((*offset + size) > gmb->usedsize)
+		else
 		{
-			luaL_error(L, "unable to read data; string length out of range");
+			raw = (char *)mmap(NULL, rawsize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
 		}
-		lua_pushlstring(L, ((const char *)ptradd(gmb->data, *offset)), (size_t)size);
-		*offset += size;
-	}
-	else if (strcmp(type, "u16str") == 0)
-	{
-		if ((*offset + sizeof(uint16_t)) > gmb->usedsize)
+		if (raw == (char *)MAP_FAILED)
 		{
-			luaL_error(L, "unable to read data; bounds out of range");
+			return 0;
 		}
-		size = *((uint16_t *)ptradd(gmb->data, *offset));
-		*offset += sizeof(uint16_t);
+		madvise(raw, rawsize, MADV_HUGEPAGE);	//only advice; without THP support the mapping simply uses normal pages
 
-		if ((*offset + size) > gmb->usedsize)
+		if (!old.mapped && blob->data != NULL)
 		{
-			luaL_error(L, "unable to read data; string length out of range");
+			memcpy(raw + LUABLOB_ALIGN, blob->data, blob->usedsize);
+			alloc(allocud, old.base, old.rawsize, 0);
 		}
-		lua_pushlstring(L, ((const char *)ptradd(gmb->data, *offset)), (size_t)size);
-		*offset += size;
+
+		hdr = luablob_alignhdr_of(raw + LUABLOB_ALIGN);
+		hdr->base = raw;
+		hdr->rawsize = rawsize;
+		hdr->mapped = 1;
+		blob->data = (raw + LUABLOB_ALIGN);
+		return (rawsize - LUABLOB_ALIGN);
 	}
-	else if (strcmp(type, "u32str") == 0)
-	{
-		if ((*offset + sizeof(uint32_t)) > gmb->usedsize)
-		{
-			luaL_error(L, "unable to read data; bounds out of range");
-		}
-		size = *((uint32_t *)ptradd(gmb->data, *offset));
-		*offset += sizeof(uint32_t);
+#endif
 
-		if ((*offset + size) > gmb->usedsize)
-		{
-			luaL_error(L, "unable to read data; string length out of range");
-		}
-		lua_pushlstring(L, ((const char *)ptradd(gmb->data, *offset)), (size_t)size);
-		*offset += size;
+	rawsize = (nsize + LUABLOB_ALIGN_PAD);
+	if (old.mapped)
+	{
+		//shrinking below the threshold; move back to the heap
+		raw = (char *)alloc(allocud, NULL, 0, rawsize);
 	}
-	else if (strcmp(type, "char") == 0)
+	else
 	{
-		if ((*offset + sizeof(char)) > gmb->usedsize)
-		{
-			luaL_error(L, "unable to read data; bounds out of range");
-		}
-		lua_pushlstring(L, ((const char *)ptradd(gmb->data, *offset)), sizeof(char));
-		*offset += sizeof(char);
+		raw = (char *)alloc(allocud, old.base, old.rawsize, rawsize);
 	}
-	else if (strcmp(type, "i8") == 0)
+	if (raw == NULL)
 	{
-		if ((*offset + sizeof(int8_t)) > gmb->usedsize)
-		{
-			luaL_error(L, "unable to read data; bounds out of range");
-		}
-		lua_pushinteger(L, (lua_Integer)(*((int8_t *)ptradd(gmb->data, *offset))));
-		*offset += sizeof(char);
+		return 0;
 	}
-	else if (strcmp(type, "u8") == 0)
+
+	offset = (size_t)((((uintptr_t)raw + sizeof(luablob_alignhdr) + (LUABLOB_ALIGN - 1)) & ~((uintptr_t)(LUABLOB_ALIGN - 1))) - (uintptr_t)raw);
+	if (old.mapped)
 	{
-		if ((*offset + sizeof(uint8_t)) > gmb->usedsize)
-		{
-			luaL_error(L, "unable to read data; bounds out of range");
-		}
-		lua_pushunsigned(L, (lua_Unsigned)(*((uint8_t *)ptradd(gmb->data, *offset))));
-		*offset += sizeof(uint8_t);
+		memcpy(raw + offset, blob->data, blob->usedsize);
+#ifdef LUABLOB_HUGEPAGES
+		munmap(old.base, old.rawsize);
+#endif
 	}
-	else if (strcmp(type, "i16") == 0)
+	else if (blob->data != NULL && offset != (size_t)((char *)blob->data - (char *)old.base))
 	{
-		if ((*offset + sizeof(int16_t)) > gmb->usedsize)
-		{
-			luaL_error(L, "unable to read data; bounds out of range");
-		}
-		lua_pushinteger(L, (lua_Integer)(*((int16_t *)ptradd(gmb->data, *offset))));
-		*offset += sizeof(int16_t);
+		//lua_Alloc moved the block to an address with a different alignment; slide the contents back onto the boundary
+		memmove(raw + offset, raw + ((char *)blob->data - (char *)old.base), blob->usedsize);
 	}
-	else if (strcmp(type, "u16") == 0)
+
+	hdr = luablob_alignhdr_of(raw + offset);
+	hdr->base = raw;
+	hdr->rawsize = rawsize;
+	hdr->mapped = 0;
+	blob->data = (raw + offset);
+	return nsize;
+}
+size_t luablob_aligned_realloc(GenericMemoryBlob *blob, size_t nsize)
+{
+	return luablob_aligned_resize(blob, nsize, 0 /* FALSE */);
+}
+size_t luablob_hugepage_realloc(GenericMemoryBlob *blob, size_t nsize)
+{
+	return luablob_aligned_resize(blob, nsize, 1 /* TRUE */);
+}
+void luablob_aligned_free(GenericMemoryBlob *blob)
+{
+	void *allocud = NULL;
+	luablob_alignhdr *hdr;
+
+	if (blob->data == NULL)
 	{
-		if ((*offset + sizeof(uint16_t)) > gmb->usedsize)
-		{
-			luaL_error(L, "unable to read data; bounds out of range");
-		}
-		lua_pushunsigned(L, (lua_Unsigned)(*((uint16_t *)ptradd(gmb->data, *offset))));
-		*offset += sizeof(uint16_t);
+		return;
 	}
-	else if (strcmp(type, "i32") == 0)
+
+	hdr = luablob_alignhdr_of(blob->data);
+#ifdef LUABLOB_HUGEPAGES
+	if (hdr->mapped)
 	{
-		if ((*offset + sizeof(int32_t)) > gmb->usedsize)
-		{
-			luaL_error(L, "unable to read data; bounds out of range");
-		}
-		lua_pushinteger(L, (lua_Integer)(*((int32_t *)ptradd(gmb->data, *offset))));
-		*offset += sizeof(int32_t);
+		munmap(hdr->base, hdr->rawsize);
+		return;
 	}
-	else if (strcmp(type, "u32") == 0)
+#endif
+	lua_getallocf(((lua_State *)blob->userdata), &allocud)(allocud, hdr->base, hdr->rawsize, 0);
+}
+
+//The 'pool' allocation mode serves blobs from per-state free lists of power-of-two size classes instead of going to lua_Alloc every time.
+#define LUABLOB_POOL_MINSHIFT 4			//the smallest size class is 16 bytes
+#define LUABLOB_POOL_CLASSES 13			//so the largest is 64kb; bigger blobs are allocated directly
+#define LUABLOB_POOL_CACHE 0x40000		//each size class keeps at most this many bytes (256kb) on its free list
+
+typedef struct luablob_poolclass_s
+{
+	void *free;
+	size_t cached;
+	size_t hits;
+	size_t misses;
+} luablob_poolclass;
+
+typedef struct luablob_pool_s
+{
+	lua_State *L;
+	size_t live;		//blobs still using the pool; it outlives its registry anchor until these are gone
+	int closed;
+	luablob_poolclass classes[LUABLOB_POOL_CLASSES];
+} luablob_pool;
+
+int luablob_pool_class(size_t nsize)
+{
+	int c;
+	size_t size;
+
+	c = 0;
+	size = (((size_t)1) << LUABLOB_POOL_MINSHIFT);
+	while (size < nsize && c < LUABLOB_POOL_CLASSES)
 	{
-		if ((*offset + sizeof(uint32_t)) > gmb->usedsize)
-		{
-			luaL_error(L, "unable to read data; bounds out of range");
-		}
-		lua_pushunsigned(L, (lua_Unsigned)(*((uint32_t *)ptradd(gmb->data, *offset))));
-		*offset += sizeof(uint32_t);
+		size <<= 1;
+		++c;
 	}
-	else if (strcmp(type, "i64") == 0)
+
+	return c;
+}
+
+void *luablob_pool_get(luablob_pool *pool, int c)
+{
+	luablob_poolclass *pc;
+	void *chunk;
+	void *allocud = NULL;
+
+	pc = &(pool->classes[c]);
+	if (pc->free != NULL)
 	{
-		if ((*offset + sizeof(int64_t)) > gmb->usedsize)
-		{
-			luaL_error(L, "unable to read data; bounds out of range");
-		}
-		lua_pushinteger(L, (lua_Integer)(*((int64_t *)ptradd(gmb->data, *offset))));
-		*offset += sizeof(int64_t);
+		chunk = pc->free;
+		pc->free = *((void **)chunk);
+		--(pc->cached);
+		++(pc->hits);
+		return chunk;
 	}
-	else if (strcmp(type, "u64") == 0)
+
+	++(pc->misses);
+	return lua_getallocf(pool->L, &allocud)(allocud, NULL, 0, (((size_t)1) << (c + LUABLOB_POOL_MINSHIFT)));
+}
+
+void luablob_pool_put(luablob_pool *pool, void *chunk, size_t allocsize)
+{
+	luablob_poolclass *pc;
+	int c;
+	void *allocud = NULL;
+
+	c = luablob_pool_class(allocsize);
+	if (c < LUABLOB_POOL_CLASSES)
 	{
-		if ((*offset + sizeof(uint64_t)) > gmb->usedsize)
+		pc = &(pool->classes[c]);
+		if (!pool->closed && ((pc->cached + 1) << (c + LUABLOB_POOL_MINSHIFT)) <= LUABLOB_POOL_CACHE)
 		{
-			luaL_error(L, "unable to read data; bounds out of range");
+			*((void **)chunk) = pc->free;
+			pc->free = chunk;
+			++(pc->cached);
+			return;
 		}
-		lua_pushunsigned(L, (lua_Unsigned)(*((uint64_t *)ptradd(gmb->data, *offset))));
-		*offset += sizeof(uint64_t);
 	}
-	else if (strcmp(type, "float") == 0)
+
+	lua_getallocf(pool->L, &allocud)(allocud, chunk, allocsize, 0);
+}
+
+void luablob_pool_drain(luablob_pool *pool)
+{
+	luablob_poolclass *pc;
+	void *chunk;
+	int c;
+	void *allocud = NULL;
+
+	for (c = 0; c < LUABLOB_POOL_CLASSES; ++c)
 	{
-		if ((*offset + sizeof(float)) > gmb->usedsize)
+		pc = &(pool->classes[c]);
+		while (pc->free != NULL)
 		{
-			luaL_error(L, "unable to read data; bounds out of range");
+			chunk = pc->free;
+			pc->free = *((void **)chunk);
+			lua_getallocf(pool->L, &allocud)(allocud, chunk, (((size_t)1) << (c + LUABLOB_POOL_MINSHIFT)), 0);
 		}
-		lua_pushnumber(L, (lua_Number)(*((float *)ptradd(gmb->data, *offset))));
-		*offset += sizeof(float);
+		pc->cached = 0;
 	}
-	else if (strcmp(type, "double") == 0)
+}
+
+size_t luablob_pool_realloc(GenericMemoryBlob *blob, size_t nsize)
+{
+	luablob_pool *pool;
+	void *allocud = NULL;
+	void *data;
+	size_t size;
+	int c;
+
+	if ((nsize < blob->usedsize) || (nsize == 0))
+	{
+		return blob->allocsize;
+	}
+
+	pool = (luablob_pool *)blob->userdata;
+	c = luablob_pool_class(nsize);
+	if (c < LUABLOB_POOL_CLASSES)
 	{
-		if ((*offset + sizeof(double)) > gmb->usedsize)
+		size = (((size_t)1) << (c + LUABLOB_POOL_MINSHIFT));
+		if (size == blob->allocsize)
 		{
-			luaL_error(L, "unable to read data; bounds out of range");
+			return size;
 		}
-		lua_pushnumber(L, (lua_Number)(*((double *)ptradd(gmb->data, *offset))));
-		*offset += sizeof(double);
+		data = luablob_pool_get(pool, c);
 	}
 	else
 	{
-		luaL_error(L, "unrecognized datatype specifier '%s'", type);
+		size = nsize;
+		if (luablob_pool_class(blob->allocsize) == LUABLOB_POOL_CLASSES)
+		{
+			//large to large; let the allocator resize in place if it can
+			data = lua_getallocf(pool->L, &allocud)(allocud, blob->data, blob->allocsize, size);
+			if (data == NULL)
+			{
+				return 0;
+			}
+			blob->data = data;
+			return size;
+		}
+		data = lua_getallocf(pool->L, &allocud)(allocud, NULL, 0, size);
+	}
+	if (data == NULL)
+	{
+		return 0;
 	}
+
+	if (blob->data != NULL)
+	{
+		memcpy(data, blob->data, blob->usedsize);
+		luablob_pool_put(pool, blob->data, blob->allocsize);
+	}
+
+	blob->data = data;
+	return size;
 }
+void luablob_pool_free(GenericMemoryBlob *blob)
+{
+	luablob_pool *pool;
+	void *allocud = NULL;
 
-LUA_CFUNCTION_F lua_blob_read(lua_State *L)
-{	//STACK: gmb infos...
-	GenericMemoryBlob *gmb;
-	GenericMemoryBlob *destblob;
-	int i;
-	int hasoffset;
-	unsigned int offset;
-	unsigned int destoffset;
-	size_t size;
-	int count;
-	int results;
-	const char *type;
+	pool = (luablob_pool *)blob->userdata;
+	if (blob->data != NULL)
+	{
+		luablob_pool_put(pool, blob->data, blob->allocsize);
+	}
 
-	gmb = luablob_checkgmb(L, 1);
+	if (--(pool->live) == 0 && pool->closed)
+	{
+		lua_getallocf(pool->L, &allocud)(allocud, pool, sizeof(luablob_pool), 0);
+	}
+}
 
-	offset = 0;
-	results = 0;
-	count = lua_gettop(L);
-	type = NULL;
-	for(i = 2; i <= count; ++i)
+LUA_CFUNCTION_F lua_luablob_pool_mt___gc(lua_State *L)
+{	//STACK: poolud ?
+	luablob_pool *pool;
+	void *allocud = NULL;
+
+	pool = *((luablob_pool **)lua_touserdata(L, 1));
+	pool->closed = 1;
+	luablob_pool_drain(pool);
+	if (pool->live == 0)
 	{
-		switch(lua_type(L, i))
-		{
-			case LUA_TNUMBER:
-				offset += lua_tointeger(L, i);
-				break;
-			case LUA_TSTRING:
-				type = lua_tostring(L, i);
-				lua_blob_read_type(L, gmb, &offset, type);	//STACK: gmb infos... values... value
-				++results;
-				break;
-			case LUA_TTABLE:
-				luaL_checkstack(L, 1, NULL);
+		lua_getallocf(pool->L, &allocud)(allocud, pool, sizeof(luablob_pool), 0);
+	}
 
-				lua_pushliteral(L, "type");				//STACK: gmb infos... values... 'type'
-				lua_gettable(L, i);						//STACK: gmb infos... values... type
-				type = (lua_isnil(L, -1) ? NULL : luaL_checkstring(L, -1));
-				lua_pop(L, 1);							//STACK: gmb infos... values...
+	return 0;
+}
 
-				hasoffset = 0;
-				lua_pushliteral(L, "offset");			//STACK: gmb infos... values... 'offset'
-				lua_gettable(L, i);						//STACK: gmb infos... values... offset
-				if (!lua_isnil(L, -1))
-				{
-					hasoffset = 1;
-					offset += lua_tounsigned(L, -1);
-				}
-				lua_pop(L, 1);							//STACK: gmb infos... values...
+//Returns the pool belonging to L's state, creating it on first use.
+luablob_pool *luablob_getpool(lua_State *L)
+{	//STACK: ?
+	luablob_pool *pool;
+	luablob_pool **poolud;
+	void *allocud = NULL;
 
-				lua_pushliteral(L, "pos");				//STACK: gmb infos... values... 'pos'
-				lua_gettable(L, i);						//STACK: gmb infos... values... pos
-				if (!lua_isnil(L, -1))
-				{
-					if (hasoffset)
-					{
-						luaL_error(L, "a read information table may not contain both a position and an offset");
-					}
-					offset = lua_tounsigned(L, -1);
-				}
-				lua_pop(L, 1);							//STACK: gmb infos... values...
+	luaL_checkstack(L, 3, NULL);
 
-				if (type != NULL)
-				{
-					if (strcmp(type, "str") == 0)
-					{
-						lua_pushliteral(L, "len");			//STACK: gmb infos... values... 'len'
-						lua_gettable(L, i);					//STACK: gmb infos... values... len
-						size = luaL_checkunsigned(L, -1);
-						lua_pop(L, 1);						//STACK: gmb infos... values...
+	lua_pushliteral(L, "luablob_pool");		//STACK: ? 'luablob_pool'
+	lua_gettable(L, LUA_REGISTRYINDEX);		//STACK: ? poolud
+	if (!lua_isnil(L, -1))
+	{
+		pool = *((luablob_pool **)lua_touserdata(L, -1));
+		lua_pop(L, 1);						//STACK: ?
+		return pool;
+	}
+	lua_pop(L, 1);							//STACK: ?
 
-						if ((offset + size) > gmb->usedsize)
-						{
-							luaL_error(L, "unable to read data; bounds out of range");
-						}
+	pool = (luablob_pool *)lua_getallocf(L, &allocud)(allocud, NULL, 0, sizeof(luablob_pool));
+	if (pool == NULL)
+	{
+		luaL_error(L, "failed to allocate blob pool");
+	}
+	memset(pool, 0, sizeof(luablob_pool));
+	lua_rawgeti(L, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);	//STACK: ? mainthread
+	pool->L = lua_tothread(L, -1);
+	lua_pop(L, 1);							//STACK: ?
+
+	lua_pushliteral(L, "luablob_pool");		//STACK: ? 'luablob_pool'
+	poolud = (luablob_pool **)lua_newuserdata(L, sizeof(luablob_pool *));	//STACK: ? 'luablob_pool' poolud
+	*poolud = pool;
+	lua_createtable(L, 0, 1);				//STACK: ? 'luablob_pool' poolud {~0}
+	lua_pushliteral(L, "__gc");				//STACK: ? 'luablob_pool' poolud {~0} '__gc'
+	lua_pushcfunction(L, &lua_luablob_pool_mt___gc);	//STACK: ? 'luablob_pool' poolud {~0} '__gc' gc
+	lua_settable(L, -3);					//STACK: ? 'luablob_pool' poolud {~0}
+	lua_setmetatable(L, -2);				//STACK: ? 'luablob_pool' poolud
+	lua_settable(L, LUA_REGISTRYINDEX);		//STACK: ?
+
+	return pool;
+}
 
-						lua_pushlstring(L, ((const char *)ptradd(gmb->data, offset)), size);	//STACK: gmb infos... values... value
-						offset += size;
-						++results;
-					}
-					else if (strcmp(type, "blob") == 0)
-					{
-						luaL_checkstack(L, 3, NULL);
+//Allocation and copy counters; see lua_blob_stats. They are kept per OS thread so that bumping them never needs a lock or an atomic,
+//which means a Lua state that hops between threads reports each thread's share separately.
+#if defined(_MSC_VER)
+	#define LUABLOB_THREADLOCAL __declspec(thread)
+#elif defined(__GNUC__)
+	#define LUABLOB_THREADLOCAL __thread
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+	#define LUABLOB_THREADLOCAL _Thread_local
+#else
+	#define LUABLOB_THREADLOCAL
+#endif
 
-						lua_pushcfunction(L, &lua_blob_newblob);	//STACK: gmb infos... values... newblob
-						lua_pushliteral(L, "len");			//STACK: gmb infos... values... newblob 'len'
-						lua_gettable(L, i);					//STACK: gmb infos... values... newblob len
-						size = luaL_checkunsigned(L, -1);
+#define LUABLOB_STATMODES 7		//one per entry of luablob_allocmodes
 
-						if ((offset + size) > gmb->usedsize)
-						{
-							luaL_error(L, "unable to read data; bounds out of range");
-						}
+typedef struct luablob_modestats_s
+{
+	size_t created;
+	size_t freed;
+	size_t live;		//bytes currently allocated
+	size_t peak;
+	size_t reallocs;
+} luablob_modestats;
+
+typedef struct luablob_stats_s
+{
+	luablob_modestats modes[LUABLOB_STATMODES];
+	luablob_modestats total;
+	uint64_t readbytes;		//bulk bytes copied out of blobs by read
+	uint64_t writebytes;	//bulk bytes copied into blobs by write
+	uint64_t zerobytes;		//bytes zero-filled by gmb_resize
+} luablob_stats;
 
-						lua_pushliteral(L, "dest");			//STACK: gmb infos... values... newblob len 'dest'
-						lua_gettable(L, i);					//STACK: gmb infos... values... newblob len dest
-						if (lua_isnil(L, -1))
-						{
-							lua_pop(L, 1);					//STACK: gmb infos... values... newblob len
-							lua_pushliteral(L, "mode");		//STACK: gmb infos... values... newblob len 'mode'
-							lua_gettable(L, i);				//STACK: gmb infos... values... newblob len mode
-							if (lua_isnil(L, -1))
-							{
-								lua_pop(L, 1);				//STACK: gmb infos... values.. newblob len
-								lua_call(L, 1, 1);			//STACK: gmb infos... values.. value
-							}
-							else
-							{
-								lua_call(L, 2, 1);			//STACK: gmb infos... values.. value
-							}
+LUABLOB_THREADLOCAL luablob_stats luablob_counters;
 
-							destblob = (GenericMemoryBlob *)lua_touserdata(L, -1);
-							destblob->usedsize = size;
-							memcpy(destblob->data, ptradd(gmb->data, offset), size);
-							++results;
-						}
-						else
-						{
-							destblob = luablob_checkgmb(L, -1);
-							lua_pop(L, 2);					//STACK: gmb infos... values...
+#define luablob_countbytes(counter, n) (luablob_counters.counter += (uint64_t)(n))
 
-							lua_pushliteral(L, "start");	//STACK: gmb infos... values... 'start'
-							lua_gettable(L, i);				//STACK: gmb infos... values... start
-							destoffset = (lua_isnil(L, -1) ? 0 : luaL_checkunsigned(L, -1));
-							lua_pop(L, 1);					//STACK: gmb infos... values...
+//NOTICE: This must be kept in the same order as luablob_allocmodes.
+size_t (*const luablob_statreallocs[LUABLOB_STATMODES])(GenericMemoryBlob *, size_t) =
+{
+	&luablob_lua_realloc_basic,
+	&luablob_lua_realloc_tight,
+	&luablob_lua_realloc_loose,
+	&luablob_lua_realloc_geometric,
+	&luablob_pool_realloc,
+	&luablob_aligned_realloc,
+	&luablob_hugepage_realloc
+};
 
-							if (destoffset > destblob->usedsize)
-							{
-								luaL_error(L, "destination blob does not contain read start offset");
-							}
-							if (gmb_resize(destblob, (size + destoffset), 0 /* FALSE */) == 0)
-							{
-								luaL_error(L, "failed to allocate blob memory");
-							}
+//Looked up once when a blob gets its storage; the result is kept in the blob's statmode as the slot plus one.
+int luablob_findstatmode(size_t (*realloc)(GenericMemoryBlob *, size_t))
+{
+	int m;
 
-							memcpy(ptradd(destblob->data, destoffset), ptradd(gmb->data, offset), size);
-						}
-						offset += size;
-					}
-					else
-					{
-						lua_blob_read_type(L, gmb, &offset, type);	//STACK: gmb infos... values... value
-						++results;
-					}
-				}
-				break;
-			default:
-				luaL_error(L, "invalid argument; a read information item must be an offset delta integer, a datatype specifier string, or a read information table");
+	for (m = 0; m < LUABLOB_STATMODES; ++m)
+	{
+		if (realloc == luablob_statreallocs[m])
+		{
+			return (m + 1);
 		}
 	}
 
-	return results;
+	return 0;
 }
 
-LUA_CFUNCTION_F lua_blob_write(lua_State *L)
+//Storage that is not owned by one of the allocation modes (views, mappings, shared storage, foreign blobs) is not counted.
+#define luablob_statmode(blob) ((((blob)->statmode > 0) && ((blob)->statmode <= LUABLOB_STATMODES)) ? &(luablob_counters.modes[(blob)->statmode - 1]) : NULL)
+
+void luablob_countalloc(luablob_modestats *ms, size_t oldsize, size_t newsize)
 {
-	//STACK: gmb infos...
-	GenericMemoryBlob *gmb;
-	GenericMemoryBlob *srcblob;
-	unsigned int offset;
-	unsigned int srcoffset;
-	const char *data;
-	const char *type;
-	size_t size;
-	int count;
-	int i;
-	int hasoffset;
-	size_t j;
+	luablob_modestats *total;
 
-	gmb = luablob_checkgmb(L, 1);
+	total = &(luablob_counters.total);
+	if (oldsize == 0)
+	{
+		++(ms->created);
+		++(total->created);
+	}
+	++(ms->reallocs);
+	++(total->reallocs);
 
-	offset = 0;
-	count = lua_gettop(L);
-	for(i = 2; i <= count; ++i)
+	ms->live = (ms->live - oldsize + newsize);
+	total->live = (total->live - oldsize + newsize);
+	if (ms->live > ms->peak)
 	{
-		switch(lua_type(L, i))
-		{
-			case LUA_TNUMBER:
-				offset += lua_tointeger(L, i);
-				break;
-			case LUA_TSTRING:
-				if (offset > gmb->usedsize)
-				{
-					luaL_error(L, "destination blob does not contain write start offset");
-				}
+		ms->peak = ms->live;
+	}
+	if (total->live > total->peak)
+	{
+		total->peak = total->live;
+	}
+}
 
-				data = lua_tolstring(L, i, &size);
-				if (size != 0)
-				{
-					if (gmb_resize(gmb, (offset + size), 0 /* FALSE */) == 0)
-					{
-						luaL_error(L, "failed to allocate blob memory");
-					}
+//Every call into an allocation mode goes through these two so that the counters see it.
+size_t luablob_callrealloc(GenericMemoryBlob *blob, size_t nsize)
+{
+	luablob_modestats *ms;
+	size_t oldsize;
+	size_t allocsize;
 
-					memcpy(ptradd(gmb->data, offset), data, size);
-					offset += size;
-				}
-				break;
-			case LUA_TTABLE:
-				luaL_checkstack(L, 1, NULL);
-				lua_pushliteral(L, "type");			//STACK: gmb infos... 'type'
-				lua_gettable(L, i);					//STACK: gmb infos... type
-				type = (lua_isnil(L, -1) ? NULL : luaL_checkstring(L, -1));
-				lua_pop(L, 1);						//STACK: gmb infos...
+	ms = luablob_statmode(blob);
+	oldsize = blob->allocsize;
 
-				hasoffset = 0;
-				lua_pushliteral(L, "offset");		//STACK: gmb infos... 'offset'
-				lua_gettable(L, i);					//STACK: gmb infos... offset
-				if (!lua_isnil(L, -1))
-				{
-					hasoffset = 1;
-					offset += lua_tointeger(L, -1);
-				}
-				lua_pop(L, 1);						//STACK: gmb infos...
+	allocsize = blob->realloc(blob, nsize);
+	if (ms != NULL && allocsize != 0 && allocsize != oldsize)
+	{
+		luablob_countalloc(ms, oldsize, allocsize);
+	}
 
-				lua_pushliteral(L, "pos");			//STACK: gmb infos... 'pos'
-				lua_gettable(L, i);					//STACK: gmb infos... pos
-				if (!lua_isnil(L, -1))
-				{
-					if (hasoffset)
-					{
-						luaL_error(L, "a write information table may not contain both a position and an offset");
-					}
-					offset = luaL_checkunsigned(L, -1);
-				}
-				lua_pop(L, 1);						//STACK: gmb infos...
+	return allocsize;
+}
+void luablob_callfree(GenericMemoryBlob *blob)
+{
+	luablob_modestats *ms;
 
-				if (offset > gmb->usedsize)
-				{
-					luaL_error(L, "destination blob does not contain write start offset");
-				}
+	ms = luablob_statmode(blob);
+	if (ms != NULL && blob->allocsize != 0)
+	{
+		++(ms->freed);
+		++(luablob_counters.total.freed);
+		ms->live -= blob->allocsize;
+		luablob_counters.total.live -= blob->allocsize;
+	}
 
-				if (type != NULL)
-				{
-					lua_pushliteral(L, "value");		//STACK: gmb infos... 'value'
+	blob->free(blob);
+}
+
+//Shared storage is reference counted between clones; the first write through any of them makes a private copy.
+typedef struct luablob_shared_s
+{
+	lua_State *L;
+	unsigned int refs;
+	GenericMemoryBlob owner;	//the descriptor of the storage as it was before it became shared
+} luablob_shared;
+
+int luablob_unshare(GenericMemoryBlob *blob, size_t reserve);
+
+size_t luablob_shared_realloc(GenericMemoryBlob *blob, size_t nsize)
+{
+	if (luablob_unshare(blob, nsize) == 0)
+	{
+		return 0;
+	}
+
+	return luablob_callrealloc(blob, nsize);
+}
+void luablob_shared_free(GenericMemoryBlob *blob)
+{
+	luablob_shared *shared;
+	void *allocud = NULL;
+
+	shared = (luablob_shared *)blob->userdata;
+	if (--(shared->refs) == 0)
+	{
+		if (shared->owner.free != NULL)
+		{
+			luablob_callfree(&(shared->owner));
+		}
+		lua_getallocf(shared->L, &allocud)(allocud, shared, sizeof(luablob_shared), 0);
+	}
+}
+
+//Only heap storage can be shared; a holder that writes needs its own copy in the same mode, which mapped and view storage cannot provide.
+int luablob_shareable(GenericMemoryBlob *blob)
+{
+	return (
+		(blob->free == &luablob_shared_free) ||
+		(blob->free == &luablob_lua_free) ||
+		(blob->free == &luablob_aligned_free) ||
+		(blob->free == &luablob_pool_free)
+	);
+}
+
+//Gives a shared blob storage of its own; reserve is a hint for the size the caller is about to grow the blob to.
+int luablob_unshare(GenericMemoryBlob *blob, size_t reserve)
+{
+	luablob_shared *shared;
+	GenericMemoryBlob copy;
+	size_t size;
+	void *allocud = NULL;
+
+	shared = (luablob_shared *)blob->userdata;
+	if (shared->refs == 1)
+	{
+		//we are the last holder; simply take the storage back
+		size = blob->usedsize;
+		*blob = shared->owner;
+		blob->usedsize = size;
+		lua_getallocf(shared->L, &allocud)(allocud, shared, sizeof(luablob_shared), 0);
+		return 1;
+	}
+
+	//only heap storage is ever shared, so the copy can always keep the owner's allocation mode
+	copy.realloc = shared->owner.realloc;
+	copy.free = shared->owner.free;
+	copy.userdata = shared->owner.userdata;
+	copy.statmode = shared->owner.statmode;
+	copy.data = NULL;
+	copy.allocsize = 0;
+	copy.usedsize = 0;
+
+	size = ((reserve > blob->usedsize) ? reserve : blob->usedsize);
+	copy.allocsize = luablob_callrealloc(&copy, ((size == 0) ? 1 : size));
+	if (copy.allocsize == 0)
+	{
+		return 0;
+	}
+	memcpy(copy.data, shared->owner.data, blob->usedsize);
+	copy.usedsize = blob->usedsize;
+	if (copy.free == &luablob_pool_free)
+	{
+		++(((luablob_pool *)copy.userdata)->live);
+	}
+
+	--(shared->refs);
+	*blob = copy;
+	return 1;
+}
+
+//Whether dest allocates the same way as the storage behind src, so that it may hold that storage in place of its own.
+int luablob_samestorage(GenericMemoryBlob *dest, GenericMemoryBlob *src)
+{
+	GenericMemoryBlob *owner;
+
+	owner = ((src->free == &luablob_shared_free) ? &(((luablob_shared *)src->userdata)->owner) : src);
+	return ((dest->realloc == owner->realloc) && (dest->free == owner->free) && (dest->userdata == owner->userdata));
+}
+
+//Fills clone with a blob sharing src's storage, converting src to shared storage first if needed.
+void luablob_share(lua_State *L, GenericMemoryBlob *src, GenericMemoryBlob *clone)
+{
+	luablob_shared *shared;
+	void *allocud = NULL;
+
+	if (src->free != &luablob_shared_free)
+	{
+		shared = (luablob_shared *)lua_getallocf(L, &allocud)(allocud, NULL, 0, sizeof(luablob_shared));
+		if (shared == NULL)
+		{
+			luaL_error(L, "failed to allocate shared blob storage");
+		}
+
+		lua_rawgeti(L, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);	//STACK: ? mainthread
+		shared->L = lua_tothread(L, -1);
+		lua_pop(L, 1);											//STACK: ?
+		shared->refs = 1;
+		shared->owner = *src;
+
+		src->realloc = &luablob_shared_realloc;
+		src->free = &luablob_shared_free;
+		src->userdata = (void *)shared;
+		src->statmode = 0;
+	}
+
+	shared = (luablob_shared *)src->userdata;
+	++(shared->refs);
+
+	*clone = *src;
+}
+
+#ifdef LUABLOB_MAPFILE
+//A mapped blob's storage is a view of a file; offsets are rounded down to the platform's mapping granularity, so data may sit a little past base.
+typedef struct luablob_mapinfo_s
+{
+	lua_State *L;
+	void *base;
+	size_t baselen;
+	size_t delta;
+	uint64_t fileoffset;
+	int writable;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int fd;
+#endif
+} luablob_mapinfo;
+
+void luablob_map_free(GenericMemoryBlob *blob)
+{
+	luablob_mapinfo *info;
+	void *allocud = NULL;
+
+	info = (luablob_mapinfo *)blob->userdata;
+#ifdef _WIN32
+	UnmapViewOfFile(info->base);
+	if (info->mapping != NULL)
+	{
+		CloseHandle(info->mapping);
+	}
+	if (info->file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(info->file);
+	}
+#else
+	munmap(info->base, info->baselen);
+	if (info->fd != -1)
+	{
+		close(info->fd);
+	}
+#endif
+	lua_getallocf(info->L, &allocud)(allocud, info, sizeof(luablob_mapinfo), 0);
+}
+
+//Private mappings cannot grow past the end of the file, so growing one moves the data into ordinary memory.
+size_t luablob_map_detach(GenericMemoryBlob *blob, size_t nsize)
+{
+	luablob_mapinfo *info;
+	GenericMemoryBlob copy;
+
+	info = (luablob_mapinfo *)blob->userdata;
+
+	copy.realloc = &luablob_lua_realloc_basic;
+	copy.free = &luablob_lua_free;
+	copy.userdata = (void *)info->L;
+	copy.statmode = luablob_findstatmode(copy.realloc);
+	copy.data = NULL;
+	copy.allocsize = 0;
+	copy.usedsize = 0;
+
+	copy.allocsize = luablob_callrealloc(&copy, nsize);
+	if (copy.allocsize == 0)
+	{
+		return 0;
+	}
+	memcpy(copy.data, blob->data, blob->usedsize);
+
+	luablob_map_free(blob);
+	blob->realloc = copy.realloc;
+	blob->free = copy.free;
+	blob->userdata = copy.userdata;
+	blob->statmode = copy.statmode;
+	blob->data = copy.data;
+	return copy.allocsize;
+}
+
+//Shared mappings grow by extending the file and remapping it.
+size_t luablob_map_grow(GenericMemoryBlob *blob, size_t nsize)
+{
+	luablob_mapinfo *info;
+	size_t newlen;
+	void *base;
+#ifdef _WIN32
+	HANDLE mapping;
+	ULARGE_INTEGER end;
+	ULARGE_INTEGER start;
+#else
+	struct stat st;
+#endif
+
+	info = (luablob_mapinfo *)blob->userdata;
+	newlen = (info->delta + nsize);
+	if (newlen < nsize)
+	{
+		return 0;
+	}
+
+#ifdef _WIN32
+	//a read/write mapping larger than the file extends it; map the new view before dropping the old one so a failure leaves the blob intact
+	end.QuadPart = (info->fileoffset + newlen);
+	start.QuadPart = info->fileoffset;
+	mapping = CreateFileMappingA(info->file, NULL, PAGE_READWRITE, end.HighPart, end.LowPart, NULL);
+	if (mapping == NULL)
+	{
+		return 0;
+	}
+	base = MapViewOfFile(mapping, FILE_MAP_WRITE, start.HighPart, start.LowPart, newlen);
+	if (base == NULL)
+	{
+		CloseHandle(mapping);
+		return 0;
+	}
+	UnmapViewOfFile(info->base);
+	CloseHandle(info->mapping);
+	info->mapping = mapping;
+#else
+	if (fstat(info->fd, &st) != 0)
+	{
+		return 0;
+	}
+	if ((uint64_t)st.st_size < (info->fileoffset + newlen))
+	{
+		if (ftruncate(info->fd, (off_t)(info->fileoffset + newlen)) != 0)
+		{
+			return 0;
+		}
+	}
+	#ifdef __linux__
+	base = mremap(info->base, info->baselen, newlen, MREMAP_MAYMOVE);
+	if (base == MAP_FAILED)
+	{
+		return 0;
+	}
+	#else
+	base = mmap(NULL, newlen, (PROT_READ | PROT_WRITE), MAP_SHARED, info->fd, (off_t)info->fileoffset);
+	if (base == MAP_FAILED)
+	{
+		return 0;
+	}
+	munmap(info->base, info->baselen);
+	#endif
+#endif
+
+	info->base = base;
+	info->baselen = newlen;
+	blob->data = ptradd(base, info->delta);
+	return nsize;
+}
+
+size_t luablob_map_realloc(GenericMemoryBlob *blob, size_t nsize)
+{
+	if ((nsize < blob->usedsize) || (nsize == 0) || (nsize <= blob->allocsize))
+	{
+		return blob->allocsize;
+	}
+
+	if (((luablob_mapinfo *)blob->userdata)->writable)
+	{
+		return luablob_map_grow(blob, nsize);
+	}
+	else
+	{
+		return luablob_map_detach(blob, nsize);
+	}
+}
+#endif
+
+//Offsets and sizes are read as lua_Number: lua_Unsigned is only 32 bits wide in Lua 5.2, while a double holds every offset up to 2^53 exactly.
+LUABLOB_API(size_t) luablob_checksize(lua_State *L, int index)
+{
+	lua_Number n;
+
+	n = luaL_checknumber(L, index);
+	if (!(n >= 0) || n >= (lua_Number)((size_t)-1))
+	{
+		luaL_error(L, "argument out of range; offsets and sizes must be non-negative and addressable");
+	}
+
+	return (size_t)n;
+}
+
+#define luablob_optsize(L, index, def) (lua_isnoneornil(L, (index)) ? (def) : luablob_checksize(L, (index)))
+
+//The same goes for u64 values, which often carry lengths; negative values wrap like they did through luaL_checkunsigned.
+uint64_t luablob_checku64(lua_State *L, int index)
+{
+	lua_Number n;
+
+	n = luaL_checknumber(L, index);
+	return ((n < 0) ? ((uint64_t)((int64_t)n)) : ((uint64_t)n));
+}
+
+LUABLOB_API(void) luablob_newgmb(lua_State *L, GenericMemoryBlob *gmb, size_t initialsize, const char *allocmode)
+{
+	luablob_pool *pool;
+
+	if (initialsize <= 0)
+	{
+		luaL_error(L, "argument out of range; initial size must be greater than 0.");
+	}
+	if (allocmode == NULL)
+	{
+		allocmode = luablob_defaultmode;
+	}
+
+	gmb->free = &luablob_lua_free;
+	gmb->userdata = (void *)L;
+
+	if (strcmp(allocmode, "basic") == 0)
+	{
+		gmb->realloc = &luablob_lua_realloc_basic;
+	}
+	else if (strcmp(allocmode, "tight") == 0)
+	{
+		gmb->realloc = &luablob_lua_realloc_tight;
+	}
+	else if (strcmp(allocmode, "loose") == 0)
+	{
+		gmb->realloc = &luablob_lua_realloc_loose;
+	}
+	else if (strcmp(allocmode, "geometric") == 0)
+	{
+		gmb->realloc = &luablob_lua_realloc_geometric;
+	}
+	else if (strcmp(allocmode, "aligned") == 0)
+	{
+		gmb->realloc = &luablob_aligned_realloc;
+		gmb->free = &luablob_aligned_free;
+	}
+	else if (strcmp(allocmode, "hugepage") == 0)
+	{
+		gmb->realloc = &luablob_hugepage_realloc;
+		gmb->free = &luablob_aligned_free;
+	}
+	else if (strcmp(allocmode, "pool") == 0)
+	{
+		pool = luablob_getpool(L);
+		++(pool->live);
+		gmb->realloc = &luablob_pool_realloc;
+		gmb->free = &luablob_pool_free;
+		gmb->userdata = (void *)pool;
+	}
+	else
+	{
+		luaL_error(L, "invalid argument; allocation mode '%s' is not supported; valid values are 'basic', 'tight', 'loose', 'geometric', 'pool', 'aligned', 'hugepage'", allocmode);
+	}
+
+	gmb->statmode = luablob_findstatmode(gmb->realloc);
+	gmb->usedsize = 0;
+	gmb->allocsize = 0;
+	gmb->usedsize = 0;
+	gmb->data = NULL;
+
+	if (!gmb_realloc(gmb, initialsize))
+	{
+		luaL_error(L, "failed to allocate initial blob memory");
+	}
+}
+
+LUA_CFUNCTION_F lua_blob_newblob(lua_State *L)
+{	//STACK: initialsize? allocmode? ?
+	size_t initialsize;
+	const char *allocmode;
+	GenericMemoryBlob gmb;
+
+	if (lua_gettop(L) > 0)
+	{
+		switch (lua_type(L, 1))
+		{
+			case LUA_TNUMBER:
+				initialsize = luablob_checksize(L, 1);
+				if (lua_gettop(L) > 1)
+				{
+					allocmode = luaL_checkstring(L, 2);
+				}
+				else
+				{
+					allocmode = NULL;
+				}
+				break;
+			case LUA_TSTRING:
+				allocmode = luaL_checkstring(L, 1);
+				initialsize = sizeof(lua_Number);
+				break;
+			default:
+				luaL_error(L, "invalid argument; expected allocation size (number) or allocation mode (string)");
+		}
+	}
+	else
+	{
+		initialsize = sizeof(lua_Number);
+		allocmode = NULL;
+	}
+
+	luablob_newgmb(L, &gmb, initialsize, allocmode);
+	luablob_pushgmb(L, gmb);	//STACK: initialsize? allocmode? ? gmb
+
+	return 1;					//RETURN: gmb
+}
+
+LUA_CFUNCTION_F lua_blob_mapfile(lua_State *L)
+{	//STACK: path mode? offset? len? ?
+#ifdef LUABLOB_MAPFILE
+	const char *path;
+	const char *mode;
+	int writable;
+	lua_Number num;
+	uint64_t offset;
+	uint64_t len;
+	uint64_t filesize;
+	uint64_t granularity;
+	size_t delta;
+	void *base;
+	luablob_mapinfo *info;
+	GenericMemoryBlob gmb;
+	void *allocud = NULL;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+	LARGE_INTEGER size;
+	ULARGE_INTEGER start;
+	SYSTEM_INFO si;
+#else
+	int fd;
+	struct stat st;
+#endif
+
+	path = luaL_checkstring(L, 1);
+	mode = (lua_isnoneornil(L, 2) ? "r" : luaL_checkstring(L, 2));
+	if (strcmp(mode, "r") == 0)
+	{
+		writable = 0;
+	}
+	else if (strcmp(mode, "rw") == 0)
+	{
+		writable = 1;
+	}
+	else
+	{
+		return luaL_error(L, "invalid argument; map mode '%s' is not supported; valid values are 'r', 'rw'", mode);
+	}
+
+	//lua_Unsigned may only be 32 bits wide, but file offsets routinely exceed 4gb
+	num = (lua_isnoneornil(L, 3) ? 0 : luaL_checknumber(L, 3));
+	if (num < 0)
+	{
+		luaL_error(L, "argument out of range; offset must be non-negative");
+	}
+	offset = (uint64_t)num;
+
+#ifdef _WIN32
+	file = CreateFileA(path, (writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ), (FILE_SHARE_READ | FILE_SHARE_WRITE), NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		luaL_error(L, "unable to open file '%s' (%d)", path, (int)GetLastError());
+	}
+	if (!GetFileSizeEx(file, &size))
+	{
+		CloseHandle(file);
+		luaL_error(L, "unable to determine the size of file '%s' (%d)", path, (int)GetLastError());
+	}
+	filesize = (uint64_t)size.QuadPart;
+	GetSystemInfo(&si);
+	granularity = si.dwAllocationGranularity;
+#else
+	fd = open(path, (writable ? O_RDWR : O_RDONLY));
+	if (fd == -1)
+	{
+		luaL_error(L, "unable to open file '%s': %s", path, strerror(errno));
+	}
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		luaL_error(L, "unable to determine the size of file '%s': %s", path, strerror(errno));
+	}
+	filesize = (uint64_t)st.st_size;
+	granularity = (uint64_t)sysconf(_SC_PAGESIZE);
+#endif
+
+	if (offset > filesize)
+	{
+		len = 0;
+	}
+	else if (lua_isnoneornil(L, 4))
+	{
+		len = (filesize - offset);
+	}
+	else
+	{
+		num = luaL_checknumber(L, 4);
+		len = ((num < 0) ? 0 : (uint64_t)num);
+	}
+	if (len == 0 || offset > filesize || len > (filesize - offset) || len > (uint64_t)(((size_t)-1) - granularity))
+	{
+#ifdef _WIN32
+		CloseHandle(file);
+#else
+		close(fd);
+#endif
+		luaL_error(L, "argument out of range; the mapped range must be non-empty and lie within the file");
+	}
+
+	delta = (size_t)(offset % granularity);
+	offset -= delta;
+
+#ifdef _WIN32
+	mapping = CreateFileMappingA(file, NULL, (writable ? PAGE_READWRITE : PAGE_WRITECOPY), 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		CloseHandle(file);
+		luaL_error(L, "unable to map file '%s' (%d)", path, (int)GetLastError());
+	}
+	start.QuadPart = offset;
+	base = MapViewOfFile(mapping, (writable ? FILE_MAP_WRITE : FILE_MAP_COPY), start.HighPart, start.LowPart, (SIZE_T)(delta + len));
+	if (base == NULL)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		luaL_error(L, "unable to map file '%s' (%d)", path, (int)GetLastError());
+	}
+	if (!writable)
+	{
+		//the view keeps a private mapping alive on its own
+		CloseHandle(mapping);
+		CloseHandle(file);
+		mapping = NULL;
+		file = INVALID_HANDLE_VALUE;
+	}
+#else
+	//private mappings are writable too; their writes stay in memory and never reach the file
+	base = mmap(NULL, (size_t)(delta + len), (PROT_READ | PROT_WRITE), (writable ? MAP_SHARED : MAP_PRIVATE), fd, (off_t)offset);
+	if (base == MAP_FAILED)
+	{
+		close(fd);
+		luaL_error(L, "unable to map file '%s': %s", path, strerror(errno));
+	}
+	if (!writable)
+	{
+		close(fd);
+		fd = -1;
+	}
+#endif
+
+	info = (luablob_mapinfo *)lua_getallocf(L, &allocud)(allocud, NULL, 0, sizeof(luablob_mapinfo));
+	if (info == NULL)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(base);
+		if (writable)
+		{
+			CloseHandle(mapping);
+			CloseHandle(file);
+		}
+#else
+		munmap(base, (size_t)(delta + len));
+		if (writable)
+		{
+			close(fd);
+		}
+#endif
+		luaL_error(L, "failed to allocate blob memory");
+	}
+
+	lua_rawgeti(L, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);	//STACK: path mode? offset? len? ? mainthread
+	info->L = lua_tothread(L, -1);
+	lua_pop(L, 1);											//STACK: path mode? offset? len? ?
+	info->base = base;
+	info->baselen = (size_t)(delta + len);
+	info->delta = delta;
+	info->fileoffset = offset;
+	info->writable = writable;
+#ifdef _WIN32
+	info->file = file;
+	info->mapping = mapping;
+#else
+	info->fd = fd;
+#endif
+
+	gmb.realloc = &luablob_map_realloc;
+	gmb.free = &luablob_map_free;
+	gmb.userdata = (void *)info;
+	gmb.statmode = 0;
+	gmb.allocsize = (size_t)len;
+	gmb.usedsize = (size_t)len;
+	gmb.data = ptradd(base, delta);
+
+	luablob_pushgmb(L, gmb);	//STACK: path mode? offset? len? ? gmb
+	return 1;					//RETURN: gmb
+#else
+	return luaL_error(L, "memory mapped files are not supported on this platform");
+#endif
+}
+
+//Whole-blob copies at least this large share storage copy-on-write instead of copying.
+#define LUABLOB_SHARE_MIN 256
+
+//Copies count bytes from src at start into dest at pos, ending dest there like write does. Either blob may be a view of the other, and
+//resizing dest can move the storage a view points into, so dest only grows before the copy, src is resynced after it, and any
+//truncation waits until the bytes have been moved.
+void luablob_copyblob(lua_State *L, GenericMemoryBlob *dest, size_t pos, GenericMemoryBlob *src, size_t start, size_t count)
+{
+	if (gmb_resizeraw(dest, (((pos + count) > dest->usedsize) ? (pos + count) : dest->usedsize), 0 /* FALSE */) == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
+	if (src->free == &luablob_view_free)
+	{
+		luablob_view_sync(L, src);
+	}
+
+	memmove(ptradd(dest->data, pos), ptradd(src->data, start), count);
+	dest->usedsize = (pos + count);
+}
+
+//Datatype identifiers shared by the read/write dispatchers and by compiled plans.
+enum luablob_type_e
+{
+	LUABLOB_TYPE_NONE = 0,
+	LUABLOB_TYPE_CSTR,
+	LUABLOB_TYPE_U8STR,
+	LUABLOB_TYPE_U16STR,
+	LUABLOB_TYPE_U32STR,
+	LUABLOB_TYPE_CHAR,
+	LUABLOB_TYPE_I8,
+	LUABLOB_TYPE_U8,
+	LUABLOB_TYPE_I16,
+	LUABLOB_TYPE_U16,
+	LUABLOB_TYPE_I32,
+	LUABLOB_TYPE_U32,
+	LUABLOB_TYPE_I64,
+	LUABLOB_TYPE_U64,
+	LUABLOB_TYPE_FLOAT,
+	LUABLOB_TYPE_DOUBLE,
+	LUABLOB_TYPE_I16LE,		//the explicit endianness types come in little/big pairs; see luablob_ordered_sizes
+	LUABLOB_TYPE_I16BE,
+	LUABLOB_TYPE_U16LE,
+	LUABLOB_TYPE_U16BE,
+	LUABLOB_TYPE_I32LE,
+	LUABLOB_TYPE_I32BE,
+	LUABLOB_TYPE_U32LE,
+	LUABLOB_TYPE_U32BE,
+	LUABLOB_TYPE_I64LE,
+	LUABLOB_TYPE_I64BE,
+	LUABLOB_TYPE_U64LE,
+	LUABLOB_TYPE_U64BE,
+	LUABLOB_TYPE_FLOATLE,
+	LUABLOB_TYPE_FLOATBE,
+	LUABLOB_TYPE_DOUBLELE,
+	LUABLOB_TYPE_DOUBLEBE,
+	LUABLOB_TYPE_UVARINT,
+	LUABLOB_TYPE_SVARINT,
+	LUABLOB_TYPE_VARSTR,
+	LUABLOB_TYPE_STR,
+	LUABLOB_TYPE_BLOB
+};
+
+//NOTICE: This must be kept in the same order as enum luablob_type_e.
+const char *const luablob_typenames[] =
+{
+	"",
+	"cstr",
+	"u8str",
+	"u16str",
+	"u32str",
+	"char",
+	"i8",
+	"u8",
+	"i16",
+	"u16",
+	"i32",
+	"u32",
+	"i64",
+	"u64",
+	"float",
+	"double",
+	"i16le",
+	"i16be",
+	"u16le",
+	"u16be",
+	"i32le",
+	"i32be",
+	"u32le",
+	"u32be",
+	"i64le",
+	"i64be",
+	"u64le",
+	"u64be",
+	"floatle",
+	"floatbe",
+	"doublele",
+	"doublebe",
+	"uvarint",
+	"svarint",
+	"varstr",
+	"str",
+	"blob",
+	NULL
+};
+
+int luablob_typeid(const char *type)
+{
+	int i;
+
+	for (i = 1; luablob_typenames[i] != NULL; ++i)
+	{
+		if (strcmp(type, luablob_typenames[i]) == 0)
+		{
+			return i;
+		}
+	}
+
+	return LUABLOB_TYPE_NONE;
+}
+
+//LEB128 varints. Values travel through lua_Number, so 64 bit values above 2^53 lose precision just like the u64 type.
+#define LUABLOB_VARINT_MAX 10
+
+#if defined(_MSC_VER) && defined(_M_X64)
+	#include <intrin.h>
+	int luablob_ctz64(uint64_t x)
+	{
+		unsigned long i;
+		_BitScanForward64(&i, x);
+		return (int)i;
+	}
+#elif defined(__GNUC__)
+	#define luablob_ctz64(x) __builtin_ctzll(x)
+#else
+	int luablob_ctz64(uint64_t x)
+	{
+		int i = 0;
+		while (!(x & 1))
+		{
+			x >>= 1;
+			++i;
+		}
+		return i;
+	}
+#endif
+
+//Decodes the varint at p, of which avail bytes are readable; returns its encoded length, or 0 if it is truncated or overlong.
+size_t luablob_uvarint_decode(const unsigned char *p, size_t avail, uint64_t *value)
+{
+	uint64_t word;
+	uint64_t stops;
+	uint64_t result;
+	size_t len;
+	size_t i;
+
+	if (avail >= sizeof(uint64_t))
+	{
+		//varints of up to 8 bytes are decoded from a single load without a per byte branch; the terminator is the first byte with a clear high bit
+		memcpy(&word, p, sizeof(uint64_t));
+#if LUABLOB_BIGENDIAN
+		word = luablob_bswap64(word);
+#endif
+		stops = (~word & 0x8080808080808080ULL);
+		if (stops != 0)
+		{
+			len = ((luablob_ctz64(stops) >> 3) + 1);
+			if (len < sizeof(uint64_t))
+			{
+				word &= ((((uint64_t)1) << (len * 8)) - 1);
+			}
+			*value =
+				(word & 0x7FULL) |
+				((word & 0x7F00ULL) >> 1) |
+				((word & 0x7F0000ULL) >> 2) |
+				((word & 0x7F000000ULL) >> 3) |
+				((word & 0x7F00000000ULL) >> 4) |
+				((word & 0x7F0000000000ULL) >> 5) |
+				((word & 0x7F000000000000ULL) >> 6) |
+				((word & 0x7F00000000000000ULL) >> 7);
+			return len;
+		}
+	}
+
+	result = 0;
+	for (i = 0; i < avail && i < LUABLOB_VARINT_MAX; ++i)
+	{
+		result |= (((uint64_t)(p[i] & 0x7F)) << (7 * i));
+		if (!(p[i] & 0x80))
+		{
+			*value = result;
+			return (i + 1);
+		}
+	}
+
+	return 0;
+}
+
+//Encodes value at p, which must have room for LUABLOB_VARINT_MAX bytes; returns the encoded length.
+size_t luablob_uvarint_encode(unsigned char *p, uint64_t value)
+{
+	size_t len = 0;
+
+	while (value >= 0x80)
+	{
+		p[len++] = (unsigned char)(value | 0x80);
+		value >>= 7;
+	}
+	p[len++] = (unsigned char)value;
+
+	return len;
+}
+
+#define luablob_zigzag_encode(n) ((((uint64_t)(n)) << 1) ^ ((uint64_t)(((int64_t)(n)) >> 63)))
+#define luablob_zigzag_decode(u) ((int64_t)(((u) >> 1) ^ (~((u) & 1) + 1)))
+#define luablob_uvarint_inrange(n) (((n) >= 0) && ((n) < 18446744073709551616.0))		//false for NaN as well
+#define luablob_svarint_inrange(n) (((n) >= -9223372036854775808.0) && ((n) < 9223372036854775808.0))
+
+uint64_t luablob_checkuvarint(lua_State *L, int index)
+{
+	lua_Number n;
+
+	n = luaL_checknumber(L, index);
+	if (!luablob_uvarint_inrange(n))
+	{
+		luaL_error(L, "argument out of range; uvarint values must not be negative, NaN or 2^64 and above");
+	}
+
+	return (uint64_t)n;
+}
+
+int64_t luablob_checksvarint(lua_State *L, int index)
+{
+	lua_Number n;
+
+	n = luaL_checknumber(L, index);
+	if (!luablob_svarint_inrange(n))
+	{
+		luaL_error(L, "argument out of range; svarint values must be from -2^63 up to but not including 2^63");
+	}
+
+	return (int64_t)n;
+}
+
+void lua_blob_read_varint(lua_State *L, GenericMemoryBlob *gmb, size_t *offset, int type)
+{	//STACK:	start:	?
+	//			end:	? value
+	uint64_t value;
+	size_t len;
+
+	if (*offset > gmb->usedsize)
+	{
+		luaL_error(L, "unable to read data; bounds out of range");
+	}
+
+	len = luablob_uvarint_decode((const unsigned char *)ptradd(gmb->data, *offset), (gmb->usedsize - *offset), &value);
+	if (len == 0)
+	{
+		luaL_error(L, "unable to read data; truncated or malformed varint");
+	}
+	*offset += len;
+
+	switch (type)
+	{
+		case LUABLOB_TYPE_UVARINT:
+			lua_pushnumber(L, (lua_Number)value);
+			break;
+		case LUABLOB_TYPE_SVARINT:
+			lua_pushnumber(L, (lua_Number)luablob_zigzag_decode(value));
+			break;
+		default:	//varstr
+			if (value > (gmb->usedsize - *offset))
+			{
+				luaL_error(L, "unable to read data; string length out of range");
+			}
+			lua_pushlstring(L, ((const char *)ptradd(gmb->data, *offset)), (size_t)value);
+			luablob_countbytes(readbytes, (size_t)value);
+			*offset += (size_t)value;
+			break;
+	}
+}
+
+void lua_blob_write_varint(lua_State *L, GenericMemoryBlob *gmb, size_t *offset, int type, int valueindex)
+{	//STACK: ?
+	unsigned char buf[LUABLOB_VARINT_MAX];
+	uint64_t value;
+	const char *str = NULL;
+	size_t strlen;
+	size_t len;
+
+	switch (type)
+	{
+		case LUABLOB_TYPE_UVARINT:
+			value = luablob_checkuvarint(L, valueindex);
+			strlen = 0;
+			break;
+		case LUABLOB_TYPE_SVARINT:
+			value = luablob_zigzag_encode(luablob_checksvarint(L, valueindex));
+			strlen = 0;
+			break;
+		default:	//varstr
+			str = luaL_checklstring(L, valueindex, &strlen);
+			value = strlen;
+			break;
+	}
+
+	len = luablob_uvarint_encode(buf, value);
+	if (gmb_resizeraw(gmb, (*offset + len + strlen), 0 /* FALSE */) == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
+
+	memcpy(ptradd(gmb->data, *offset), buf, len);
+	*offset += len;
+	if (strlen != 0)
+	{
+		memcpy(ptradd(gmb->data, *offset), str, strlen);
+		luablob_countbytes(writebytes, strlen);
+		*offset += strlen;
+	}
+}
+
+//Sizes of the explicit endianness types, indexed by ((type - LUABLOB_TYPE_I16LE) >> 1).
+const size_t luablob_ordered_sizes[] = { 2, 2, 4, 4, 8, 8, 4, 8 };
+
+//Reads one of the explicit endianness types; memcpy keeps unaligned access legal and still compiles to a plain load.
+void lua_blob_read_ordered(lua_State *L, GenericMemoryBlob *gmb, size_t *offset, int type)
+{	//STACK:	start:	?
+	//			end:	? value
+	int k;
+	int swap;
+	size_t size;
+	const void *p;
+	uint16_t v16;
+	uint32_t v32;
+	uint64_t v64;
+	float f;
+	double d;
+
+	k = (type - LUABLOB_TYPE_I16LE);
+	swap = ((k & 1) != LUABLOB_BIGENDIAN);
+	size = luablob_ordered_sizes[k >> 1];
+	if (!luablob_inbounds(*offset, size, gmb->usedsize))
+	{
+		luaL_error(L, "unable to read data; bounds out of range");
+	}
+	p = ptradd(gmb->data, *offset);
+
+	switch (k >> 1)
+	{
+		case 0:	//i16
+		case 1:	//u16
+			memcpy(&v16, p, sizeof(uint16_t));
+			if (swap)
+			{
+				v16 = luablob_bswap16(v16);
+			}
+			if ((k >> 1) == 0)
+			{
+				lua_pushinteger(L, (lua_Integer)((int16_t)v16));
+			}
+			else
+			{
+				lua_pushunsigned(L, (lua_Unsigned)v16);
+			}
+			break;
+		case 2:	//i32
+		case 3:	//u32
+		case 6:	//float
+			memcpy(&v32, p, sizeof(uint32_t));
+			if (swap)
+			{
+				v32 = luablob_bswap32(v32);
+			}
+			if ((k >> 1) == 2)
+			{
+				lua_pushinteger(L, (lua_Integer)((int32_t)v32));
+			}
+			else if ((k >> 1) == 3)
+			{
+				lua_pushunsigned(L, (lua_Unsigned)v32);
+			}
+			else
+			{
+				memcpy(&f, &v32, sizeof(float));
+				lua_pushnumber(L, (lua_Number)f);
+			}
+			break;
+		default:	//i64, u64, double
+			memcpy(&v64, p, sizeof(uint64_t));
+			if (swap)
+			{
+				v64 = luablob_bswap64(v64);
+			}
+			if ((k >> 1) == 4)
+			{
+				lua_pushinteger(L, (lua_Integer)((int64_t)v64));
+			}
+			else if ((k >> 1) == 5)
+			{
+				lua_pushnumber(L, (lua_Number)v64);
+			}
+			else
+			{
+				memcpy(&d, &v64, sizeof(double));
+				lua_pushnumber(L, (lua_Number)d);
+			}
+			break;
+	}
+
+	*offset += size;
+}
+
+//Writes one of the explicit endianness types.
+void lua_blob_write_ordered(lua_State *L, GenericMemoryBlob *gmb, size_t *offset, int type, int valueindex)
+{	//STACK: ?
+	int k;
+	int swap;
+	size_t size;
+	void *p;
+	uint16_t v16 = 0;
+	uint32_t v32 = 0;
+	uint64_t v64 = 0;
+	float f;
+	double d;
+
+	k = (type - LUABLOB_TYPE_I16LE);
+	swap = ((k & 1) != LUABLOB_BIGENDIAN);
+	size = luablob_ordered_sizes[k >> 1];
+
+	//fetch the value before resizing, so a bad argument leaves the blob untouched
+	switch (k >> 1)
+	{
+		case 0:	//i16
+			v16 = (uint16_t)((int16_t)luaL_checkinteger(L, valueindex));
+			break;
+		case 1:	//u16
+			v16 = (uint16_t)luaL_checkunsigned(L, valueindex);
+			break;
+		case 2:	//i32
+			v32 = (uint32_t)((int32_t)luaL_checkinteger(L, valueindex));
+			break;
+		case 3:	//u32
+			v32 = (uint32_t)luaL_checkunsigned(L, valueindex);
+			break;
+		case 4:	//i64
+			v64 = (uint64_t)((int64_t)luaL_checkinteger(L, valueindex));
+			break;
+		case 5:	//u64
+			v64 = luablob_checku64(L, valueindex);
+			break;
+		case 6:	//float
+			f = (float)luaL_checknumber(L, valueindex);
+			memcpy(&v32, &f, sizeof(float));
+			break;
+		default:	//double
+			d = (double)luaL_checknumber(L, valueindex);
+			memcpy(&v64, &d, sizeof(double));
+			break;
+	}
+
+	if (gmb_resizeraw(gmb, (*offset + size), 0 /* FALSE */) == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
+	p = ptradd(gmb->data, *offset);
+
+	switch (size)
+	{
+		case 2:
+			if (swap)
+			{
+				v16 = luablob_bswap16(v16);
+			}
+			memcpy(p, &v16, sizeof(uint16_t));
+			break;
+		case 4:
+			if (swap)
+			{
+				v32 = luablob_bswap32(v32);
+			}
+			memcpy(p, &v32, sizeof(uint32_t));
+			break;
+		default:
+			if (swap)
+			{
+				v64 = luablob_bswap64(v64);
+			}
+			memcpy(p, &v64, sizeof(uint64_t));
+			break;
+	}
+
+	*offset += size;
+}
+
+void lua_blob_read_typeid(lua_State *L, GenericMemoryBlob *gmb, size_t *offset, int type, size_t len)
+{	//STACK:	start:	?
+	//			end:	? value
+	size_t size;
+	size_t i;
+	const char *str;
+
+	switch (type)
+	{
+		case LUABLOB_TYPE_CSTR:
+			str = (const char *)gmb->data;
+			for (i = *offset; i < gmb->usedsize; i += sizeof(char))
+			{
+				if (*(str + i) == '\0')
+				{
+					lua_pushlstring(L, (str + *offset), (i - *offset));
+					luablob_countbytes(readbytes, (i - *offset));
+					*offset = (i + sizeof(char));
+					return;
+				}
+			}
+
+			luaL_error(L, "unable to read data; bounds out of range");
+			break;
+		case LUABLOB_TYPE_U8STR:
+			if (!luablob_inbounds(*offset, sizeof(uint8_t), gmb->usedsize))
+			{
+				luaL_error(L, "unable to read data; bounds out of range");
+			}
+			size = *((uint8_t *)ptradd(gmb->data, *offset));
+			*offset += sizeof(uint8_t);
+
+			if (!luablob_inbounds(*offset, size, gmb->usedsize))
+			{
+				luaL_error(L, "unable to read data; string length out of range");
+			}
+			lua_pushlstring(L, ((const char *)ptradd(gmb->data, *offset)), size);
+			luablob_countbytes(readbytes, size);
+			*offset += size;
+			break;
+		case LUABLOB_TYPE_U16STR:
+			if (!luablob_inbounds(*offset, sizeof(uint16_t), gmb->usedsize))
+			{
+				luaL_error(L, "unable to read data; bounds out of range");
+			}
+			size = *((uint16_t *)ptradd(gmb->data, *offset));
+			*offset += sizeof(uint16_t);
+
+			if (!luablob_inbounds(*offset, size, gmb->usedsize))
+			{
+				luaL_error(L, "unable to read data; string length out of range");
+			}
+			lua_pushlstring(L, ((const char *)ptradd(gmb->data, *offset)), size);
+			luablob_countbytes(readbytes, size);
+			*offset += size;
+			break;
+		case LUABLOB_TYPE_U32STR:
+			if (!luablob_inbounds(*offset, sizeof(uint32_t), gmb->usedsize))
+			{
+				luaL_error(L, "unable to read data; bounds out of range");
+			}
+			size = *((uint32_t *)ptradd(gmb->data, *offset));
+			*offset += sizeof(uint32_t);
+
+			if (!luablob_inbounds(*offset, size, gmb->usedsize))
+			{
+				luaL_error(L, "unable to read data; string length out of range");
+			}
+			lua_pushlstring(L, ((const char *)ptradd(gmb->data, *offset)), size);
+			luablob_countbytes(readbytes, size);
+			*offset += size;
+			break;
+		case LUABLOB_TYPE_STR:
+			if (!luablob_inbounds(*offset, len, gmb->usedsize))
+			{
+				luaL_error(L, "unable to read data; bounds out of range");
+			}
+			lua_pushlstring(L, ((const char *)ptradd(gmb->data, *offset)), len);
+			luablob_countbytes(readbytes, len);
+			*offset += len;
+			break;
+		case LUABLOB_TYPE_CHAR:
+			if (!luablob_inbounds(*offset, sizeof(char), gmb->usedsize))
+			{
+				luaL_error(L, "unable to read data; bounds out of range");
+			}
+			lua_pushlstring(L, ((const char *)ptradd(gmb->data, *offset)), sizeof(char));
+			*offset += sizeof(char);
+			break;
+		case LUABLOB_TYPE_I8:
+			if (!luablob_inbounds(*offset, sizeof(int8_t), gmb->usedsize))
+			{
+				luaL_error(L, "unable to read data; bounds out of range");
+			}
+			lua_pushinteger(L, (lua_Integer)(*((int8_t *)ptradd(gmb->data, *offset))));
+			*offset += sizeof(int8_t);
+			break;
+		case LUABLOB_TYPE_U8:
+			if (!luablob_inbounds(*offset, sizeof(uint8_t), gmb->usedsize))
+			{
+				luaL_error(L, "unable to read data; bounds out of range");
+			}
+			lua_pushunsigned(L, (lua_Unsigned)(*((uint8_t *)ptradd(gmb->data, *offset))));
+			*offset += sizeof(uint8_t);
+			break;
+		case LUABLOB_TYPE_I16:
+			if (!luablob_inbounds(*offset, sizeof(int16_t), gmb->usedsize))
+			{
+				luaL_error(L, "unable to read data; bounds out of range");
+			}
+			lua_pushinteger(L, (lua_Integer)(*((int16_t *)ptradd(gmb->data, *offset))));
+			*offset += sizeof(int16_t);
+			break;
+		case LUABLOB_TYPE_U16:
+			if (!luablob_inbounds(*offset, sizeof(uint16_t), gmb->usedsize))
+			{
+				luaL_error(L, "unable to read data; bounds out of range");
+			}
+			lua_pushunsigned(L, (lua_Unsigned)(*((uint16_t *)ptradd(gmb->data, *offset))));
+			*offset += sizeof(uint16_t);
+			break;
+		case LUABLOB_TYPE_I32:
+			if (!luablob_inbounds(*offset, sizeof(int32_t), gmb->usedsize))
+			{
+				luaL_error(L, "unable to read data; bounds out of range");
+			}
+			lua_pushinteger(L, (lua_Integer)(*((int32_t *)ptradd(gmb->data, *offset))));
+			*offset += sizeof(int32_t);
+			break;
+		case LUABLOB_TYPE_U32:
+			if (!luablob_inbounds(*offset, sizeof(uint32_t), gmb->usedsize))
+			{
+				luaL_error(L, "unable to read data; bounds out of range");
+			}
+			lua_pushunsigned(L, (lua_Unsigned)(*((uint32_t *)ptradd(gmb->data, *offset))));
+			*offset += sizeof(uint32_t);
+			break;
+		case LUABLOB_TYPE_I64:
+			if (!luablob_inbounds(*offset, sizeof(int64_t), gmb->usedsize))
+			{
+				luaL_error(L, "unable to read data; bounds out of range");
+			}
+			lua_pushinteger(L, (lua_Integer)(*((int64_t *)ptradd(gmb->data, *offset))));
+			*offset += sizeof(int64_t);
+			break;
+		case LUABLOB_TYPE_U64:
+			if (!luablob_inbounds(*offset, sizeof(uint64_t), gmb->usedsize))
+			{
+				luaL_error(L, "unable to read data; bounds out of range");
+			}
+			lua_pushnumber(L, (lua_Number)(*((uint64_t *)ptradd(gmb->data, *offset))));
+			*offset += sizeof(uint64_t);
+			break;
+		case LUABLOB_TYPE_FLOAT:
+			if (!luablob_inbounds(*offset, sizeof(float), gmb->usedsize))
+			{
+				luaL_error(L, "unable to read data; bounds out of range");
+			}
+			lua_pushnumber(L, (lua_Number)(*((float *)ptradd(gmb->data, *offset))));
+			*offset += sizeof(float);
+			break;
+		case LUABLOB_TYPE_DOUBLE:
+			if (!luablob_inbounds(*offset, sizeof(double), gmb->usedsize))
+			{
+				luaL_error(L, "unable to read data; bounds out of range");
+			}
+			lua_pushnumber(L, (lua_Number)(*((double *)ptradd(gmb->data, *offset))));
+			*offset += sizeof(double);
+			break;
+		case LUABLOB_TYPE_I16LE:
+		case LUABLOB_TYPE_I16BE:
+		case LUABLOB_TYPE_U16LE:
+		case LUABLOB_TYPE_U16BE:
+		case LUABLOB_TYPE_I32LE:
+		case LUABLOB_TYPE_I32BE:
+		case LUABLOB_TYPE_U32LE:
+		case LUABLOB_TYPE_U32BE:
+		case LUABLOB_TYPE_I64LE:
+		case LUABLOB_TYPE_I64BE:
+		case LUABLOB_TYPE_U64LE:
+		case LUABLOB_TYPE_U64BE:
+		case LUABLOB_TYPE_FLOATLE:
+		case LUABLOB_TYPE_FLOATBE:
+		case LUABLOB_TYPE_DOUBLELE:
+		case LUABLOB_TYPE_DOUBLEBE:
+			lua_blob_read_ordered(L, gmb, offset, type);
+			break;
+		case LUABLOB_TYPE_UVARINT:
+		case LUABLOB_TYPE_SVARINT:
+		case LUABLOB_TYPE_VARSTR:
+			lua_blob_read_varint(L, gmb, offset, type);
+			break;
+		default:
+			luaL_error(L, "unrecognized datatype specifier '%s'", luablob_typenames[type]);
+	}
+}
+
+void lua_blob_read_type(lua_State *L, GenericMemoryBlob *gmb, size_t *offset, const char *type)
+{	//STACK:	start:	?
+	//			end:	? value
+	int id;
+
+	luaL_checkstack(L, 1, NULL);
+
+	id = luablob_typeid(type);
+	if (id == LUABLOB_TYPE_NONE || id == LUABLOB_TYPE_STR || id == LUABLOB_TYPE_BLOB)
+	{
+		luaL_error(L, "unrecognized datatype specifier '%s'", type);
+	}
+
+	lua_blob_read_typeid(L, gmb, offset, id, 0);
+}
+
+LUA_CFUNCTION_F lua_blob_read(lua_State *L)
+{	//STACK: gmb infos...
+	GenericMemoryBlob *gmb;
+	GenericMemoryBlob *destblob;
+	int i;
+	int hasoffset;
+	size_t offset;
+	size_t destoffset;
+	size_t size;
+	int count;
+	int results;
+	const char *type;
+
+	gmb = luablob_checkgmb(L, 1);
+
+	offset = 0;
+	results = 0;
+	count = lua_gettop(L);
+	type = NULL;
+	for(i = 2; i <= count; ++i)
+	{
+		switch(lua_type(L, i))
+		{
+			case LUA_TNUMBER:
+				offset += lua_tointeger(L, i);
+				break;
+			case LUA_TSTRING:
+				type = lua_tostring(L, i);
+				lua_blob_read_type(L, gmb, &offset, type);	//STACK: gmb infos... values... value
+				++results;
+				break;
+			case LUA_TTABLE:
+				luaL_checkstack(L, 1, NULL);
+
+				lua_pushliteral(L, "type");				//STACK: gmb infos... values... 'type'
+				lua_gettable(L, i);						//STACK: gmb infos... values... type
+				type = (lua_isnil(L, -1) ? NULL : luaL_checkstring(L, -1));
+				lua_pop(L, 1);							//STACK: gmb infos... values...
+
+				hasoffset = 0;
+				lua_pushliteral(L, "offset");			//STACK: gmb infos... values... 'offset'
+				lua_gettable(L, i);						//STACK: gmb infos... values... offset
+				if (!lua_isnil(L, -1))
+				{
+					hasoffset = 1;
+					offset += (size_t)lua_tointeger(L, -1);
+				}
+				lua_pop(L, 1);							//STACK: gmb infos... values...
+
+				lua_pushliteral(L, "pos");				//STACK: gmb infos... values... 'pos'
+				lua_gettable(L, i);						//STACK: gmb infos... values... pos
+				if (!lua_isnil(L, -1))
+				{
+					if (hasoffset)
+					{
+						luaL_error(L, "a read information table may not contain both a position and an offset");
+					}
+					offset = luablob_checksize(L, -1);
+				}
+				lua_pop(L, 1);							//STACK: gmb infos... values...
+
+				if (type != NULL)
+				{
+					if (strcmp(type, "str") == 0)
+					{
+						lua_pushliteral(L, "len");			//STACK: gmb infos... values... 'len'
+						lua_gettable(L, i);					//STACK: gmb infos... values... len
+						size = luablob_checksize(L, -1);
+						lua_pop(L, 1);						//STACK: gmb infos... values...
+
+						lua_blob_read_typeid(L, gmb, &offset, LUABLOB_TYPE_STR, size);	//STACK: gmb infos... values... value
+						++results;
+					}
+					else if (strcmp(type, "blob") == 0)
+					{
+						luaL_checkstack(L, 3, NULL);
+
+						lua_pushcfunction(L, &lua_blob_newblob);	//STACK: gmb infos... values... newblob
+						lua_pushliteral(L, "len");			//STACK: gmb infos... values... newblob 'len'
+						lua_gettable(L, i);					//STACK: gmb infos... values... newblob len
+						size = luablob_checksize(L, -1);
+
+						if (!luablob_inbounds(offset, size, gmb->usedsize))
+						{
+							luaL_error(L, "unable to read data; bounds out of range");
+						}
+
+						lua_pushliteral(L, "dest");			//STACK: gmb infos... values... newblob len 'dest'
+						lua_gettable(L, i);					//STACK: gmb infos... values... newblob len dest
+						if (lua_isnil(L, -1))
+						{
+							lua_pop(L, 1);					//STACK: gmb infos... values... newblob len
+							lua_pushliteral(L, "mode");		//STACK: gmb infos... values... newblob len 'mode'
+							lua_gettable(L, i);				//STACK: gmb infos... values... newblob len mode
+							if (lua_isnil(L, -1))
+							{
+								lua_pop(L, 1);				//STACK: gmb infos... values.. newblob len
+								lua_call(L, 1, 1);			//STACK: gmb infos... values.. value
+							}
+							else
+							{
+								lua_call(L, 2, 1);			//STACK: gmb infos... values.. value
+							}
+
+							destblob = (GenericMemoryBlob *)lua_touserdata(L, -1);
+							destblob->usedsize = size;
+							memcpy(destblob->data, ptradd(gmb->data, offset), size);
+							luablob_countbytes(readbytes, size);
+							++results;
+						}
+						else
+						{
+							destblob = luablob_checkgmb(L, -1);
+							lua_pop(L, 2);					//STACK: gmb infos... values...
+
+							lua_pushliteral(L, "start");	//STACK: gmb infos... values... 'start'
+							lua_gettable(L, i);				//STACK: gmb infos... values... start
+							destoffset = luablob_optsize(L, -1, 0);
+							lua_pop(L, 1);					//STACK: gmb infos... values...
+
+							if (destoffset > destblob->usedsize)
+							{
+								luaL_error(L, "destination blob does not contain read start offset");
+							}
+
+							luablob_copyblob(L, destblob, destoffset, gmb, offset, size);
+							luablob_countbytes(readbytes, size);
+						}
+						offset += size;
+					}
+					else
+					{
+						lua_blob_read_type(L, gmb, &offset, type);	//STACK: gmb infos... values... value
+						++results;
+					}
+				}
+				break;
+			default:
+				luaL_error(L, "invalid argument; a read information item must be an offset delta integer, a datatype specifier string, or a read information table");
+		}
+	}
+
+	return results;
+}
+
+void lua_blob_write_typeid(lua_State *L, GenericMemoryBlob *gmb, size_t *offset, int type, int valueindex, size_t start, size_t count)
+{	//STACK: ?
+	//NOTICE: start is the source character index for 'char' and the source offset for 'blob'; count is only used by 'blob', where (size_t)-1 means 'to the end'.
+	GenericMemoryBlob *srcblob;
+	GenericMemoryBlob shared;
+	const char *data;
+	size_t size;
+	size_t j;
+
+	switch (type)
+	{
+		case LUABLOB_TYPE_CSTR:
+			data = luaL_checklstring(L, valueindex, &size);
+			if (size > 1)
+			{
+				for(j = 0; j < (size - 1); ++j)
+				{
+					if (data[j] == '\0')
+					{
+						luaL_error(L, "specified cstr contains an internal null character");
+					}
+				}
+
+				if (gmb_resizeraw(gmb, (*offset + size), 0 /* FALSE */) == 0)
+				{
+					luaL_error(L, "failed to allocate blob memory");
+				}
+				memcpy(ptradd(gmb->data, *offset), data, size);
+				luablob_countbytes(writebytes, size);
+				*offset += size;
+			}
+			break;
+		case LUABLOB_TYPE_U8STR:
+			data = luaL_checklstring(L, valueindex, &size);
+			if (size > UINT8_MAX)
+			{
+				luaL_error(L, "string too large to be represented by u8str");
+			}
+			if (gmb_resizeraw(gmb, (*offset + sizeof(uint8_t) + size), 0 /* FALSE */) == 0)
+			{
+				luaL_error(L, "failed to allocate blob memory");
+			}
+
+			*((uint8_t *)ptradd(gmb->data, *offset)) = (uint8_t)size;
+			*offset += sizeof(uint8_t);
+
+			memcpy(ptradd(gmb->data, *offset), data, size);
+			luablob_countbytes(writebytes, size);
+			*offset += size;
+			break;
+		case LUABLOB_TYPE_U16STR:
+			data = luaL_checklstring(L, valueindex, &size);
+			if (size > UINT16_MAX)
+			{
+				luaL_error(L, "string too large to be represented by u16str");
+			}
+			if (gmb_resizeraw(gmb, (*offset + sizeof(uint16_t) + size), 0 /* FALSE */) == 0)
+			{
+				luaL_error(L, "failed to allocate blob memory");
+			}
+
+			*((uint16_t *)ptradd(gmb->data, *offset)) = (uint16_t)size;
+			*offset += sizeof(uint16_t);
+
+			memcpy(ptradd(gmb->data, *offset), data, size);
+			luablob_countbytes(writebytes, size);
+			*offset += size;
+			break;
+		case LUABLOB_TYPE_U32STR:
+			data = luaL_checklstring(L, valueindex, &size);
+			if (size > UINT32_MAX)
+			{
+				luaL_error(L, "string too large to be represented by u32str");
+			}
+			if (gmb_resizeraw(gmb, (*offset + sizeof(uint32_t) + size), 0 /* FALSE */) == 0)
+			{
+				luaL_error(L, "failed to allocate blob memory");
+			}
+
+			*((uint32_t *)ptradd(gmb->data, *offset)) = (uint32_t)size;
+			*offset += sizeof(uint32_t);
+
+			memcpy(ptradd(gmb->data, *offset), data, size);
+			luablob_countbytes(writebytes, size);
+			*offset += size;
+			break;
+		case LUABLOB_TYPE_CHAR:
+			data = luaL_checklstring(L, valueindex, &size);
+			if (size != 0)
+			{
+				if (start >= size)
+				{
+					luaL_error(L, "start index out of range");
+				}
+
+				if (gmb_resizeraw(gmb, (*offset + sizeof(char)), 0 /* FALSE */) == 0)
+				{
+					luaL_error(L, "failed to allocate blob memory");
+				}
+
+				*((char *)ptradd(gmb->data, *offset)) = data[start];
+				*offset += sizeof(char);
+			}
+			break;
+		case LUABLOB_TYPE_I8:
+			if (gmb_resizeraw(gmb, (*offset + sizeof(int8_t)), 0 /* FALSE */) == 0)
+			{
+				luaL_error(L, "failed to allocate blob memory");
+			}
+
+			*((int8_t *)ptradd(gmb->data, *offset)) = (int8_t)luaL_checkinteger(L, valueindex);
+			*offset += sizeof(int8_t);
+			break;
+		case LUABLOB_TYPE_U8:
+			if (gmb_resizeraw(gmb, (*offset + sizeof(uint8_t)), 0 /* FALSE */) == 0)
+			{
+				luaL_error(L, "failed to allocate blob memory");
+			}
+
+			*((uint8_t *)ptradd(gmb->data, *offset)) = (uint8_t)luaL_checkunsigned(L, valueindex);
+			*offset += sizeof(uint8_t);
+			break;
+		case LUABLOB_TYPE_I16:
+			if (gmb_resizeraw(gmb, (*offset + sizeof(int16_t)), 0 /* FALSE */) == 0)
+			{
+				luaL_error(L, "failed to allocate blob memory");
+			}
+
+			*((int16_t *)ptradd(gmb->data, *offset)) = (int16_t)luaL_checkinteger(L, valueindex);
+			*offset += sizeof(int16_t);
+			break;
+		case LUABLOB_TYPE_U16:
+			if (gmb_resizeraw(gmb, (*offset + sizeof(uint16_t)), 0 /* FALSE */) == 0)
+			{
+				luaL_error(L, "failed to allocate blob memory");
+			}
+
+			*((uint16_t *)ptradd(gmb->data, *offset)) = (uint16_t)luaL_checkunsigned(L, valueindex);
+			*offset += sizeof(uint16_t);
+			break;
+		case LUABLOB_TYPE_I32:
+			if (gmb_resizeraw(gmb, (*offset + sizeof(int32_t)), 0 /* FALSE */) == 0)
+			{
+				luaL_error(L, "failed to allocate blob memory");
+			}
+
+			*((int32_t *)ptradd(gmb->data, *offset)) = (int32_t)luaL_checkinteger(L, valueindex);
+			*offset += sizeof(int32_t);
+			break;
+		case LUABLOB_TYPE_U32:
+			if (gmb_resizeraw(gmb, (*offset + sizeof(uint32_t)), 0 /* FALSE */) == 0)
+			{
+				luaL_error(L, "failed to allocate blob memory");
+			}
+
+			*((uint32_t *)ptradd(gmb->data, *offset)) = (uint32_t)luaL_checkunsigned(L, valueindex);
+			*offset += sizeof(uint32_t);
+			break;
+		case LUABLOB_TYPE_I64:
+			if (gmb_resizeraw(gmb, (*offset + sizeof(int64_t)), 0 /* FALSE */) == 0)
+			{
+				luaL_error(L, "failed to allocate blob memory");
+			}
+
+			*((int64_t *)ptradd(gmb->data, *offset)) = (int64_t)luaL_checkinteger(L, valueindex);
+			*offset += sizeof(int64_t);
+			break;
+		case LUABLOB_TYPE_U64:
+			if (gmb_resizeraw(gmb, (*offset + sizeof(uint64_t)), 0 /* FALSE */) == 0)
+			{
+				luaL_error(L, "failed to allocate blob memory");
+			}
+
+			*((uint64_t *)ptradd(gmb->data, *offset)) = luablob_checku64(L, valueindex);
+			*offset += sizeof(uint64_t);
+			break;
+		case LUABLOB_TYPE_FLOAT:
+			if (gmb_resizeraw(gmb, (*offset + sizeof(float)), 0 /* FALSE */) == 0)
+			{
+				luaL_error(L, "failed to allocate blob memory");
+			}
+
+			*((float *)ptradd(gmb->data, *offset)) = (float)luaL_checknumber(L, valueindex);
+			*offset += sizeof(float);
+			break;
+		case LUABLOB_TYPE_DOUBLE:
+			if (gmb_resizeraw(gmb, (*offset + sizeof(double)), 0 /* FALSE */) == 0)
+			{
+				luaL_error(L, "failed to allocate blob memory");
+			}
+
+			*((double *)ptradd(gmb->data, *offset)) = (double)luaL_checknumber(L, valueindex);
+			*offset += sizeof(double);
+			break;
+		case LUABLOB_TYPE_I16LE:
+		case LUABLOB_TYPE_I16BE:
+		case LUABLOB_TYPE_U16LE:
+		case LUABLOB_TYPE_U16BE:
+		case LUABLOB_TYPE_I32LE:
+		case LUABLOB_TYPE_I32BE:
+		case LUABLOB_TYPE_U32LE:
+		case LUABLOB_TYPE_U32BE:
+		case LUABLOB_TYPE_I64LE:
+		case LUABLOB_TYPE_I64BE:
+		case LUABLOB_TYPE_U64LE:
+		case LUABLOB_TYPE_U64BE:
+		case LUABLOB_TYPE_FLOATLE:
+		case LUABLOB_TYPE_FLOATBE:
+		case LUABLOB_TYPE_DOUBLELE:
+		case LUABLOB_TYPE_DOUBLEBE:
+			lua_blob_write_ordered(L, gmb, offset, type, valueindex);
+			break;
+		case LUABLOB_TYPE_UVARINT:
+		case LUABLOB_TYPE_SVARINT:
+		case LUABLOB_TYPE_VARSTR:
+			lua_blob_write_varint(L, gmb, offset, type, valueindex);
+			break;
+		case LUABLOB_TYPE_STR:
+			data = luaL_checklstring(L, valueindex, &size);
+			if (size != 0)
+			{
+				if (gmb_resizeraw(gmb, (*offset + size), 0 /* FALSE */) == 0)
+				{
+					luaL_error(L, "failed to allocate blob memory");
+				}
+
+				memcpy(ptradd(gmb->data, *offset), data, size);
+				luablob_countbytes(writebytes, size);
+				*offset += size;
+			}
+			break;
+		case LUABLOB_TYPE_BLOB:
+			srcblob = luablob_checkgmb(L, valueindex);
+			if (srcblob->usedsize != 0)
+			{
+				if (start > srcblob->usedsize)
+				{
+					luaL_error(L, "access to value luablob was out of bounds");
+				}
+				size = ((count == ((size_t)-1)) ? (srcblob->usedsize - start) : count);
+				if (!luablob_inbounds(start, size, srcblob->usedsize))
+				{
+					luaL_error(L, "access to value luablob was out of bounds");
+				}
+
+				if (
+					(*offset == 0) &&
+					(start == 0) &&
+					(size == srcblob->usedsize) &&
+					(size >= LUABLOB_SHARE_MIN) &&
+					(srcblob != gmb) &&
+					luablob_shareable(srcblob) &&
+					luablob_samestorage(gmb, srcblob)
+				)
+				{
+					//replacing the whole destination with the whole source in the same mode; share the storage instead of copying it
+					luablob_share(L, srcblob, &shared);
+					gmb_free(gmb);
+					*gmb = shared;
+					*offset += size;
+					break;
+				}
+
+				luablob_copyblob(L, gmb, *offset, srcblob, start, size);
+				luablob_countbytes(writebytes, size);
+				*offset += size;
+			}
+			break;
+		default:
+			luaL_error(L, "unrecognized datatype specifier '%s'", luablob_typenames[type]);
+	}
+}
+
+LUA_CFUNCTION_F lua_blob_write(lua_State *L)
+{
+	//STACK: gmb infos...
+	GenericMemoryBlob *gmb;
+	size_t offset;
+	size_t srcoffset;
+	size_t srccount;
+	const char *data;
+	const char *type;
+	int id;
+	size_t size;
+	int count;
+	int i;
+	int hasoffset;
+
+	gmb = luablob_checkgmb(L, 1);
+
+	offset = 0;
+	count = lua_gettop(L);
+	for(i = 2; i <= count; ++i)
+	{
+		switch(lua_type(L, i))
+		{
+			case LUA_TNUMBER:
+				offset += lua_tointeger(L, i);
+				break;
+			case LUA_TSTRING:
+				if (offset > gmb->usedsize)
+				{
+					luaL_error(L, "destination blob does not contain write start offset");
+				}
+
+				data = lua_tolstring(L, i, &size);
+				if (size != 0)
+				{
+					if (gmb_resizeraw(gmb, (offset + size), 0 /* FALSE */) == 0)
+					{
+						luaL_error(L, "failed to allocate blob memory");
+					}
+
+					memcpy(ptradd(gmb->data, offset), data, size);
+					luablob_countbytes(writebytes, size);
+					offset += size;
+				}
+				break;
+			case LUA_TTABLE:
+				luaL_checkstack(L, 1, NULL);
+				lua_pushliteral(L, "type");			//STACK: gmb infos... 'type'
+				lua_gettable(L, i);					//STACK: gmb infos... type
+				type = (lua_isnil(L, -1) ? NULL : luaL_checkstring(L, -1));
+				lua_pop(L, 1);						//STACK: gmb infos...
+
+				hasoffset = 0;
+				lua_pushliteral(L, "offset");		//STACK: gmb infos... 'offset'
+				lua_gettable(L, i);					//STACK: gmb infos... offset
+				if (!lua_isnil(L, -1))
+				{
+					hasoffset = 1;
+					offset += lua_tointeger(L, -1);
+				}
+				lua_pop(L, 1);						//STACK: gmb infos...
+
+				lua_pushliteral(L, "pos");			//STACK: gmb infos... 'pos'
+				lua_gettable(L, i);					//STACK: gmb infos... pos
+				if (!lua_isnil(L, -1))
+				{
+					if (hasoffset)
+					{
+						luaL_error(L, "a write information table may not contain both a position and an offset");
+					}
+					offset = luablob_checksize(L, -1);
+				}
+				lua_pop(L, 1);						//STACK: gmb infos...
+
+				if (offset > gmb->usedsize)
+				{
+					luaL_error(L, "destination blob does not contain write start offset");
+				}
+
+				if (type != NULL)
+				{
+					id = luablob_typeid(type);
+					if (id == LUABLOB_TYPE_NONE)
+					{
+						luaL_error(L, "unrecognized datatype specifier '%s'", type);
+					}
+
+					lua_pushliteral(L, "value");		//STACK: gmb infos... 'value'
 					lua_gettable(L, i);					//STACK: gmb infos... value
 					if (!lua_isnil(L, -1))
 					{
-						if (strcmp(type, "cstr") == 0)
-						{
-							data = luaL_checklstring(L, -1, &size);
-							if (size > 1)
-							{
-								for(j = 0; j < (size - 1); ++j)
-								{
-									if (data[j] == '\0')
-									{
-										luaL_error(L, "specified cstr contains an internal null character");
-									}
-								}
-
-								if (gmb_resize(gmb, (offset + size), 0 /* FALSE */) == 0)
-								{
-									luaL_error(L, "failed to allocate blob memory");
-								}
-								memcpy(ptradd(gmb->data, offset), data, size);
-								offset += size;
-							}
-						}
-						else if (strcmp(type, "u8str") == 0)
-						{
-							data = luaL_checklstring(L, -1, &size);
-							if (size > UINT8_MAX)
-							{
-								luaL_error(L, "string too large to be represented by u8str");
-							}
-							if (gmb_resize(gmb, (offset + sizeof(uint8_t) + size), 0 /* FALSE */) == 0)
-							{
-								luaL_error(L, "failed to allocate blob memory");
-							}
+						srcoffset = 0;
+						srccount = ((size_t)-1);
+						if (id == LUABLOB_TYPE_CHAR)
+						{
+							lua_checkstack(L, 1);
+							lua_pushliteral(L, "index");	//STACK: gmb infos... value 'index'
+							lua_gettable(L, i);				//STACK: gmb infos... value index
+							srcoffset = luablob_optsize(L, -1, 0);
+							lua_pop(L, 1);					//STACK: gmb infos... value
+						}
+						else if (id == LUABLOB_TYPE_BLOB)
+						{
+							lua_checkstack(L, 1);
+							lua_pushliteral(L, "start");	//STACK: gmb infos... value 'start'
+							lua_gettable(L, i);				//STACK: gmb infos... value start
+							srcoffset = luablob_optsize(L, -1, 0);
+							lua_pop(L, 1);					//STACK: gmb infos... value
+
+							lua_pushliteral(L, "count");	//STACK: gmb infos... value 'count'
+							lua_gettable(L, i);				//STACK: gmb infos... value count
+							if (!lua_isnil(L, -1))
+							{
+								srccount = luablob_checksize(L, -1);
+							}
+							lua_pop(L, 1);					//STACK: gmb infos... value
+						}
+
+						lua_blob_write_typeid(L, gmb, &offset, id, lua_gettop(L), srcoffset, srccount);
+					}
+
+					lua_pop(L, 1);	//STACK: gmb infos...
+				}
+				break;
+			case LUA_TNIL:
+				break;
+			default:
+				luaL_error(L, "invalid argument; a write information item must be nil, an offset delta integer, a data string, or a write information table");
+		}
+	}
+
+	return 0;
+}
+
+//Element converters for readarray/writearray. Each one moves a run of elements between blob memory and a lua_Number
+//scratch buffer in a tight loop the compiler can vectorize; the Lua table side is then a plain rawget/rawset loop.
+#define LUABLOB_ARRAY_CHUNK 256
+
+typedef void (*luablob_arrayload)(lua_Number *dest, const void *src, size_t n);
+typedef void (*luablob_arraystore)(void *dest, const lua_Number *src, size_t n);
+
+typedef struct luablob_arrayops_s
+{
+	size_t size;
+	luablob_arrayload load;
+	luablob_arraystore store;
+} luablob_arrayops;
+
+//lua_Number to unsigned goes through a signed integer for negative values so that -1 wraps like luaL_checkunsigned instead of being undefined
+#define luablob_tosigned(x) ((int64_t)(x))
+#define luablob_tounsigned(x) (((x) < 0) ? ((uint64_t)((int64_t)(x))) : ((uint64_t)(x)))
+
+#define LUABLOB_ARRAY_NATIVE(name, ctype, conv) \
+	void luablob_arrayload_##name(lua_Number *dest, const void *src, size_t n) \
+	{ \
+		size_t i; \
+		ctype v; \
+		for (i = 0; i < n; ++i) \
+		{ \
+			memcpy(&v, ptradd(src, (i * sizeof(ctype))), sizeof(ctype)); \
+			dest[i] = (lua_Number)v; \
+		} \
+	} \
+	void luablob_arraystore_##name(void *dest, const lua_Number *src, size_t n) \
+	{ \
+		size_t i; \
+		ctype v; \
+		for (i = 0; i < n; ++i) \
+		{ \
+			v = (ctype)conv(src[i]); \
+			memcpy(ptradd(dest, (i * sizeof(ctype))), &v, sizeof(ctype)); \
+		} \
+	}
+
+#define LUABLOB_ARRAY_SWAPPED(name, ctype, utype, bswap, conv) \
+	void luablob_arrayload_##name(lua_Number *dest, const void *src, size_t n) \
+	{ \
+		size_t i; \
+		utype u; \
+		ctype v; \
+		for (i = 0; i < n; ++i) \
+		{ \
+			memcpy(&u, ptradd(src, (i * sizeof(utype))), sizeof(utype)); \
+			u = bswap(u); \
+			memcpy(&v, &u, sizeof(utype)); \
+			dest[i] = (lua_Number)v; \
+		} \
+	} \
+	void luablob_arraystore_##name(void *dest, const lua_Number *src, size_t n) \
+	{ \
+		size_t i; \
+		utype u; \
+		ctype v; \
+		for (i = 0; i < n; ++i) \
+		{ \
+			v = (ctype)conv(src[i]); \
+			memcpy(&u, &v, sizeof(utype)); \
+			u = bswap(u); \
+			memcpy(ptradd(dest, (i * sizeof(utype))), &u, sizeof(utype)); \
+		} \
+	}
+
+#define luablob_noconv(x) (x)
+
+LUABLOB_ARRAY_NATIVE(i8, int8_t, luablob_tosigned)
+LUABLOB_ARRAY_NATIVE(u8, uint8_t, luablob_tounsigned)
+LUABLOB_ARRAY_NATIVE(i16, int16_t, luablob_tosigned)
+LUABLOB_ARRAY_NATIVE(u16, uint16_t, luablob_tounsigned)
+LUABLOB_ARRAY_NATIVE(i32, int32_t, luablob_tosigned)
+LUABLOB_ARRAY_NATIVE(u32, uint32_t, luablob_tounsigned)
+LUABLOB_ARRAY_NATIVE(i64, int64_t, luablob_tosigned)
+LUABLOB_ARRAY_NATIVE(u64, uint64_t, luablob_tounsigned)
+LUABLOB_ARRAY_NATIVE(float, float, luablob_noconv)
+LUABLOB_ARRAY_NATIVE(double, double, luablob_noconv)
+LUABLOB_ARRAY_SWAPPED(i16s, int16_t, uint16_t, luablob_bswap16, luablob_tosigned)
+LUABLOB_ARRAY_SWAPPED(u16s, uint16_t, uint16_t, luablob_bswap16, luablob_tounsigned)
+LUABLOB_ARRAY_SWAPPED(i32s, int32_t, uint32_t, luablob_bswap32, luablob_tosigned)
+LUABLOB_ARRAY_SWAPPED(u32s, uint32_t, uint32_t, luablob_bswap32, luablob_tounsigned)
+LUABLOB_ARRAY_SWAPPED(i64s, int64_t, uint64_t, luablob_bswap64, luablob_tosigned)
+LUABLOB_ARRAY_SWAPPED(u64s, uint64_t, uint64_t, luablob_bswap64, luablob_tounsigned)
+LUABLOB_ARRAY_SWAPPED(floats, float, uint32_t, luablob_bswap32, luablob_noconv)
+LUABLOB_ARRAY_SWAPPED(doubles, double, uint64_t, luablob_bswap64, luablob_noconv)
+
+#define LUABLOB_ARRAYOPS(name, ctype) { sizeof(ctype), &luablob_arrayload_##name, &luablob_arraystore_##name }
+#if LUABLOB_BIGENDIAN
+	#define LUABLOB_ARRAYOPS_ORDERED(name, sname, ctype) LUABLOB_ARRAYOPS(sname, ctype), LUABLOB_ARRAYOPS(name, ctype)
+#else
+	#define LUABLOB_ARRAYOPS_ORDERED(name, sname, ctype) LUABLOB_ARRAYOPS(name, ctype), LUABLOB_ARRAYOPS(sname, ctype)
+#endif
+
+//NOTICE: This is indexed by type id and must be kept in the same order as enum luablob_type_e; a size of 0 marks types that cannot be used in arrays.
+const luablob_arrayops luablob_arraytypes[] =
+{
+	{ 0, NULL, NULL },	//none
+	{ 0, NULL, NULL },	//cstr
+	{ 0, NULL, NULL },	//u8str
+	{ 0, NULL, NULL },	//u16str
+	{ 0, NULL, NULL },	//u32str
+	{ 0, NULL, NULL },	//char
+	LUABLOB_ARRAYOPS(i8, int8_t),
+	LUABLOB_ARRAYOPS(u8, uint8_t),
+	LUABLOB_ARRAYOPS(i16, int16_t),
+	LUABLOB_ARRAYOPS(u16, uint16_t),
+	LUABLOB_ARRAYOPS(i32, int32_t),
+	LUABLOB_ARRAYOPS(u32, uint32_t),
+	LUABLOB_ARRAYOPS(i64, int64_t),
+	LUABLOB_ARRAYOPS(u64, uint64_t),
+	LUABLOB_ARRAYOPS(float, float),
+	LUABLOB_ARRAYOPS(double, double),
+	LUABLOB_ARRAYOPS_ORDERED(i16, i16s, int16_t),
+	LUABLOB_ARRAYOPS_ORDERED(u16, u16s, uint16_t),
+	LUABLOB_ARRAYOPS_ORDERED(i32, i32s, int32_t),
+	LUABLOB_ARRAYOPS_ORDERED(u32, u32s, uint32_t),
+	LUABLOB_ARRAYOPS_ORDERED(i64, i64s, int64_t),
+	LUABLOB_ARRAYOPS_ORDERED(u64, u64s, uint64_t),
+	LUABLOB_ARRAYOPS_ORDERED(float, floats, float),
+	LUABLOB_ARRAYOPS_ORDERED(double, doubles, double),
+	{ 0, NULL, NULL },	//uvarint (handled separately by readarray/writearray)
+	{ 0, NULL, NULL },	//svarint
+	{ 0, NULL, NULL },	//varstr
+	{ 0, NULL, NULL },	//str
+	{ 0, NULL, NULL }	//blob
+};
+
+//Decodes up to n varints for readarray, storing how many bytes they used in *used; returns how many were decoded.
+size_t luablob_varint_loadarray(lua_Number *dest, const unsigned char *src, size_t avail, size_t n, int zigzag, size_t *used)
+{
+	uint64_t word;
+	uint64_t value;
+	size_t offset = 0;
+	size_t i = 0;
+	size_t k;
+	size_t len;
+
+	while (i < n)
+	{
+		//runs of single byte varints (no continuation bits in the next eight bytes) are converted eight at a time
+		if ((n - i) >= 8 && (avail - offset) >= 8)
+		{
+			memcpy(&word, (src + offset), sizeof(uint64_t));
+			if ((word & 0x8080808080808080ULL) == 0)
+			{
+				for (k = 0; k < 8; ++k)
+				{
+					value = src[offset + k];
+					dest[i + k] = (zigzag ? (lua_Number)luablob_zigzag_decode(value) : (lua_Number)value);
+				}
+				i += 8;
+				offset += 8;
+				continue;
+			}
+		}
+
+		len = luablob_uvarint_decode((src + offset), (avail - offset), &value);
+		if (len == 0)
+		{
+			break;
+		}
+		dest[i++] = (zigzag ? (lua_Number)luablob_zigzag_decode(value) : (lua_Number)value);
+		offset += len;
+	}
+
+	*used = offset;
+	return i;
+}
+
+int luablob_checkarraytype(lua_State *L, int index)
+{
+	const char *type;
+	int id;
+
+	type = luaL_checkstring(L, index);
+	id = luablob_typeid(type);
+	if (luablob_arraytypes[id].size == 0 && id != LUABLOB_TYPE_UVARINT && id != LUABLOB_TYPE_SVARINT)
+	{
+		luaL_error(L, "invalid argument; datatype '%s' cannot be used in an array", type);
+	}
+
+	return id;
+}
+
+LUA_CFUNCTION_F lua_blob_readarray(lua_State *L)
+{	//STACK: gmb type pos count dest? ?
+	GenericMemoryBlob *gmb;
+	const luablob_arrayops *ops;
+	int id;
+	size_t pos;
+	size_t offset;
+	size_t count;
+	size_t done;
+	size_t n;
+	size_t i;
+	size_t used;
+	lua_Number scratch[LUABLOB_ARRAY_CHUNK];
+
+	gmb = luablob_checkgmb(L, 1);
+	id = luablob_checkarraytype(L, 2);
+	ops = &(luablob_arraytypes[id]);
+	pos = luablob_checksize(L, 3);
+	count = luablob_checksize(L, 4);
+
+	//varints have no fixed size, so they can only be bounds checked as they are decoded
+	if (pos > gmb->usedsize || (ops->size != 0 && count > ((gmb->usedsize - pos) / ops->size)))
+	{
+		luaL_error(L, "unable to read data; bounds out of range");
+	}
+
+	luaL_checkstack(L, 1, NULL);
+	if (lua_isnoneornil(L, 5))
+	{
+		lua_createtable(L, (int)count, 0);		//STACK: gmb type pos count dest? ? tbl
+	}
+	else
+	{
+		luaL_checktype(L, 5, LUA_TTABLE);
+		lua_pushvalue(L, 5);					//STACK: gmb type pos count dest ? tbl
+	}
+
+	offset = pos;
+	for (done = 0; done < count; done += n)
+	{
+		n = (((count - done) < LUABLOB_ARRAY_CHUNK) ? (count - done) : LUABLOB_ARRAY_CHUNK);
+		if (ops->size == 0)
+		{
+			if (luablob_varint_loadarray(scratch, (const unsigned char *)ptradd(gmb->data, offset), (gmb->usedsize - offset), n, (id == LUABLOB_TYPE_SVARINT), &used) != n)
+			{
+				luaL_error(L, "unable to read data; truncated or malformed varint");
+			}
+			offset += used;
+		}
+		else
+		{
+			ops->load(scratch, ptradd(gmb->data, offset), n);
+			offset += (n * ops->size);
+		}
+
+		for (i = 0; i < n; ++i)
+		{
+			lua_pushnumber(L, scratch[i]);		//STACK: gmb type pos count dest? ? tbl value
+			lua_rawseti(L, -2, (int)(done + i + 1));	//STACK: gmb type pos count dest? ? tbl
+		}
+	}
+
+	lua_pushinteger(L, offset);				//STACK: gmb type pos count dest? ? tbl endpos
+	return 2;									//RETURN: tbl endpos
+}
+
+LUA_CFUNCTION_F lua_blob_writearray(lua_State *L)
+{	//STACK: gmb type pos tbl i? j? ?
+	GenericMemoryBlob *gmb;
+	const luablob_arrayops *ops;
+	int id;
+	size_t pos;
+	size_t offset;
+	size_t oldsize;
+	int first;
+	int last;
+	size_t count;
+	size_t done;
+	size_t n;
+	size_t k;
+	size_t len;
+	int isnum;
+	lua_Number scratch[LUABLOB_ARRAY_CHUNK];
+	unsigned char encoded[LUABLOB_ARRAY_CHUNK * LUABLOB_VARINT_MAX];
+
+	gmb = luablob_checkgmb(L, 1);
+	id = luablob_checkarraytype(L, 2);
+	ops = &(luablob_arraytypes[id]);
+	pos = luablob_checksize(L, 3);
+	luaL_checktype(L, 4, LUA_TTABLE);
+	first = luaL_optint(L, 5, 1);
+	last = (lua_isnoneornil(L, 6) ? (int)lua_rawlen(L, 4) : luaL_checkint(L, 6));
+
+	if (pos > gmb->usedsize)
+	{
+		luaL_error(L, "destination blob does not contain write start offset");
+	}
+	if (first < 1)
+	{
+		luaL_error(L, "argument out of range; array start index must be at least 1");
+	}
+	if (last < first)
+	{
+		lua_pushinteger(L, pos);				//STACK: gmb type pos tbl i? j? ? pos
+		return 1;								//RETURN: pos
+	}
+	count = (size_t)((last - first) + 1);
+
+	//fixed size types are sized once up front; varints are encoded a chunk at a time and the blob grown by what they took
+	oldsize = gmb->usedsize;
+	if (ops->size != 0 && gmb_resizeraw(gmb, (pos + (count * ops->size)), 0 /* FALSE */) == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
+
+	luaL_checkstack(L, 1, NULL);
+	offset = pos;
+	for (done = 0; done < count; done += n)
+	{
+		n = (((count - done) < LUABLOB_ARRAY_CHUNK) ? (count - done) : LUABLOB_ARRAY_CHUNK);
+		for (k = 0; k < n; ++k)
+		{
+			lua_rawgeti(L, 4, (int)(first + done + k));	//STACK: gmb type pos tbl i? j? ? value
+			scratch[k] = lua_tonumberx(L, -1, &isnum);
+			if (!isnum)
+			{
+				//never leave the blob exposing bytes that were sized for the array but not yet written
+				gmb->usedsize = ((offset > oldsize) ? offset : oldsize);
+				luaL_error(L, "invalid argument; array element %d is not a number", (int)(first + done + k));
+			}
+			lua_pop(L, 1);						//STACK: gmb type pos tbl i? j? ?
+		}
+
+		if (ops->size == 0)
+		{
+			len = 0;
+			for (k = 0; k < n; ++k)
+			{
+				if (id == LUABLOB_TYPE_SVARINT)
+				{
+					if (!luablob_svarint_inrange(scratch[k]))
+					{
+						luaL_error(L, "argument out of range; svarint values must be from -2^63 up to but not including 2^63");
+					}
+					len += luablob_uvarint_encode((encoded + len), luablob_zigzag_encode((int64_t)scratch[k]));
+				}
+				else
+				{
+					if (!luablob_uvarint_inrange(scratch[k]))
+					{
+						luaL_error(L, "argument out of range; uvarint values must not be negative, NaN or 2^64 and above");
+					}
+					len += luablob_uvarint_encode((encoded + len), (uint64_t)scratch[k]);
+				}
+			}
+
+			if (gmb_resizeraw(gmb, (offset + len), 0 /* FALSE */) == 0)
+			{
+				luaL_error(L, "failed to allocate blob memory");
+			}
+			memcpy(ptradd(gmb->data, offset), encoded, len);
+			offset += len;
+		}
+		else
+		{
+			ops->store(ptradd(gmb->data, offset), scratch, n);
+			offset += (n * ops->size);
+		}
+	}
+
+	lua_pushinteger(L, offset);				//STACK: gmb type pos tbl i? j? ? endpos
+	return 1;									//RETURN: endpos
+}
+
+//Typed array views index straight into their parent's storage with no option parsing; they keep the parent alive through luablob_parentref.
+typedef struct luablob_array_s
+{
+	GenericMemoryBlob *parent;
+	const luablob_arrayops *ops;
+	size_t pos;
+	size_t count;
+	int parentref;
+} luablob_array;
+
+//Returns the address of element i (1 based) or NULL when it is out of range; errors if the parent no longer holds the array.
+void *luablob_array_element(lua_State *L, luablob_array *arr, lua_Number i)
+{
+	if (arr->parent->data == NULL)
+	{
+		luaL_error(L, "unable to use array of freed blob");
+	}
+	if (!luablob_inbounds(arr->pos, (arr->count * arr->ops->size), arr->parent->usedsize))
+	{
+		luaL_error(L, "unable to use array; parent blob no longer contains the array range");
+	}
+	if (!(i >= 1 && i <= (lua_Number)arr->count) || i != (lua_Number)((size_t)i))
+	{
+		return NULL;
+	}
+
+	return ptradd(arr->parent->data, (arr->pos + ((((size_t)i) - 1) * arr->ops->size)));
+}
+
+LUA_CFUNCTION_F lua_luablob_array_mt___index(lua_State *L)
+{	//STACK: arr k
+	luablob_array *arr;
+	void *element;
+	lua_Number value;
+
+	arr = (luablob_array *)lua_touserdata(L, 1);
+	if (lua_type(L, 2) != LUA_TNUMBER)
+	{
+		lua_pushnil(L);		//STACK: arr k nil
+		return 1;			//RETURN: nil
+	}
+
+	element = luablob_array_element(L, arr, lua_tonumber(L, 2));
+	if (element == NULL)
+	{
+		lua_pushnil(L);		//STACK: arr k nil
+		return 1;			//RETURN: nil
+	}
+
+	arr->ops->load(&value, element, 1);
+	lua_pushnumber(L, value);	//STACK: arr k value
+	return 1;					//RETURN: value
+}
+
+LUA_CFUNCTION_F lua_luablob_array_mt___newindex(lua_State *L)
+{	//STACK: arr k v
+	luablob_array *arr;
+	void *element;
+	lua_Number value;
+
+	arr = (luablob_array *)lua_touserdata(L, 1);
+	value = luaL_checknumber(L, 3);
+
+	//copy-on-write storage has to become private before it is written in place
+	if (arr->parent->free == &luablob_shared_free && gmb_unshare(arr->parent) == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
+
+	element = luablob_array_element(L, arr, luaL_checknumber(L, 2));
+	if (element == NULL)
+	{
+		luaL_error(L, "argument out of range; array index must be an integer between 1 and %f", (lua_Number)arr->count);
+	}
+
+	arr->ops->store(element, &value, 1);
+	return 0;
+}
+
+LUA_CFUNCTION_F lua_luablob_array_mt___len(lua_State *L)
+{	//STACK: arr ?
+	lua_pushinteger(L, (lua_Integer)((luablob_array *)lua_touserdata(L, 1))->count);	//STACK: arr ? count
+	return 1;					//RETURN: count
+}
+
+LUA_CFUNCTION_F lua_luablob_array_ipairsaux(lua_State *L)
+{	//STACK: arr i
+	luablob_array *arr;
+	void *element;
+	lua_Number value;
+	lua_Integer i;
+
+	arr = (luablob_array *)lua_touserdata(L, 1);
+	i = (lua_tointeger(L, 2) + 1);
+
+	element = luablob_array_element(L, arr, (lua_Number)i);
+	if (element == NULL)
+	{
+		return 0;
+	}
+
+	arr->ops->load(&value, element, 1);
+	lua_pushinteger(L, i);		//STACK: arr i i
+	lua_pushnumber(L, value);	//STACK: arr i i value
+	return 2;					//RETURN: i value
+}
+
+LUA_CFUNCTION_F lua_luablob_array_mt___ipairs(lua_State *L)
+{	//STACK: arr ?
+	luaL_checkudata(L, 1, "luablob_array_mt");
+
+	lua_pushcfunction(L, &lua_luablob_array_ipairsaux);	//STACK: arr ? aux
+	lua_pushvalue(L, 1);		//STACK: arr ? aux arr
+	lua_pushinteger(L, 0);		//STACK: arr ? aux arr 0
+	return 3;					//RETURN: aux arr 0
+}
+
+LUA_CFUNCTION_F lua_luablob_array_mt___gc(lua_State *L)
+{	//STACK: arr ?
+	luablob_array *arr;
+
+	arr = (luablob_array *)lua_touserdata(L, 1);
+	if (arr->parentref != LUA_NOREF)
+	{
+		lua_pushliteral(L, "luablob_parentref");	//STACK: arr ? 'luablob_parentref'
+		lua_gettable(L, LUA_REGISTRYINDEX);			//STACK: arr ? luablob_parentref
+		luaL_unref(L, -1, arr->parentref);
+		lua_pop(L, 1);								//STACK: arr ?
+		arr->parentref = LUA_NOREF;
+	}
+
+	return 0;
+}
+
+LUA_CFUNCTION_F lua_blob_asarray(lua_State *L)
+{	//STACK: gmb type pos? count? ?
+	GenericMemoryBlob *gmb;
+	luablob_array *arr;
+	luablob_viewinfo *info;
+	const luablob_arrayops *ops;
+	size_t pos;
+	size_t count;
+
+	gmb = luablob_checkgmb(L, 1);
+	ops = &(luablob_arraytypes[luablob_checkarraytype(L, 2)]);
+	if (ops->size == 0)
+	{
+		luaL_error(L, "invalid argument; datatype '%s' has no fixed size", lua_tostring(L, 2));
+	}
+	pos = luablob_optsize(L, 3, 0);
+	if (pos > gmb->usedsize)
+	{
+		luaL_error(L, "argument out of range; array start is beyond the end of the blob");
+	}
+	count = (lua_isnoneornil(L, 4) ? ((gmb->usedsize - pos) / ops->size) : luablob_checksize(L, 4));
+	if (count > ((gmb->usedsize - pos) / ops->size))
+	{
+		luaL_error(L, "argument out of range; array length is beyond the end of the blob");
+	}
+
+	luaL_checkstack(L, 3, NULL);
+
+	arr = (luablob_array *)lua_newuserdata(L, sizeof(luablob_array));	//STACK: gmb type pos? count? ? arr
+	arr->parentref = LUA_NOREF;
+	arr->ops = ops;
+	arr->count = count;
+	luaL_setmetatable(L, "luablob_array_mt");
+
+	lua_pushliteral(L, "luablob_parentref");	//STACK: gmb type pos? count? ? arr 'luablob_parentref'
+	lua_gettable(L, LUA_REGISTRYINDEX);			//STACK: gmb type pos? count? ? arr luablob_parentref
+	if (gmb->free == &luablob_view_free)
+	{
+		//arrays over views reference the underlying blob directly, just like views of views
+		info = (luablob_viewinfo *)gmb->userdata;
+		arr->parent = info->parent;
+		arr->pos = (info->start + pos);
+		lua_rawgeti(L, -1, info->parentref);	//STACK: gmb type pos? count? ? arr luablob_parentref parent
+	}
+	else
+	{
+		arr->parent = gmb;
+		arr->pos = pos;
+		lua_pushvalue(L, 1);					//STACK: gmb type pos? count? ? arr luablob_parentref parent
+	}
+	arr->parentref = luaL_ref(L, -2);			//STACK: gmb type pos? count? ? arr luablob_parentref
+	lua_pop(L, 1);								//STACK: gmb type pos? count? ? arr
+
+	return 1;									//RETURN: arr
+}
+
+//Returns the start offset of a search or count over gmb; init defaults to 0 and may equal the blob size.
+size_t luablob_checkinit(lua_State *L, GenericMemoryBlob *gmb, int index)
+{
+	size_t init;
+
+	init = luablob_optsize(L, index, 0);
+	if (init > gmb->usedsize)
+	{
+		luaL_error(L, "argument out of range; start offset is past the end of the blob");
+	}
+
+	return init;
+}
+
+int luablob_checkbyte(lua_State *L, int index)
+{
+	const char *str;
+	size_t len;
+	lua_Unsigned byte;
+
+	if (lua_type(L, index) == LUA_TSTRING)
+	{
+		str = lua_tolstring(L, index, &len);
+		if (len != 1)
+		{
+			luaL_error(L, "invalid argument; expected a single character string or a byte value");
+		}
+		return (unsigned char)str[0];
+	}
+
+	byte = luaL_checkunsigned(L, index);
+	if (byte > 0xFF)
+	{
+		luaL_error(L, "argument out of range; byte values must be between 0 and 255");
+	}
+	return (int)byte;
+}
+
+//Pushes the absolute offset of a search hit, or nil when the search ran off the end.
+int luablob_pushfound(lua_State *L, size_t init, size_t found, size_t len)
+{	//STACK: ?
+	if (found == len)
+	{
+		lua_pushnil(L);					//STACK: ? nil
+	}
+	else
+	{
+		lua_pushinteger(L, (init + found));	//STACK: ? pos
+	}
+
+	return 1;
+}
+
+LUA_CFUNCTION_F lua_blob_find(lua_State *L)
+{	//STACK: gmb needle init? ?
+	GenericMemoryBlob *gmb;
+	GenericMemoryBlob *needleblob;
+	const void *needle;
+	size_t needlelen;
+	size_t init;
+
+	gmb = luablob_checkgmb(L, 1);
+	if (lua_type(L, 2) == LUA_TSTRING)
+	{
+		needle = lua_tolstring(L, 2, &needlelen);
+	}
+	else
+	{
+		needleblob = luablob_checkgmb(L, 2);
+		needle = needleblob->data;
+		needlelen = needleblob->usedsize;
+	}
+	init = luablob_checkinit(L, gmb, 3);
+
+	if (needlelen == 0)
+	{
+		lua_pushinteger(L, init);		//STACK: gmb needle init? ? init
+		return 1;						//RETURN: init
+	}
+
+	return luablob_pushfound(L, init, blobsearch_find(ptradd(gmb->data, init), (gmb->usedsize - init), needle, needlelen), (gmb->usedsize - init));	//RETURN: pos|nil
+}
+
+LUA_CFUNCTION_F lua_blob_findbyte(lua_State *L)
+{	//STACK: gmb byte init? ?
+	GenericMemoryBlob *gmb;
+	int byte;
+	size_t init;
+
+	gmb = luablob_checkgmb(L, 1);
+	byte = luablob_checkbyte(L, 2);
+	init = luablob_checkinit(L, gmb, 3);
+
+	return luablob_pushfound(L, init, blobsearch_findbyte(ptradd(gmb->data, init), (gmb->usedsize - init), (unsigned char)byte), (gmb->usedsize - init));	//RETURN: pos|nil
+}
+
+LUA_CFUNCTION_F lua_blob_findany(lua_State *L)
+{	//STACK: gmb set init? ?
+	GenericMemoryBlob *gmb;
+	const char *set;
+	size_t setlen;
+	size_t init;
+
+	gmb = luablob_checkgmb(L, 1);
+	set = luaL_checklstring(L, 2, &setlen);
+	init = luablob_checkinit(L, gmb, 3);
+
+	return luablob_pushfound(L, init, blobsearch_findany(ptradd(gmb->data, init), (gmb->usedsize - init), set, setlen), (gmb->usedsize - init));	//RETURN: pos|nil
+}
+
+LUA_CFUNCTION_F lua_blob_count(lua_State *L)
+{	//STACK: gmb byte init? len? ?
+	GenericMemoryBlob *gmb;
+	int byte;
+	size_t init;
+	size_t len;
+
+	gmb = luablob_checkgmb(L, 1);
+	byte = luablob_checkbyte(L, 2);
+	init = luablob_checkinit(L, gmb, 3);
+	len = (lua_isnoneornil(L, 4) ? (gmb->usedsize - init) : luablob_checksize(L, 4));
+	if (len > (gmb->usedsize - init))
+	{
+		luaL_error(L, "unable to read data; bounds out of range");
+	}
+
+	lua_pushinteger(L, blobsearch_count(ptradd(gmb->data, init), len, (unsigned char)byte));	//STACK: gmb byte init? len? ? count
+	return 1;							//RETURN: count
+}
+
+LUA_CFUNCTION_F lua_blob_compare(lua_State *L)
+{	//STACK: gmb other pos? len? ?
+	GenericMemoryBlob *gmb;
+	GenericMemoryBlob *otherblob;
+	const void *other;
+	size_t otherlen;
+	size_t pos;
+	size_t len;
+	int result;
+
+	gmb = luablob_checkgmb(L, 1);
+	if (lua_type(L, 2) == LUA_TSTRING)
+	{
+		other = lua_tolstring(L, 2, &otherlen);
+	}
+	else
+	{
+		otherblob = luablob_checkgmb(L, 2);
+		other = otherblob->data;
+		otherlen = otherblob->usedsize;
+	}
+	pos = luablob_checkinit(L, gmb, 3);
+	if (lua_isnoneornil(L, 4))
+	{
+		len = (gmb->usedsize - pos);
+	}
+	else
+	{
+		len = luablob_checksize(L, 4);
+		if (len > (gmb->usedsize - pos))
+		{
+			luaL_error(L, "unable to read data; bounds out of range");
+		}
+		if (otherlen > len)
+		{
+			otherlen = len;
+		}
+	}
+
+	result = blobsearch_compare(ptradd(gmb->data, pos), len, other, otherlen);
+	lua_pushinteger(L, ((result < 0) ? -1 : ((result > 0) ? 1 : 0)));	//STACK: gmb other pos? len? ? result
+	return 1;					//RETURN: result
+}
+
+LUA_CFUNCTION_F lua_blob_clear(lua_State *L)
+{	//STACK: gmb start? count?
+	GenericMemoryBlob *gmb;
+	size_t start;
+	size_t count;
+	size_t size;
+
+	gmb = luablob_checkgmb(L, 1);
+
+	if (lua_gettop(L) > 1)
+	{
+		start = luablob_checksize(L, 2);
+
+		if (lua_gettop(L) > 2)
+		{
+			count = luablob_checksize(L, 3);
+			if (count > (((size_t)-1) - start))
+			{
+				luaL_error(L, "argument out of range; start index plus count is not addressable");
+			}
+
+			size = (start + count);
+			if (size > gmb->usedsize)
+			{
+				if (gmb_resize(gmb, size, 0 /* FALSE */) == 0)
+				{
+					luaL_error(L, "failed to allocate blob memory");
+				}
+			}
+		}
+		else
+		{
+			if (start > gmb->usedsize)
+			{
+				luaL_error(L, "argument out of range; start index is past the end of the blob");
+			}
+			count = (gmb->usedsize - start);
+		}
+	}
+	else
+	{
+		start = 0;
+		count = gmb->usedsize;
+	}
+
+	if (gmb_unshare(gmb) == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
+	memset(ptradd(gmb->data, start), 0, count);
+
+	return 0;
+}
+
+LUA_CFUNCTION_F lua_blob_resize(lua_State *L)
+{	//STACK: gmb newsize trim|options? ?
+	GenericMemoryBlob *gmb;
+	size_t nsize;
+	int trim;
+	int uninitialized;
+	int result;
+
+	gmb = luablob_checkgmb(L, 1);
+	nsize = luablob_checksize(L, 2);
+
+	if (nsize == 0)
+	{
+		luaL_error(L, "invalid argument: new size must be greater than 0.");
+	}
+
+	trim = 0;
+	uninitialized = 0;
+	if (lua_istable(L, 3))
+	{
+		//the caller promises to overwrite all of the new space when it asks for it uninitialized
+		lua_getfield(L, 3, "trim");				//STACK: gmb newsize options ? trim
+		trim = lua_toboolean(L, -1);
+		lua_getfield(L, 3, "uninitialized");	//STACK: gmb newsize options ? trim uninitialized
+		uninitialized = lua_toboolean(L, -1);
+		lua_pop(L, 2);							//STACK: gmb newsize options ?
+	}
+	else if (lua_gettop(L) > 2)
+	{
+		luaL_checktype(L, 3, LUA_TBOOLEAN);
+		trim = lua_toboolean(L, 3);
+	}
+
+	result = (uninitialized ? gmb_resizeraw(gmb, nsize, trim) : gmb_resize(gmb, nsize, trim));
+	if (result == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
+
+	return 0;
+}
+
+LUA_CFUNCTION_F lua_blob_reserve(lua_State *L)
+{	//STACK: gmb size ?
+	GenericMemoryBlob *gmb;
+
+	gmb = luablob_checkgmb(L, 1);
+	if (gmb_reserve(gmb, luablob_checksize(L, 2)) == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
+
+	return 0;
+}
+
+LUA_CFUNCTION_F lua_blob_view(lua_State *L)
+{	//STACK: gmb start? len? ?
+	GenericMemoryBlob *gmb;
+	GenericMemoryBlob *parent;
+	GenericMemoryBlob view;
+	luablob_viewinfo *info;
+	size_t start;
+	size_t len;
+	void *allocud = NULL;
+
+	gmb = luablob_checkgmb(L, 1);
+	start = luablob_optsize(L, 2, 0);
+	if (start > gmb->usedsize)
+	{
+		luaL_error(L, "argument out of range; view start is beyond the end of the blob");
+	}
+	len = (lua_isnoneornil(L, 3) ? (gmb->usedsize - start) : luablob_checksize(L, 3));
+	if (!luablob_inbounds(start, len, gmb->usedsize))
+	{
+		luaL_error(L, "argument out of range; view length is beyond the end of the blob");
+	}
+
+	luaL_checkstack(L, 3, NULL);
+
+	lua_pushliteral(L, "luablob_parentref");	//STACK: gmb start? len? ? luablob_parentref
+	lua_gettable(L, LUA_REGISTRYINDEX);			//STACK: gmb start? len? ? luablob_parentref
+
+	if (gmb->free == &luablob_view_free)
+	{
+		//views of views reference the underlying blob directly
+		info = (luablob_viewinfo *)gmb->userdata;
+		parent = info->parent;
+		start += info->start;
+		lua_rawgeti(L, -1, info->parentref);	//STACK: gmb start? len? ? luablob_parentref parent
+	}
+	else
+	{
+		parent = gmb;
+		lua_pushvalue(L, 1);					//STACK: gmb start? len? ? luablob_parentref parent
+	}
+
+	info = (luablob_viewinfo *)lua_getallocf(L, &allocud)(allocud, NULL, 0, sizeof(luablob_viewinfo));
+	if (info == NULL)
+	{
+		luaL_error(L, "failed to allocate blob view");
+	}
+	lua_rawgeti(L, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);	//STACK: gmb start? len? ? luablob_parentref parent mainthread
+	info->L = lua_tothread(L, -1);				//the main thread outlives any coroutine that might create the view
+	lua_pop(L, 1);								//STACK: gmb start? len? ? luablob_parentref parent
+	info->parent = parent;
+	info->start = start;
+	info->parentref = luaL_ref(L, -2);			//STACK: gmb start? len? ? luablob_parentref
+	lua_pop(L, 1);								//STACK: gmb start? len? ?
+
+	view.realloc = &luablob_view_realloc;
+	view.free = &luablob_view_free;
+	view.userdata = (void *)info;
+	view.statmode = 0;
+	view.allocsize = len;
+	view.usedsize = len;
+	view.data = ptradd(parent->data, start);
+
+	luablob_pushgmb(L, view);					//STACK: gmb start? len? ? view
+	return 1;									//RETURN: view
+}
+
+LUA_CFUNCTION_F lua_blob_clone(lua_State *L)
+{	//STACK: gmb ?
+	GenericMemoryBlob *gmb;
+	GenericMemoryBlob clone;
+
+	gmb = luablob_checkgmb(L, 1);
+
+	if (!luablob_shareable(gmb))
+	{
+		//views and mappings cannot hand a writer a copy in their own mode, so their clone is an ordinary copy
+		luablob_newgmb(L, &clone, ((gmb->usedsize == 0) ? 1 : gmb->usedsize), "basic");
+		memcpy(clone.data, gmb->data, gmb->usedsize);
+		clone.usedsize = gmb->usedsize;
+	}
+	else
+	{
+		luablob_share(L, gmb, &clone);
+	}
+
+	luablob_pushgmb(L, clone);	//STACK: gmb ? clone
+	return 1;					//RETURN: clone
+}
+
+LUA_CFUNCTION_F lua_blob_setgrowth(lua_State *L)
+{	//STACK: factor cap? ?
+	lua_Number factor;
+
+	factor = luaL_checknumber(L, 1);
+	if (factor <= 1 || factor > 4)
+	{
+		luaL_error(L, "argument out of range; growth factor must be greater than 1 and no more than 4");
+	}
+	luablob_geometric_percent = (size_t)((factor - 1) * 100);
+
+	if (lua_gettop(L) > 1)
+	{
+		luablob_geometric_cap = luablob_checksize(L, 2);
+		if (luablob_geometric_cap == 0)
+		{
+			luaL_error(L, "argument out of range; growth cap must be greater than 0");
+		}
+	}
+
+	return 0;
+}
+
+LUA_CFUNCTION_F lua_blob_sethugepages(lua_State *L)
+{	//STACK: threshold ?
+	luablob_hugepage_threshold = luablob_checksize(L, 1);
+	if (luablob_hugepage_threshold == 0)
+	{
+		luaL_error(L, "argument out of range; huge page threshold must be greater than 0");
+	}
+
+	return 0;
+}
+
+LUA_CFUNCTION_F lua_blob_setdefaultmode(lua_State *L)
+{	//STACK: allocmode ?
+	luablob_defaultmode = luablob_allocmodes[luaL_checkoption(L, 1, NULL, luablob_allocmodes)];
+
+	return 0;
+}
+
+LUA_CFUNCTION_F lua_blob_poolstats(lua_State *L)
+{	//STACK: ?
+	luablob_pool *pool;
+	luablob_poolclass *pc;
+	size_t hits;
+	size_t misses;
+	size_t cached;
+	int c;
+
+	pool = luablob_getpool(L);
+
+	luaL_checkstack(L, 4, NULL);
+	lua_createtable(L, 0, 5);				//STACK: ? stats
+	lua_createtable(L, LUABLOB_POOL_CLASSES, 0);	//STACK: ? stats classes
+
+	hits = 0;
+	misses = 0;
+	cached = 0;
+	for (c = 0; c < LUABLOB_POOL_CLASSES; ++c)
+	{
+		pc = &(pool->classes[c]);
+		hits += pc->hits;
+		misses += pc->misses;
+		cached += (pc->cached << (c + LUABLOB_POOL_MINSHIFT));
+
+		lua_createtable(L, 0, 4);			//STACK: ? stats classes class
+		lua_pushnumber(L, (lua_Number)(((size_t)1) << (c + LUABLOB_POOL_MINSHIFT)));	//STACK: ? stats classes class size
+		lua_setfield(L, -2, "size");		//STACK: ? stats classes class
+		lua_pushnumber(L, (lua_Number)pc->hits);	//STACK: ? stats classes class hits
+		lua_setfield(L, -2, "hits");		//STACK: ? stats classes class
+		lua_pushnumber(L, (lua_Number)pc->misses);	//STACK: ? stats classes class misses
+		lua_setfield(L, -2, "misses");		//STACK: ? stats classes class
+		lua_pushnumber(L, (lua_Number)pc->cached);	//STACK: ? stats classes class cached
+		lua_setfield(L, -2, "cached");		//STACK: ? stats classes class
+		lua_rawseti(L, -2, (c + 1));		//STACK: ? stats classes
+	}
+	lua_setfield(L, -2, "classes");			//STACK: ? stats
+
+	lua_pushnumber(L, (lua_Number)hits);	//STACK: ? stats hits
+	lua_setfield(L, -2, "hits");			//STACK: ? stats
+	lua_pushnumber(L, (lua_Number)misses);	//STACK: ? stats misses
+	lua_setfield(L, -2, "misses");			//STACK: ? stats
+	lua_pushnumber(L, (lua_Number)cached);	//STACK: ? stats cachedbytes
+	lua_setfield(L, -2, "cachedbytes");		//STACK: ? stats
+	lua_pushnumber(L, (lua_Number)pool->live);	//STACK: ? stats live
+	lua_setfield(L, -2, "live");			//STACK: ? stats
+
+	return 1;								//RETURN: stats
+}
+
+void luablob_pushmodestats(lua_State *L, luablob_modestats *ms)
+{	//STACK:	start:	?
+	//			end:	? stats
+	lua_createtable(L, 0, 5);				//STACK: ? stats
+	lua_pushnumber(L, (lua_Number)ms->created);	//STACK: ? stats created
+	lua_setfield(L, -2, "created");			//STACK: ? stats
+	lua_pushnumber(L, (lua_Number)ms->freed);	//STACK: ? stats freed
+	lua_setfield(L, -2, "freed");			//STACK: ? stats
+	lua_pushnumber(L, (lua_Number)ms->live);	//STACK: ? stats live
+	lua_setfield(L, -2, "live");			//STACK: ? stats
+	lua_pushnumber(L, (lua_Number)ms->peak);	//STACK: ? stats peak
+	lua_setfield(L, -2, "peak");			//STACK: ? stats
+	lua_pushnumber(L, (lua_Number)ms->reallocs);	//STACK: ? stats reallocs
+	lua_setfield(L, -2, "reallocs");		//STACK: ? stats
+}
+
+LUA_CFUNCTION_F lua_blob_stats(lua_State *L)
+{	//STACK: ?
+	int m;
+
+	luaL_checkstack(L, 4, NULL);
+	lua_createtable(L, 0, 5);				//STACK: ? stats
+	lua_createtable(L, 0, LUABLOB_STATMODES);	//STACK: ? stats modes
+
+	for (m = 0; m < LUABLOB_STATMODES; ++m)
+	{
+		luablob_pushmodestats(L, &(luablob_counters.modes[m]));	//STACK: ? stats modes mode
+		lua_setfield(L, -2, luablob_allocmodes[m]);	//STACK: ? stats modes
+	}
+	lua_setfield(L, -2, "modes");			//STACK: ? stats
+
+	luablob_pushmodestats(L, &(luablob_counters.total));	//STACK: ? stats total
+	lua_setfield(L, -2, "total");			//STACK: ? stats
+	lua_pushnumber(L, (lua_Number)luablob_counters.readbytes);	//STACK: ? stats readbytes
+	lua_setfield(L, -2, "readbytes");		//STACK: ? stats
+	lua_pushnumber(L, (lua_Number)luablob_counters.writebytes);	//STACK: ? stats writebytes
+	lua_setfield(L, -2, "writebytes");		//STACK: ? stats
+	lua_pushnumber(L, (lua_Number)luablob_counters.zerobytes);	//STACK: ? stats zerobytes
+	lua_setfield(L, -2, "zerobytes");		//STACK: ? stats
+
+	return 1;								//RETURN: stats
+}
+
+//Clears the event counters; live bytes describe storage that still exists, so they are kept and become the new peak.
+LUA_CFUNCTION_F lua_blob_resetstats(lua_State *L)
+{	//STACK: ?
+	luablob_modestats *ms;
+	int m;
+
+	(void)L;
+	for (m = 0; m <= LUABLOB_STATMODES; ++m)
+	{
+		ms = ((m < LUABLOB_STATMODES) ? &(luablob_counters.modes[m]) : &(luablob_counters.total));
+		ms->created = 0;
+		ms->freed = 0;
+		ms->reallocs = 0;
+		ms->peak = ms->live;
+	}
+	luablob_counters.readbytes = 0;
+	luablob_counters.writebytes = 0;
+	luablob_counters.zerobytes = 0;
+
+	return 0;
+}
+
+LUA_CFUNCTION_F lua_blob_freeblob(lua_State *L)
+{	//STACK: gmb ?
+	gmb_free(luablob_checkgmb(L, 1));
+
+	return 0;	//RETURN
+}
+
+//A compiled plan is a flat array of pre-parsed fields, so plan:read and plan:write never touch an information table or a type name.
+typedef struct luablob_planfield_s
+{
+	int type;
+	int haspos;
+	size_t pos;				//relative to the position passed to plan:read / plan:write
+	lua_Integer delta;
+	size_t len;				//'str' and 'blob' reads
+	size_t start;			//'char' source index and 'blob' source offset for writes
+	size_t count;			//'blob' source count for writes; (size_t)-1 means 'to the end'
+	const char *mode;		//allocation mode of blobs produced by 'blob' reads (anchored in the constant table)
+	int constant;			//index of the write value in the constant table; 0 if the value is passed to plan:write
+} luablob_planfield;
+
+typedef struct luablob_plan_s
+{
+	int fieldcount;
+	int results;
+	int constref;
+	luablob_planfield fields[1];
+} luablob_plan;
+
+LUA_CFUNCTION_F lua_blob_compile(lua_State *L)
+{	//STACK: infos...
+	luablob_plan *plan;
+	luablob_planfield *field;
+	int count;
+	int constcount;
+	int hasoffset;
+	int haspos;
+	size_t pos;
+	lua_Integer delta;
+	const char *type;
+	int i;
+
+	count = lua_gettop(L);
+	luaL_checkstack(L, 4, NULL);
+
+	plan = (luablob_plan *)lua_newuserdata(L, (sizeof(luablob_plan) + (count * sizeof(luablob_planfield))));	//STACK: infos... plan
+	plan->fieldcount = 0;
+	plan->results = 0;
+	plan->constref = LUA_NOREF;
+	lua_pushliteral(L, "luablob_plan_mt");	//STACK: infos... plan 'luablob_plan_mt'
+	lua_gettable(L, LUA_REGISTRYINDEX);		//STACK: infos... plan luablob_plan_mt
+	lua_setmetatable(L, -2);				//STACK: infos... plan
+
+	lua_newtable(L);						//STACK: infos... plan consts
+	constcount = 0;
+
+	haspos = 0;
+	pos = 0;
+	delta = 0;
+	for (i = 1; i <= count; ++i)
+	{
+		field = &(plan->fields[plan->fieldcount]);
+		switch (lua_type(L, i))
+		{
+			case LUA_TNUMBER:
+				delta += lua_tointeger(L, i);
+				continue;
+			case LUA_TSTRING:
+				type = lua_tostring(L, i);
+				field->type = luablob_typeid(type);
+				if (field->type == LUABLOB_TYPE_NONE)
+				{
+					luaL_error(L, "unrecognized datatype specifier '%s'", type);
+				}
+				if (field->type == LUABLOB_TYPE_STR || field->type == LUABLOB_TYPE_BLOB)
+				{
+					luaL_error(L, "datatype '%s' requires a length; use a field information table", type);
+				}
+				field->len = 0;
+				field->start = 0;
+				field->count = ((size_t)-1);
+				field->mode = NULL;
+				field->constant = 0;
+				break;
+			case LUA_TTABLE:
+				lua_pushliteral(L, "type");			//STACK: infos... plan consts 'type'
+				lua_gettable(L, i);					//STACK: infos... plan consts type
+				type = (lua_isnil(L, -1) ? NULL : luaL_checkstring(L, -1));
+				lua_pop(L, 1);						//STACK: infos... plan consts
+
+				hasoffset = 0;
+				lua_pushliteral(L, "offset");		//STACK: infos... plan consts 'offset'
+				lua_gettable(L, i);					//STACK: infos... plan consts offset
+				if (!lua_isnil(L, -1))
+				{
+					hasoffset = 1;
+					delta += lua_tointeger(L, -1);
+				}
+				lua_pop(L, 1);						//STACK: infos... plan consts
+
+				lua_pushliteral(L, "pos");			//STACK: infos... plan consts 'pos'
+				lua_gettable(L, i);					//STACK: infos... plan consts pos
+				if (!lua_isnil(L, -1))
+				{
+					if (hasoffset)
+					{
+						luaL_error(L, "a field information table may not contain both a position and an offset");
+					}
+					haspos = 1;
+					pos = luablob_checksize(L, -1);
+					delta = 0;
+				}
+				lua_pop(L, 1);						//STACK: infos... plan consts
+
+				if (type == NULL)
+				{
+					continue;
+				}
+
+				field->type = luablob_typeid(type);
+				if (field->type == LUABLOB_TYPE_NONE)
+				{
+					luaL_error(L, "unrecognized datatype specifier '%s'", type);
+				}
+				field->len = 0;
+				field->start = 0;
+				field->count = ((size_t)-1);
+				field->mode = NULL;
+				field->constant = 0;
+
+				if (field->type == LUABLOB_TYPE_STR || field->type == LUABLOB_TYPE_BLOB)
+				{
+					lua_pushliteral(L, "len");		//STACK: infos... plan consts 'len'
+					lua_gettable(L, i);				//STACK: infos... plan consts len
+					if (!lua_isnil(L, -1))
+					{
+						field->len = luablob_checksize(L, -1);
+					}
+					lua_pop(L, 1);					//STACK: infos... plan consts
+				}
+				if (field->type == LUABLOB_TYPE_BLOB)
+				{
+					lua_pushliteral(L, "mode");		//STACK: infos... plan consts 'mode'
+					lua_gettable(L, i);				//STACK: infos... plan consts mode
+					if (lua_isnil(L, -1))
+					{
+						lua_pop(L, 1);				//STACK: infos... plan consts
+					}
+					else
+					{
+						field->mode = luaL_checkstring(L, -1);
+						lua_rawseti(L, -2, ++constcount);	//STACK: infos... plan consts
+					}
+
+					lua_pushliteral(L, "start");	//STACK: infos... plan consts 'start'
+					lua_gettable(L, i);				//STACK: infos... plan consts start
+					if (!lua_isnil(L, -1))
+					{
+						field->start = luablob_checksize(L, -1);
+					}
+					lua_pop(L, 1);					//STACK: infos... plan consts
+
+					//a 'blob' field with a length writes exactly that many bytes unless told otherwise, so plans round-trip
+					lua_pushliteral(L, "count");	//STACK: infos... plan consts 'count'
+					lua_gettable(L, i);				//STACK: infos... plan consts count
+					if (!lua_isnil(L, -1))
+					{
+						field->count = luablob_checksize(L, -1);
+					}
+					else if (field->len != 0)
+					{
+						field->count = field->len;
+					}
+					lua_pop(L, 1);					//STACK: infos... plan consts
+				}
+				else if (field->type == LUABLOB_TYPE_CHAR)
+				{
+					lua_pushliteral(L, "index");	//STACK: infos... plan consts 'index'
+					lua_gettable(L, i);				//STACK: infos... plan consts index
+					if (!lua_isnil(L, -1))
+					{
+						field->start = luablob_checksize(L, -1);
+					}
+					lua_pop(L, 1);					//STACK: infos... plan consts
+				}
+
+				lua_pushliteral(L, "value");		//STACK: infos... plan consts 'value'
+				lua_gettable(L, i);					//STACK: infos... plan consts value
+				if (lua_isnil(L, -1))
+				{
+					lua_pop(L, 1);					//STACK: infos... plan consts
+				}
+				else
+				{
+					field->constant = ++constcount;
+					lua_rawseti(L, -2, constcount);	//STACK: infos... plan consts
+				}
+				break;
+			default:
+				luaL_error(L, "invalid argument; a field must be an offset delta integer, a datatype specifier string, or a field information table");
+		}
+
+		field->haspos = haspos;
+		field->pos = pos;
+		field->delta = delta;
+		++(plan->fieldcount);
+		++(plan->results);
+
+		haspos = 0;
+		pos = 0;
+		delta = 0;
+	}
+
+	if (haspos || delta != 0)
+	{
+		//keep trailing offsets so that plan:write reports the correct end position
+		field = &(plan->fields[plan->fieldcount]);
+		field->type = LUABLOB_TYPE_NONE;
+		field->haspos = haspos;
+		field->pos = pos;
+		field->delta = delta;
+		field->constant = 0;
+		++(plan->fieldcount);
+	}
+
+	if (constcount == 0)
+	{
+		lua_pop(L, 1);								//STACK: infos... plan
+	}
+	else
+	{
+		plan->constref = luaL_ref(L, LUA_REGISTRYINDEX);	//STACK: infos... plan
+	}
+
+	return 1;										//RETURN: plan
+}
+
+LUA_CFUNCTION_F lua_blob_plan_read(lua_State *L)
+{	//STACK: plan gmb pos? ?
+	luablob_plan *plan;
+	luablob_planfield *field;
+	GenericMemoryBlob *gmb;
+	GenericMemoryBlob destblob;
+	size_t base;
+	size_t offset;
+	int i;
+
+	plan = (luablob_plan *)luaL_checkudata(L, 1, "luablob_plan_mt");
+	gmb = luablob_checkgmb(L, 2);
+	base = luablob_optsize(L, 3, 0);
+
+	luaL_checkstack(L, plan->results, NULL);
+
+	offset = base;
+	for (i = 0; i < plan->fieldcount; ++i)
+	{
+		field = &(plan->fields[i]);
+		if (field->haspos)
+		{
+			offset = (base + field->pos);
+		}
+		offset += field->delta;
+
+		switch (field->type)
+		{
+			case LUABLOB_TYPE_NONE:
+				break;
+			case LUABLOB_TYPE_BLOB:
+				if (!luablob_inbounds(offset, field->len, gmb->usedsize))
+				{
+					luaL_error(L, "unable to read data; bounds out of range");
+				}
+
+				luablob_newgmb(L, &destblob, field->len, ((field->mode == NULL) ? "basic" : field->mode));
+				memcpy(destblob.data, ptradd(gmb->data, offset), field->len);
+				destblob.usedsize = field->len;
+				luablob_pushgmb(L, destblob);	//STACK: plan gmb pos? ? values... value
+				offset += field->len;
+				break;
+			default:
+				lua_blob_read_typeid(L, gmb, &offset, field->type, field->len);	//STACK: plan gmb pos? ? values... value
+				break;
+		}
+	}
+
+	return plan->results;	//RETURN: values...
+}
+
+//plan:read hands cstrs back without their terminator, so plan:write adds one to values that do not end in it; that keeps plans round tripping.
+void luablob_plan_writecstr(lua_State *L, GenericMemoryBlob *gmb, size_t *offset, int valueindex)
+{
+	const char *data;
+	size_t size;
+	size_t term;
+
+	data = luaL_checklstring(L, valueindex, &size);
+	term = ((size == 0 || data[size - 1] != '\0') ? 1 : 0);
+	if (memchr(data, '\0', (size - (1 - term))) != NULL)
+	{
+		luaL_error(L, "specified cstr contains an internal null character");
+	}
+
+	if (gmb_resizeraw(gmb, (*offset + size + term), 0 /* FALSE */) == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
+	memcpy(ptradd(gmb->data, *offset), data, size);
+	if (term)
+	{
+		*((char *)ptradd(gmb->data, (*offset + size))) = '\0';
+	}
+	luablob_countbytes(writebytes, (size + term));
+	*offset += (size + term);
+}
+
+LUA_CFUNCTION_F lua_blob_plan_write(lua_State *L)
+{	//STACK: plan gmb pos values...
+	luablob_plan *plan;
+	luablob_planfield *field;
+	GenericMemoryBlob *gmb;
+	size_t base;
+	size_t offset;
+	int arg;
+	int count;
+	int i;
+
+	plan = (luablob_plan *)luaL_checkudata(L, 1, "luablob_plan_mt");
+	gmb = luablob_checkgmb(L, 2);
+	base = luablob_optsize(L, 3, 0);
+
+	count = lua_gettop(L);
+	arg = 4;
+
+	luaL_checkstack(L, 2, NULL);
+
+	offset = base;
+	for (i = 0; i < plan->fieldcount; ++i)
+	{
+		field = &(plan->fields[i]);
+		if (field->haspos)
+		{
+			offset = (base + field->pos);
+		}
+		offset += field->delta;
+
+		if (field->type == LUABLOB_TYPE_NONE)
+		{
+			continue;
+		}
+
+		if (offset > gmb->usedsize)
+		{
+			luaL_error(L, "destination blob does not contain write start offset");
+		}
+
+		if (field->constant != 0)
+		{
+			lua_rawgeti(L, LUA_REGISTRYINDEX, plan->constref);	//STACK: plan gmb pos values... consts
+			lua_rawgeti(L, -1, field->constant);				//STACK: plan gmb pos values... consts value
+			if (field->type == LUABLOB_TYPE_CSTR)
+			{
+				luablob_plan_writecstr(L, gmb, &offset, lua_gettop(L));
+			}
+			else
+			{
+				lua_blob_write_typeid(L, gmb, &offset, field->type, lua_gettop(L), field->start, field->count);
+			}
+			lua_pop(L, 2);										//STACK: plan gmb pos values...
+		}
+		else
+		{
+			if (arg > count)
+			{
+				luaL_error(L, "missing value for field %d ('%s')", (i + 1), luablob_typenames[field->type]);
+			}
+			if (!lua_isnil(L, arg))
+			{
+				if (field->type == LUABLOB_TYPE_CSTR)
+				{
+					luablob_plan_writecstr(L, gmb, &offset, arg);
+				}
+				else
+				{
+					lua_blob_write_typeid(L, gmb, &offset, field->type, arg, field->start, field->count);
+				}
+			}
+			++arg;
+		}
+	}
+
+	lua_pushinteger(L, offset);	//STACK: plan gmb pos values... offset
+	return 1;									//RETURN: offset
+}
+
+LUA_CFUNCTION_F lua_luablob_plan_mt___gc(lua_State *L)
+{	//STACK: plan ?
+	luablob_plan *plan;
+
+	plan = (luablob_plan *)luaL_checkudata(L, 1, "luablob_plan_mt");
+	if (plan->constref != LUA_NOREF)
+	{
+		luaL_unref(L, LUA_REGISTRYINDEX, plan->constref);
+		plan->constref = LUA_NOREF;
+	}
+
+	return 0;
+}
+
+//A cursor is a read position in a blob that persists between calls; its typed methods are closures over a type id that go straight to lua_blob_read_typeid.
+typedef struct luablob_cursor_s
+{
+	GenericMemoryBlob *gmb;
+	size_t pos;
+	int gmbref;
+} luablob_cursor;
+
+LUA_CFUNCTION_F lua_blob_cursor(lua_State *L)
+{	//STACK: gmb pos? ?
+	GenericMemoryBlob *gmb;
+	luablob_cursor *cur;
+	size_t pos;
+
+	gmb = luablob_checkgmb(L, 1);
+	pos = luablob_optsize(L, 2, 0);
+	if (pos > gmb->usedsize)
+	{
+		luaL_error(L, "argument out of range; cursor position is beyond the end of the blob");
+	}
+
+	luaL_checkstack(L, 3, NULL);
+
+	cur = (luablob_cursor *)lua_newuserdata(L, sizeof(luablob_cursor));	//STACK: gmb pos? ? cur
+	cur->gmb = gmb;
+	cur->pos = pos;
+	cur->gmbref = LUA_NOREF;
+	luaL_setmetatable(L, "luablob_cursor_mt");
+
+	lua_pushliteral(L, "luablob_parentref");	//STACK: gmb pos? ? cur 'luablob_parentref'
+	lua_gettable(L, LUA_REGISTRYINDEX);			//STACK: gmb pos? ? cur luablob_parentref
+	lua_pushvalue(L, 1);						//STACK: gmb pos? ? cur luablob_parentref gmb
+	cur->gmbref = luaL_ref(L, -2);				//STACK: gmb pos? ? cur luablob_parentref
+	lua_pop(L, 1);								//STACK: gmb pos? ? cur
+
+	return 1;									//RETURN: cur
+}
+
+//Views are re-synced against their parent on every use, since the parent may have moved its storage since the last call.
+luablob_cursor *luablob_checkcursor(lua_State *L, int index)
+{
+	luablob_cursor *cur;
+
+	cur = (luablob_cursor *)luaL_checkudata(L, index, "luablob_cursor_mt");
+	if (cur->gmb->data != NULL && cur->gmb->free == &luablob_view_free)
+	{
+		luablob_view_sync(L, cur->gmb);
+	}
+
+	return cur;
+}
+
+LUA_CFUNCTION_F lua_blob_cursor_read(lua_State *L)
+{	//STACK: cur len? mode? ?
+	//UPVALUES: typeid
+	luablob_cursor *cur;
+	GenericMemoryBlob destblob;
+	size_t len;
+	int type;
+
+	cur = luablob_checkcursor(L, 1);
+	type = (int)lua_tointeger(L, lua_upvalueindex(1));
+
+	luaL_checkstack(L, 1, NULL);
+	switch (type)
+	{
+		case LUABLOB_TYPE_STR:
+			lua_blob_read_typeid(L, cur->gmb, &(cur->pos), type, luablob_checksize(L, 2));	//STACK: cur len ? value
+			break;
+		case LUABLOB_TYPE_BLOB:
+			len = luablob_checksize(L, 2);
+			if (!luablob_inbounds(cur->pos, len, cur->gmb->usedsize))
+			{
+				luaL_error(L, "unable to read data; bounds out of range");
+			}
+
+			luablob_newgmb(L, &destblob, ((len == 0) ? 1 : len), luaL_optstring(L, 3, NULL));
+			memcpy(destblob.data, ptradd(cur->gmb->data, cur->pos), len);
+			luablob_countbytes(readbytes, len);
+			destblob.usedsize = len;
+			luablob_pushgmb(L, destblob);		//STACK: cur len mode? ? value
+			cur->pos += len;
+			break;
+		default:
+			lua_blob_read_typeid(L, cur->gmb, &(cur->pos), type, 0);	//STACK: cur ? value
+			break;
+	}
+
+	return 1;	//RETURN: value
+}
+
+LUA_CFUNCTION_F lua_blob_cursor_pos(lua_State *L)
+{	//STACK: cur ?
+	luablob_cursor *cur;
+
+	cur = luablob_checkcursor(L, 1);
+	lua_pushnumber(L, (lua_Number)cur->pos);	//STACK: cur ? pos
+
+	return 1;	//RETURN: pos
+}
+
+LUA_CFUNCTION_F lua_blob_cursor_seek(lua_State *L)
+{	//STACK: cur pos ?
+	luablob_cursor *cur;
+	size_t pos;
+
+	cur = luablob_checkcursor(L, 1);
+	pos = luablob_checksize(L, 2);
+	if (pos > cur->gmb->usedsize)
+	{
+		luaL_error(L, "argument out of range; cursor position is beyond the end of the blob");
+	}
+	cur->pos = pos;
+
+	lua_settop(L, 1);	//STACK: cur
+	return 1;			//RETURN: cur
+}
+
+//Moves the cursor by a signed delta, which must keep it within the blob.
+LUA_CFUNCTION_F lua_blob_cursor_skip(lua_State *L)
+{	//STACK: cur delta ?
+	luablob_cursor *cur;
+	lua_Number delta;
+	size_t n;
+
+	cur = luablob_checkcursor(L, 1);
+	delta = luaL_checknumber(L, 2);
+	if (!(delta > -(lua_Number)((size_t)-1) && delta < (lua_Number)((size_t)-1)))
+	{
+		luaL_error(L, "argument out of range; skip distances must be addressable");
+	}
+	if (delta < 0)
+	{
+		n = (size_t)(-delta);
+		if (n > cur->pos)
+		{
+			luaL_error(L, "argument out of range; cannot skip back past the start of the blob");
+		}
+		cur->pos -= n;
+	}
+	else
+	{
+		n = (size_t)delta;
+		if (!luablob_inbounds(cur->pos, n, cur->gmb->usedsize))
+		{
+			luaL_error(L, "argument out of range; cannot skip past the end of the blob");
+		}
+		cur->pos += n;
+	}
+
+	lua_settop(L, 1);	//STACK: cur
+	return 1;			//RETURN: cur
+}
+
+//The blob may have shrunk under the cursor since it was last used, so this is 0 rather than negative.
+LUA_CFUNCTION_F lua_blob_cursor_remaining(lua_State *L)
+{	//STACK: cur ?
+	luablob_cursor *cur;
+
+	cur = luablob_checkcursor(L, 1);
+	lua_pushnumber(L, (lua_Number)((cur->pos < cur->gmb->usedsize) ? (cur->gmb->usedsize - cur->pos) : 0));	//STACK: cur ? remaining
+
+	return 1;	//RETURN: remaining
+}
+
+LUA_CFUNCTION_F lua_luablob_cursor_mt___gc(lua_State *L)
+{	//STACK: cur ?
+	luablob_cursor *cur;
+
+	cur = (luablob_cursor *)lua_touserdata(L, 1);
+	if (cur->gmbref != LUA_NOREF)
+	{
+		lua_pushliteral(L, "luablob_parentref");	//STACK: cur ? 'luablob_parentref'
+		lua_gettable(L, LUA_REGISTRYINDEX);			//STACK: cur ? luablob_parentref
+		luaL_unref(L, -1, cur->gmbref);
+		lua_pop(L, 1);								//STACK: cur ?
+		cur->gmbref = LUA_NOREF;
+	}
+
+	return 0;
+}
+
+//Bit fields; see blobbits.h for the two bit orders.
+const char *const luablob_bitorders[] = { "lsb", "msb", NULL };
+
+#define luablob_checkbitorder(L, index) luaL_checkoption((L), (index), "lsb", luablob_bitorders)
+
+int luablob_checkbitwidth(lua_State *L, int index)
+{
+	lua_Number width;
+
+	width = luaL_checknumber(L, index);
+	if (!(width >= 1 && width <= BLOBBITS_MAXWIDTH) || width != (int)width)
+	{
+		luaL_error(L, "argument out of range; bit width must be a whole number from 1 to 64");
+	}
+
+	return (int)width;
+}
+
+//Reads count fields of width bits into a new table.
+void luablob_pushunpacked(lua_State *L, GenericMemoryBlob *gmb, blobbits_reader *reader, int width, size_t count)
+{	//STACK:	start:	?
+	//			end:	? values
+	uint64_t value;
+	size_t i;
+
+	if (count > (size_t)INT_MAX || count > (((size_t)-1) / (size_t)width))
+	{
+		luaL_error(L, "argument out of range; too many fields");
+	}
+	if (!blobbits_inbounds(gmb->usedsize, reader->bitpos, (count * (size_t)width)))
+	{
+		luaL_error(L, "unable to read data; bounds out of range");
+	}
+
+	luaL_checkstack(L, 1, NULL);
+	lua_createtable(L, (int)count, 0);			//STACK: ? values
+	for (i = 0; i < count; ++i)
+	{
+		blobbits_reader_read(reader, gmb->data, gmb->usedsize, width, &value);
+		lua_pushnumber(L, (lua_Number)value);	//STACK: ? values value
+		lua_rawseti(L, -2, (int)(i + 1));		//STACK: ? values
+	}
+}
+
+LUA_CFUNCTION_F lua_blob_readbits(lua_State *L)
+{	//STACK: gmb bitpos width order? ?
+	GenericMemoryBlob *gmb;
+	size_t bitpos;
+	int width;
+	int order;
+
+	gmb = luablob_checkgmb(L, 1);
+	bitpos = luablob_checksize(L, 2);
+	width = luablob_checkbitwidth(L, 3);
+	order = luablob_checkbitorder(L, 4);
+
+	if (!blobbits_inbounds(gmb->usedsize, bitpos, (size_t)width))
+	{
+		luaL_error(L, "unable to read data; bounds out of range");
+	}
+
+	lua_pushnumber(L, (lua_Number)blobbits_read(gmb->data, gmb->usedsize, bitpos, width, order));	//STACK: gmb bitpos width order? ? value
+	return 1;	//RETURN: value
+}
+
+//Writes may extend the blob (zero filled) but, unlike write, never truncate it, since the rest of the last byte may hold other fields.
+LUA_CFUNCTION_F lua_blob_writebits(lua_State *L)
+{	//STACK: gmb bitpos width value order? ?
+	GenericMemoryBlob *gmb;
+	size_t bitpos;
+	size_t end;
+	uint64_t value;
+	int width;
+	int order;
+
+	gmb = luablob_checkgmb(L, 1);
+	bitpos = luablob_checksize(L, 2);
+	width = luablob_checkbitwidth(L, 3);
+	value = luablob_checku64(L, 4);
+	order = luablob_checkbitorder(L, 5);
+
+	if ((bitpos >> 3) > gmb->usedsize)
+	{
+		luaL_error(L, "destination blob does not contain write start offset");
+	}
+	end = ((bitpos >> 3) + ((size_t)(bitpos & 7) + (size_t)width + 7) / 8);
+	if (end > gmb->usedsize && gmb_resize(gmb, end, 0 /* FALSE */) == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
+	if (gmb_unshare(gmb) == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
+
+	blobbits_write(gmb->data, gmb->usedsize, bitpos, width, value, order);
+
+	lua_pushnumber(L, (lua_Number)(bitpos + (size_t)width));	//STACK: gmb bitpos width value order? ? endpos
+	return 1;	//RETURN: endpos
+}
+
+LUA_CFUNCTION_F lua_blob_unpackbits(lua_State *L)
+{	//STACK: gmb bitpos width count order? ?
+	GenericMemoryBlob *gmb;
+	blobbits_reader reader;
+	size_t count;
+	int width;
+
+	gmb = luablob_checkgmb(L, 1);
+	blobbits_reader_init(&reader, luablob_checksize(L, 2), 0);
+	width = luablob_checkbitwidth(L, 3);
+	count = luablob_checksize(L, 4);
+	reader.order = luablob_checkbitorder(L, 5);
+
+	luablob_pushunpacked(L, gmb, &reader, width, count);	//STACK: gmb bitpos width count order? ? values
+	return 1;	//RETURN: values
+}
+
+//A bit cursor reads sequentially through a buffered blobbits_reader; up to 64 bits past its position may already be buffered,
+//so a cursor does not see writes that land just ahead of it until it is moved with seek or skip.
+typedef struct luablob_bitcursor_s
+{
+	GenericMemoryBlob *gmb;
+	blobbits_reader reader;
+	int gmbref;
+} luablob_bitcursor;
+
+LUA_CFUNCTION_F lua_blob_bitcursor(lua_State *L)
+{	//STACK: gmb bitpos? order? ?
+	GenericMemoryBlob *gmb;
+	luablob_bitcursor *cur;
+	size_t bitpos;
+	int order;
+
+	gmb = luablob_checkgmb(L, 1);
+	bitpos = luablob_optsize(L, 2, 0);
+	order = luablob_checkbitorder(L, 3);
+	if (!blobbits_inbounds(gmb->usedsize, bitpos, 0))
+	{
+		luaL_error(L, "argument out of range; cursor position is beyond the end of the blob");
+	}
+
+	luaL_checkstack(L, 3, NULL);
+
+	cur = (luablob_bitcursor *)lua_newuserdata(L, sizeof(luablob_bitcursor));	//STACK: gmb bitpos? order? ? cur
+	cur->gmb = gmb;
+	blobbits_reader_init(&(cur->reader), bitpos, order);
+	cur->gmbref = LUA_NOREF;
+	luaL_setmetatable(L, "luablob_bitcursor_mt");
+
+	lua_pushliteral(L, "luablob_parentref");	//STACK: gmb bitpos? order? ? cur 'luablob_parentref'
+	lua_gettable(L, LUA_REGISTRYINDEX);			//STACK: gmb bitpos? order? ? cur luablob_parentref
+	lua_pushvalue(L, 1);						//STACK: gmb bitpos? order? ? cur luablob_parentref gmb
+	cur->gmbref = luaL_ref(L, -2);				//STACK: gmb bitpos? order? ? cur luablob_parentref
+	lua_pop(L, 1);								//STACK: gmb bitpos? order? ? cur
+
+	return 1;									//RETURN: cur
+}
+
+luablob_bitcursor *luablob_checkbitcursor(lua_State *L, int index)
+{
+	luablob_bitcursor *cur;
+
+	cur = (luablob_bitcursor *)luaL_checkudata(L, index, "luablob_bitcursor_mt");
+	if (cur->gmb->data != NULL && cur->gmb->free == &luablob_view_free)
+	{
+		luablob_view_sync(L, cur->gmb);
+	}
+
+	return cur;
+}
+
+LUA_CFUNCTION_F lua_blob_bitcursor_read(lua_State *L)
+{	//STACK: cur width ?
+	luablob_bitcursor *cur;
+	uint64_t value;
+
+	cur = luablob_checkbitcursor(L, 1);
+	if (!blobbits_reader_read(&(cur->reader), cur->gmb->data, cur->gmb->usedsize, luablob_checkbitwidth(L, 2), &value))
+	{
+		luaL_error(L, "unable to read data; bounds out of range");
+	}
+
+	lua_pushnumber(L, (lua_Number)value);	//STACK: cur width ? value
+	return 1;	//RETURN: value
+}
+
+LUA_CFUNCTION_F lua_blob_bitcursor_unpack(lua_State *L)
+{	//STACK: cur width count ?
+	luablob_bitcursor *cur;
+	int width;
+
+	cur = luablob_checkbitcursor(L, 1);
+	width = luablob_checkbitwidth(L, 2);
+	luablob_pushunpacked(L, cur->gmb, &(cur->reader), width, luablob_checksize(L, 3));	//STACK: cur width count ? values
+
+	return 1;	//RETURN: values
+}
+
+LUA_CFUNCTION_F lua_blob_bitcursor_pos(lua_State *L)
+{	//STACK: cur ?
+	lua_pushnumber(L, (lua_Number)(luablob_checkbitcursor(L, 1)->reader.bitpos));	//STACK: cur ? bitpos
+
+	return 1;	//RETURN: bitpos
+}
+
+LUA_CFUNCTION_F lua_blob_bitcursor_seek(lua_State *L)
+{	//STACK: cur bitpos ?
+	luablob_bitcursor *cur;
+	size_t bitpos;
+
+	cur = luablob_checkbitcursor(L, 1);
+	bitpos = luablob_checksize(L, 2);
+	if (!blobbits_inbounds(cur->gmb->usedsize, bitpos, 0))
+	{
+		luaL_error(L, "argument out of range; cursor position is beyond the end of the blob");
+	}
+	blobbits_reader_init(&(cur->reader), bitpos, cur->reader.order);
+
+	lua_settop(L, 1);	//STACK: cur
+	return 1;			//RETURN: cur
+}
+
+LUA_CFUNCTION_F lua_blob_bitcursor_skip(lua_State *L)
+{	//STACK: cur delta ?
+	luablob_bitcursor *cur;
+	lua_Number delta;
+	size_t bitpos;
+	size_t n;
+
+	cur = luablob_checkbitcursor(L, 1);
+	delta = luaL_checknumber(L, 2);
+	bitpos = cur->reader.bitpos;
+	if (delta < 0)
+	{
+		n = (size_t)(-delta);
+		if (n > bitpos)
+		{
+			luaL_error(L, "argument out of range; cannot skip back past the start of the blob");
+		}
+		bitpos -= n;
+	}
+	else
+	{
+		n = (size_t)delta;
+		if (!blobbits_inbounds(cur->gmb->usedsize, bitpos, n))
+		{
+			luaL_error(L, "argument out of range; cannot skip past the end of the blob");
+		}
+		bitpos += n;
+	}
+	blobbits_reader_init(&(cur->reader), bitpos, cur->reader.order);
+
+	lua_settop(L, 1);	//STACK: cur
+	return 1;			//RETURN: cur
+}
+
+//Moves forward to the next byte boundary, where byte oriented fields usually resume.
+LUA_CFUNCTION_F lua_blob_bitcursor_align(lua_State *L)
+{	//STACK: cur ?
+	luablob_bitcursor *cur;
+	uint64_t discard;
+	int pad;
+
+	cur = luablob_checkbitcursor(L, 1);
+	pad = (int)((8 - (cur->reader.bitpos & 7)) & 7);
+	if (pad != 0 && !blobbits_reader_read(&(cur->reader), cur->gmb->data, cur->gmb->usedsize, pad, &discard))
+	{
+		luaL_error(L, "argument out of range; cannot skip past the end of the blob");
+	}
+
+	lua_settop(L, 1);	//STACK: cur
+	return 1;			//RETURN: cur
+}
+
+LUA_CFUNCTION_F lua_blob_bitcursor_remaining(lua_State *L)
+{	//STACK: cur ?
+	luablob_bitcursor *cur;
+	size_t bits;
+
+	cur = luablob_checkbitcursor(L, 1);
+	bits = ((cur->gmb->usedsize > (((size_t)-1) >> 3)) ? ((size_t)-1) : (cur->gmb->usedsize << 3));
+	lua_pushnumber(L, (lua_Number)((cur->reader.bitpos < bits) ? (bits - cur->reader.bitpos) : 0));	//STACK: cur ? remaining
+
+	return 1;	//RETURN: remaining
+}
+
+LUA_CFUNCTION_F lua_luablob_bitcursor_mt___gc(lua_State *L)
+{	//STACK: cur ?
+	luablob_bitcursor *cur;
+
+	cur = (luablob_bitcursor *)lua_touserdata(L, 1);
+	if (cur->gmbref != LUA_NOREF)
+	{
+		lua_pushliteral(L, "luablob_parentref");	//STACK: cur ? 'luablob_parentref'
+		lua_gettable(L, LUA_REGISTRYINDEX);			//STACK: cur ? luablob_parentref
+		luaL_unref(L, -1, cur->gmbref);
+		lua_pop(L, 1);								//STACK: cur ?
+		cur->gmbref = LUA_NOREF;
+	}
+
+	return 0;
+}
+
+//Chains are ordered lists of blob or string ranges that are never copied until flattened; the referenced objects are kept alive in a table held through luablob_parentref.
+typedef struct luablob_chainseg_s
+{
+	size_t start;
+	size_t len;
+} luablob_chainseg;
+
+struct luablob_chain_s
+{
+	lua_State *L;
+	luablob_chainseg *segs;
+	size_t count;
+	size_t capacity;
+	size_t total;
+	int objref;		//table of the segment objects, index i + 1 holds segment i
+};
+
+LUABLOB_API(luablob_chain *) luablob_tochain(lua_State *L, int index)
+{
+	return (luablob_chain *)luaL_testudata(L, index, "luablob_chain_mt");
+}
+
+LUABLOB_API(luablob_chain *) luablob_checkchain(lua_State *L, int index)
+{
+	return (luablob_chain *)luaL_checkudata(L, index, "luablob_chain_mt");
+}
+
+LUABLOB_API(size_t) luablob_chain_count(luablob_chain *chain)
+{
+	return chain->count;
+}
+
+LUABLOB_API(size_t) luablob_chain_size(luablob_chain *chain)
+{
+	return chain->total;
+}
+
+LUABLOB_API(const void *) luablob_chain_segment(lua_State *L, luablob_chain *chain, size_t i, size_t *len)
+{	//STACK: ?
+	GenericMemoryBlob *gmb;
+	const char *data;
+	size_t size;
+
+	luaL_checkstack(L, 3, NULL);
+
+	lua_pushliteral(L, "luablob_parentref");	//STACK: ? 'luablob_parentref'
+	lua_gettable(L, LUA_REGISTRYINDEX);			//STACK: ? luablob_parentref
+	lua_rawgeti(L, -1, chain->objref);			//STACK: ? luablob_parentref objs
+	lua_rawgeti(L, -1, (int)(i + 1));			//STACK: ? luablob_parentref objs obj
+	if (lua_type(L, -1) == LUA_TSTRING)
+	{
+		data = lua_tolstring(L, -1, &size);		//strings are immutable and stay referenced by objs, so the pointer outlives the pop
+	}
+	else
+	{
+		gmb = luablob_togmb(L, -1);
+		if (gmb->data == NULL)
+		{
+			luaL_error(L, "unable to use chain; a linked blob has been freed");
+		}
+		data = (const char *)gmb->data;
+		size = gmb->usedsize;
+	}
+	lua_pop(L, 3);								//STACK: ?
+
+	if (chain->segs[i].start > size || chain->segs[i].len > (size - chain->segs[i].start))
+	{
+		luaL_error(L, "unable to use chain; a linked blob no longer contains its linked range");
+	}
+
+	*len = chain->segs[i].len;
+	return (data + chain->segs[i].start);
+}
+
+LUA_CFUNCTION_F lua_blob_chain_append(lua_State *L)
+{	//STACK: chain value start? len? ?
+	luablob_chain *chain;
+	GenericMemoryBlob *gmb;
+	luablob_chainseg *segs;
+	size_t size;
+	size_t start;
+	size_t len;
+	size_t ncap;
+	void *allocud = NULL;
+
+	chain = luablob_checkchain(L, 1);
+	if (lua_type(L, 2) == LUA_TSTRING)
+	{
+		lua_tolstring(L, 2, &size);
+	}
+	else
+	{
+		gmb = luablob_checkgmb(L, 2);
+		size = gmb->usedsize;
+	}
+	start = luablob_optsize(L, 3, 0);
+	if (start > size)
+	{
+		luaL_error(L, "argument out of range; chain segment start is beyond the end of the value");
+	}
+	len = (lua_isnoneornil(L, 4) ? (size - start) : luablob_checksize(L, 4));
+	if (len > (size - start))
+	{
+		luaL_error(L, "argument out of range; chain segment length is beyond the end of the value");
+	}
+
+	if (chain->count == chain->capacity)
+	{
+		ncap = ((chain->capacity == 0) ? 8 : (chain->capacity * 2));
+		segs = (luablob_chainseg *)lua_getallocf(L, &allocud)(allocud, chain->segs, (chain->capacity * sizeof(luablob_chainseg)), (ncap * sizeof(luablob_chainseg)));
+		if (segs == NULL)
+		{
+			luaL_error(L, "failed to allocate blob chain");
+		}
+		chain->segs = segs;
+		chain->capacity = ncap;
+	}
+
+	luaL_checkstack(L, 3, NULL);
+	lua_pushliteral(L, "luablob_parentref");	//STACK: chain value start? len? ? 'luablob_parentref'
+	lua_gettable(L, LUA_REGISTRYINDEX);			//STACK: chain value start? len? ? luablob_parentref
+	lua_rawgeti(L, -1, chain->objref);			//STACK: chain value start? len? ? luablob_parentref objs
+	lua_pushvalue(L, 2);						//STACK: chain value start? len? ? luablob_parentref objs value
+	lua_rawseti(L, -2, (int)(chain->count + 1));	//STACK: chain value start? len? ? luablob_parentref objs
+	lua_pop(L, 2);								//STACK: chain value start? len? ?
+
+	chain->segs[chain->count].start = start;
+	chain->segs[chain->count].len = len;
+	++(chain->count);
+	chain->total += len;
+
+	lua_pushvalue(L, 1);						//STACK: chain value start? len? ? chain
+	return 1;									//RETURN: chain
+}
+
+LUA_CFUNCTION_F lua_blob_newchain(lua_State *L)
+{	//STACK: values... ?
+	luablob_chain *chain;
+	int count;
+	int i;
+
+	count = lua_gettop(L);
+	luaL_checkstack(L, 7, NULL);
+
+	chain = (luablob_chain *)lua_newuserdata(L, sizeof(luablob_chain));	//STACK: values... chain
+	chain->segs = NULL;
+	chain->count = 0;
+	chain->capacity = 0;
+	chain->total = 0;
+	chain->objref = LUA_NOREF;
+	luaL_setmetatable(L, "luablob_chain_mt");
+
+	lua_rawgeti(L, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);	//STACK: values... chain mainthread
+	chain->L = lua_tothread(L, -1);
+	lua_pop(L, 1);								//STACK: values... chain
+
+	lua_pushliteral(L, "luablob_parentref");	//STACK: values... chain 'luablob_parentref'
+	lua_gettable(L, LUA_REGISTRYINDEX);			//STACK: values... chain luablob_parentref
+	lua_newtable(L);							//STACK: values... chain luablob_parentref objs
+	chain->objref = luaL_ref(L, -2);			//STACK: values... chain luablob_parentref
+	lua_pop(L, 1);								//STACK: values... chain
+
+	for (i = 1; i <= count; ++i)
+	{
+		lua_pushcfunction(L, &lua_blob_chain_append);	//STACK: values... chain append
+		lua_pushvalue(L, (count + 1));			//STACK: values... chain append chain
+		lua_pushvalue(L, i);					//STACK: values... chain append chain value
+		lua_call(L, 2, 0);						//STACK: values... chain
+	}
+
+	return 1;									//RETURN: chain
+}
+
+LUA_CFUNCTION_F lua_luablob_chain_mt___len(lua_State *L)
+{	//STACK: chain ?
+	lua_pushinteger(L, (lua_Integer)luablob_checkchain(L, 1)->total);	//STACK: chain ? total
+	return 1;					//RETURN: total
+}
+
+LUA_CFUNCTION_F lua_luablob_chain_mt___gc(lua_State *L)
+{	//STACK: chain ?
+	luablob_chain *chain;
+	void *allocud = NULL;
+
+	chain = luablob_checkchain(L, 1);
+	if (chain->objref != LUA_NOREF)
+	{
+		lua_pushliteral(L, "luablob_parentref");	//STACK: chain ? 'luablob_parentref'
+		lua_gettable(L, LUA_REGISTRYINDEX);			//STACK: chain ? luablob_parentref
+		luaL_unref(L, -1, chain->objref);
+		lua_pop(L, 1);								//STACK: chain ?
+		chain->objref = LUA_NOREF;
+	}
+	if (chain->segs != NULL)
+	{
+		lua_getallocf(chain->L, &allocud)(allocud, chain->segs, (chain->capacity * sizeof(luablob_chainseg)), 0);
+		chain->segs = NULL;
+		chain->capacity = 0;
+	}
+
+	return 0;
+}
+
+LUA_CFUNCTION_F lua_blob_chain_clear(lua_State *L)
+{	//STACK: chain ?
+	luablob_chain *chain;
+
+	chain = luablob_checkchain(L, 1);
+
+	lua_pushliteral(L, "luablob_parentref");	//STACK: chain ? 'luablob_parentref'
+	lua_gettable(L, LUA_REGISTRYINDEX);			//STACK: chain ? luablob_parentref
+	lua_newtable(L);							//STACK: chain ? luablob_parentref objs
+	lua_rawseti(L, -2, chain->objref);			//STACK: chain ? luablob_parentref
+	lua_pop(L, 1);								//STACK: chain ?
+
+	chain->count = 0;
+	chain->total = 0;
+
+	return 0;
+}
+
+LUA_CFUNCTION_F lua_blob_chain_flatten(lua_State *L)
+{	//STACK: chain allocmode? ?
+	luablob_chain *chain;
+	GenericMemoryBlob gmb;
+	GenericMemoryBlob *result;
+	const void *data;
+	size_t offset;
+	size_t len;
+	size_t i;
+
+	chain = luablob_checkchain(L, 1);
+
+	luablob_newgmb(L, &gmb, ((chain->total == 0) ? 1 : chain->total), luaL_optstring(L, 2, NULL));
+	luablob_pushgmb(L, gmb);					//STACK: chain allocmode? ? blob
+	result = (GenericMemoryBlob *)lua_touserdata(L, -1);
+	if (gmb_resizeraw(result, chain->total, 0 /* FALSE */) == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
+
+	offset = 0;
+	for (i = 0; i < chain->count; ++i)
+	{
+		data = luablob_chain_segment(L, chain, i, &len);
+		memcpy(ptradd(result->data, offset), data, len);
+		offset += len;
+	}
+
+	return 1;									//RETURN: blob
+}
+
+//Rings are fixed-storage FIFO byte queues; produce and consume only move offsets, and the storage wraps around.
+struct luablob_ring_s
+{
+	GenericMemoryBlob gmb;		//usedsize is always the ring's capacity
+	size_t head;				//storage offset of the first unread byte
+	size_t fill;				//number of unread bytes
+};
+
+LUABLOB_API(luablob_ring *) luablob_checkring(lua_State *L, int index)
+{
+	return (luablob_ring *)luaL_checkudata(L, index, "luablob_ring_mt");
+}
+
+LUABLOB_API(size_t) luablob_ring_readspan(luablob_ring *ring, void **data)
+{
+	size_t cap;
+
+	cap = ring->gmb.usedsize;
+	*data = ptradd(ring->gmb.data, ring->head);
+	return (((cap - ring->head) < ring->fill) ? (cap - ring->head) : ring->fill);
+}
+
+LUABLOB_API(size_t) luablob_ring_writespan(luablob_ring *ring, size_t minsize, void **data)
+{
+	size_t cap;
+	size_t ncap;
+	size_t tail;
+	size_t wrapped;
+
+	cap = ring->gmb.usedsize;
+	if ((cap - ring->fill) < minsize)
+	{
+		ncap = (cap * 2);
+		if (ncap < (ring->fill + minsize))
+		{
+			ncap = (ring->fill + minsize);
+		}
+		if (gmb_resizeraw(&(ring->gmb), ncap, 0 /* FALSE */) == 0)
+		{
+			*data = NULL;
+			return 0;
+		}
+
+		//the wrapped part of the data is always smaller than the old capacity, and the storage at least doubled, so it fits right after the old end
+		if ((ring->head + ring->fill) > cap)
+		{
+			wrapped = ((ring->head + ring->fill) - cap);
+			memcpy(ptradd(ring->gmb.data, cap), ring->gmb.data, wrapped);
+		}
+		cap = ncap;
+	}
+
+	tail = (ring->head + ring->fill);
+	if (tail >= cap)
+	{
+		tail -= cap;
+		*data = ptradd(ring->gmb.data, tail);
+		return (ring->head - tail);
+	}
+
+	*data = ptradd(ring->gmb.data, tail);
+	return (cap - tail);
+}
+
+LUABLOB_API(void) luablob_ring_produce(luablob_ring *ring, size_t count)
+{
+	ring->fill += count;
+}
+
+LUABLOB_API(void) luablob_ring_consume(luablob_ring *ring, size_t count)
+{
+	if (count >= ring->fill)
+	{
+		//an empty ring starts over at the front so the next write gets the longest contiguous span
+		ring->head = 0;
+		ring->fill = 0;
+		return;
+	}
+
+	ring->head += count;
+	if (ring->head >= ring->gmb.usedsize)
+	{
+		ring->head -= ring->gmb.usedsize;
+	}
+	ring->fill -= count;
+}
+
+//Copies count unread bytes starting pos bytes past the read position into dest.
+void luablob_ring_copyout(luablob_ring *ring, void *dest, size_t pos, size_t count)
+{
+	size_t cap;
+	size_t start;
+	size_t first;
+
+	cap = ring->gmb.usedsize;
+	start = (ring->head + pos);
+	if (start >= cap)
+	{
+		start -= cap;
+	}
+
+	first = (((cap - start) < count) ? (cap - start) : count);
+	memcpy(dest, ptradd(ring->gmb.data, start), first);
+	if (first < count)
+	{
+		memcpy(ptradd(dest, first), ring->gmb.data, (count - first));
+	}
+}
+
+LUA_CFUNCTION_F lua_blob_newring(lua_State *L)
+{	//STACK: capacity allocmode? ?
+	luablob_ring *ring;
+	size_t capacity;
+	const char *allocmode;
+
+	capacity = luablob_checksize(L, 1);
+	if (capacity == 0)
+	{
+		luaL_error(L, "argument out of range; ring capacity must be greater than 0");
+	}
+	allocmode = luaL_optstring(L, 2, NULL);
+
+	luaL_checkstack(L, 2, NULL);
+	ring = (luablob_ring *)lua_newuserdata(L, sizeof(luablob_ring));		//STACK: capacity allocmode? ? ring
+	ring->gmb.data = NULL;
+	ring->gmb.free = NULL;
+	ring->head = 0;
+	ring->fill = 0;
+	luaL_setmetatable(L, "luablob_ring_mt");
+
+	luablob_newgmb(L, &(ring->gmb), capacity, allocmode);
+	if (gmb_resizeraw(&(ring->gmb), capacity, 0 /* FALSE */) == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
+
+	return 1;	//RETURN: ring
+}
+
+LUA_CFUNCTION_F lua_luablob_ring_mt___len(lua_State *L)
+{	//STACK: ring ?
+	lua_pushinteger(L, luablob_checkring(L, 1)->fill);	//STACK: ring ? fill
+	return 1;											//RETURN: fill
+}
+
+LUA_CFUNCTION_F lua_luablob_ring_mt___tostring(lua_State *L)
+{	//STACK: ring ?
+	luablob_ring *ring;
+	luaL_Buffer b;
+
+	ring = luablob_checkring(L, 1);
+
+	luaL_buffinit(L, &b);
+	luablob_ring_copyout(ring, luaL_prepbuffsize(&b, ring->fill), 0, ring->fill);
+	luaL_addsize(&b, ring->fill);
+	luaL_pushresult(&b);	//STACK: ring ? str
+
+	return 1;				//RETURN: str
+}
+
+LUA_CFUNCTION_F lua_luablob_ring_mt___gc(lua_State *L)
+{	//STACK: ring ?
+	luablob_ring *ring;
+
+	ring = luablob_checkring(L, 1);
+	if (ring->gmb.free != NULL)
+	{
+		gmb_free(&(ring->gmb));
+		ring->gmb.free = NULL;
+	}
+
+	return 0;
+}
+
+LUA_CFUNCTION_F lua_blob_ring_capacity(lua_State *L)
+{	//STACK: ring ?
+	luablob_ring *ring;
+
+	ring = luablob_checkring(L, 1);
+	lua_pushinteger(L, ring->gmb.usedsize);		//STACK: ring ? capacity
+	lua_pushinteger(L, (ring->gmb.usedsize - ring->fill));	//STACK: ring ? capacity free
+
+	return 2;									//RETURN: capacity free
+}
+
+LUA_CFUNCTION_F lua_blob_ring_write(lua_State *L)
+{	//STACK: ring value start? count? ?
+	luablob_ring *ring;
+	GenericMemoryBlob *src;
+	const char *data;
+	size_t size;
+	size_t start;
+	size_t count;
+	size_t span;
+	void *dest;
+
+	ring = luablob_checkring(L, 1);
+	if (lua_type(L, 2) == LUA_TSTRING)
+	{
+		data = lua_tolstring(L, 2, &size);
+	}
+	else
+	{
+		src = luablob_checkgmb(L, 2);
+		data = (const char *)src->data;
+		size = src->usedsize;
+	}
+
+	start = luablob_optsize(L, 3, 0);
+	if (start > size)
+	{
+		luaL_error(L, "unable to write data; source bounds out of range");
+	}
+	count = (lua_isnoneornil(L, 4) ? (size - start) : luablob_checksize(L, 4));
+	if (count > (size - start))
+	{
+		luaL_error(L, "unable to write data; source bounds out of range");
+	}
+
+	data += start;
+	size = count;
+	while (count > 0)
+	{
+		span = luablob_ring_writespan(ring, count, &dest);
+		if (span == 0)
+		{
+			luaL_error(L, "failed to allocate blob memory");
+		}
+		if (span > count)
+		{
+			span = count;
+		}
+
+		memcpy(dest, data, span);
+		luablob_ring_produce(ring, span);
+		data += span;
+		count -= span;
+	}
+
+	lua_pushinteger(L, size);	//STACK: ring value start? count? ? size
+	return 1;					//RETURN: size
+}
+
+LUA_CFUNCTION_F lua_blob_ring_peek(lua_State *L)
+{	//STACK: ring count? pos? ?
+	luablob_ring *ring;
+	size_t count;
+	size_t pos;
+	luaL_Buffer b;
+
+	ring = luablob_checkring(L, 1);
+	pos = luablob_optsize(L, 3, 0);
+	if (pos > ring->fill)
+	{
+		luaL_error(L, "unable to read data; bounds out of range");
+	}
+	count = (lua_isnoneornil(L, 2) ? (ring->fill - pos) : luablob_checksize(L, 2));
+	if (count > (ring->fill - pos))
+	{
+		count = (ring->fill - pos);
+	}
+
+	luaL_buffinit(L, &b);
+	luablob_ring_copyout(ring, luaL_prepbuffsize(&b, count), pos, count);
+	luaL_addsize(&b, count);
+	luaL_pushresult(&b);	//STACK: ring count? pos? ? str
+
+	return 1;				//RETURN: str
+}
+
+LUA_CFUNCTION_F lua_blob_ring_read(lua_State *L)
+{	//STACK: ring count? allocmode? ?
+	luablob_ring *ring;
+	GenericMemoryBlob gmb;
+	size_t count;
+
+	ring = luablob_checkring(L, 1);
+	count = (lua_isnoneornil(L, 2) ? ring->fill : luablob_checksize(L, 2));
+	if (count > ring->fill)
+	{
+		count = ring->fill;
+	}
+
+	luablob_newgmb(L, &gmb, ((count == 0) ? 1 : count), luaL_optstring(L, 3, "tight"));
+	luablob_pushgmb(L, gmb);	//STACK: ring count? allocmode? ? blob
+	if (gmb_resizeraw(luablob_togmb(L, -1), count, 0 /* FALSE */) == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
+	luablob_ring_copyout(ring, luablob_togmb(L, -1)->data, 0, count);
+	luablob_ring_consume(ring, count);
+
+	return 1;					//RETURN: blob
+}
+
+LUA_CFUNCTION_F lua_blob_ring_consume(lua_State *L)
+{	//STACK: ring count? ?
+	luablob_ring *ring;
+	size_t count;
+
+	ring = luablob_checkring(L, 1);
+	count = (lua_isnoneornil(L, 2) ? ring->fill : luablob_checksize(L, 2));
+	if (count > ring->fill)
+	{
+		luaL_error(L, "argument out of range; ring contains only %f bytes", (lua_Number)ring->fill);
+	}
+	luablob_ring_consume(ring, count);
+
+	return 0;
+}
+
+LUA_CFUNCTION_F lua_blob_ring_find(lua_State *L)
+{	//STACK: ring delim init? ?
+	luablob_ring *ring;
+	const char *delim;
+	size_t dlen;
+	size_t init;
+	size_t cap;
+	size_t pos;
+	size_t start;
+	size_t span;
+	size_t i;
+	const char *p;
+	const char *hit;
+
+	ring = luablob_checkring(L, 1);
+	delim = luaL_checklstring(L, 2, &dlen);
+	init = luablob_optsize(L, 3, 0);
+	if (dlen == 0)
+	{
+		luaL_error(L, "invalid argument; delimiter must not be empty");
+	}
+
+	cap = ring->gmb.usedsize;
+	pos = init;
+	while ((pos + dlen) <= ring->fill)
+	{
+		//scan the contiguous run from pos for the first delimiter byte, then check the rest byte by byte as it may wrap
+		start = (ring->head + pos);
+		if (start >= cap)
+		{
+			start -= cap;
+		}
+		span = (cap - start);
+		if (span > (ring->fill - pos))
+		{
+			span = (ring->fill - pos);
+		}
+
+		p = (const char *)ptradd(ring->gmb.data, start);
+		hit = (const char *)memchr(p, delim[0], span);
+		if (hit == NULL)
+		{
+			pos += span;
+			continue;
+		}
+
+		pos += (size_t)(hit - p);
+		if ((pos + dlen) > ring->fill)
+		{
+			break;
+		}
+		for (i = 1; i < dlen; ++i)
+		{
+			start = (ring->head + pos + i);
+			if (start >= cap)
+			{
+				start -= cap;
+			}
+			if (((const char *)ring->gmb.data)[start] != delim[i])
+			{
+				break;
+			}
+		}
+		if (i == dlen)
+		{
+			lua_pushinteger(L, pos);	//STACK: ring delim init? ? pos
+			return 1;					//RETURN: pos
+		}
+		++pos;
+	}
+
+	lua_pushnil(L);		//STACK: ring delim init? ? nil
+	return 1;			//RETURN: nil
+}
+
+LUA_CFUNCTION_F lua_blob_ring_clear(lua_State *L)
+{	//STACK: ring ?
+	luablob_ring_consume(luablob_checkring(L, 1), ((size_t)-1));
+	return 0;
+}
+
+//The socket side of writefrom/readto is looked up in the source's metatable, so the blob library never needs to know about sockets.
+int luablob_ring_hook(lua_State *L, const char *hook)
+{	//STACK: ring obj args... ?
+	int top;
+
+	luablob_checkring(L, 1);
+	top = lua_gettop(L);
+	if (!luaL_getmetafield(L, 2, hook))		//STACK: ring obj args... ? hookfn
+	{
+		luaL_error(L, "invalid argument; object does not support ring buffer transfers");
+	}
+	lua_insert(L, 1);						//STACK: hookfn ring obj args... ?
+	lua_pushvalue(L, 2);					//STACK: hookfn ring obj args... ? ring
+	lua_remove(L, 2);						//STACK: hookfn obj args... ? ring
+	lua_insert(L, 3);						//STACK: hookfn obj ring args... ?
+	lua_call(L, top, LUA_MULTRET);			//STACK: [results]
+
+	return lua_gettop(L);					//RETURN: [results]
+}
+
+LUA_CFUNCTION_F lua_blob_ring_writefrom(lua_State *L)
+{	//STACK: ring src args... ?
+	return luablob_ring_hook(L, "__ringrecv");
+}
+
+LUA_CFUNCTION_F lua_blob_ring_readto(lua_State *L)
+{	//STACK: ring dest args... ?
+	return luablob_ring_hook(L, "__ringsend");
+}
+
+//Compression. blob:compress() produces one LZ4-style block behind a varint of the original size; the stream objects produce
+//frames of independent blocks so data can be compressed and decompressed as it arrives.
+#define LUABLOB_COMPRESS_DEFAULTLEVEL 1
+#define LUABLOB_COMPRESS_MAXRATIO 255		//one compressed byte expands to at most this many bytes, which bounds the size a header may claim
+#define LUABLOB_FRAME_MAGIC "LZB\x01"
+#define LUABLOB_FRAME_MAGICLEN 4
+#define LUABLOB_FRAME_HEADERLEN 8			//u32le raw size, u32le payload size with the high bit set for stored (uncompressed) blocks
+#define LUABLOB_FRAME_STORED 0x80000000U
+#define LUABLOB_FRAME_BLOCK 0x10000			//default raw block size (64kb)
+#define LUABLOB_FRAME_MAXBLOCK 0x400000		//blocks above 4mb are rejected so a corrupt header cannot force a huge allocation
+
+int luablob_checklevel(lua_State *L, int index)
+{
+	lua_Number level;
+
+	level = luaL_optnumber(L, index, LUABLOB_COMPRESS_DEFAULTLEVEL);
+	if (!(level >= BLOBCOMPRESS_MINLEVEL && level <= BLOBCOMPRESS_MAXLEVEL))
+	{
+		luaL_error(L, "argument out of range; compression level must be between %d and %d", BLOBCOMPRESS_MINLEVEL, BLOBCOMPRESS_MAXLEVEL);
+	}
+
+	return (int)level;
+}
+
+uint32_t luablob_frame_get32(const unsigned char *p)
+{
+	return (((uint32_t)p[0]) | (((uint32_t)p[1]) << 8) | (((uint32_t)p[2]) << 16) | (((uint32_t)p[3]) << 24));
+}
 
-							*((uint8_t *)ptradd(gmb->data, offset)) = (uint8_t)size;
-							offset += sizeof(uint8_t);
+void luablob_frame_put32(unsigned char *p, uint32_t v)
+{
+	p[0] = (unsigned char)(v & 0xFF);
+	p[1] = (unsigned char)((v >> 8) & 0xFF);
+	p[2] = (unsigned char)((v >> 16) & 0xFF);
+	p[3] = (unsigned char)((v >> 24) & 0xFF);
+}
 
-							memcpy(ptradd(gmb->data, offset), data, size);
-							offset += size;
-						}
-						else if (strcmp(type, "u16str") == 0)
-						{
-							data = luaL_checklstring(L, -1, &size);
-							if (size > UINT16_MAX)
-							{
-								luaL_error(L, "string too large to be represented by u16str");
-							}
-							if (gmb_resize(gmb, (offset + sizeof(uint16_t) + size), 0 /* FALSE */) == 0)
-							{
-								luaL_error(L, "failed to allocate blob memory");
-							}
+//Grows gmb by count bytes and returns a pointer to them.
+void *luablob_append(lua_State *L, GenericMemoryBlob *gmb, size_t count)
+{
+	size_t offset;
 
-							*((uint16_t *)ptradd(gmb->data, offset)) = (uint16_t)size;
-							offset += sizeof(uint16_t);
+	offset = gmb->usedsize;
+	if (gmb_resizeraw(gmb, (offset + count), 0 /* FALSE */) == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
 
-							memcpy(ptradd(gmb->data, offset), data, size);
-							offset += size;
-						}
-						else if (strcmp(type, "u32str") == 0)
-						{
-							data = luaL_checklstring(L, -1, &size);
-							if (size > UINT32_MAX)
-							{
-								luaL_error(L, "string too large to be represented by u32str");
-							}
-							if (gmb_resize(gmb, (offset + sizeof(uint32_t) + size), 0 /* FALSE */) == 0)
-							{
-								luaL_error(L, "failed to allocate blob memory");
-							}
+	return ptradd(gmb->data, offset);
+}
 
-							*((uint32_t *)ptradd(gmb->data, offset)) = (uint32_t)size;
-							offset += sizeof(uint32_t);
+//Returns the string or blob at index, narrowed by the optional start and count arguments that follow it.
+const char *luablob_checksource(lua_State *L, int index, size_t *size)
+{
+	GenericMemoryBlob *src;
+	const char *data;
+	size_t start;
+	size_t count;
 
-							memcpy(ptradd(gmb->data, offset), data, size);
-							offset += size;
-						}
-						else if (strcmp(type, "char") == 0)
-						{
-							data = luaL_checklstring(L, -1, &size);
-							if (size != 0)
-							{
-								lua_checkstack(L, 1);
-								lua_pushliteral(L, "index");	//STACK: gmb infos... value 'index'
-								lua_gettable(L, i);				//STACK: gmb infos... value index
-								srcoffset = (lua_isnil(L, -1) ? 0 : luaL_checkunsigned(L, -1));
-								lua_pop(L, 1);					//STACK: gmb infos... value
-								if (srcoffset >= size)
-								{
-									luaL_error(L, "start index out of range");
-								}
-
-								if (gmb_resize(gmb, (offset + sizeof(char)), 0 /* FALSE */) == 0)
-								{
-									luaL_error(L, "failed to allocate blob memory");
-								}
-
-								*((char *)ptradd(gmb->data, offset)) = data[srcoffset];
-								offset += sizeof(char);
-							}
-						}
-						else if (strcmp(type, "i8") == 0)
-						{
-							if (gmb_resize(gmb, (offset + sizeof(int8_t)), 0 /* FALSE */) == 0)
-							{
-								luaL_error(L, "failed to allocate blob memory");
-							}
+	if (lua_type(L, index) == LUA_TSTRING)
+	{
+		data = lua_tolstring(L, index, size);
+	}
+	else
+	{
+		src = luablob_checkgmb(L, index);
+		data = (const char *)src->data;
+		*size = src->usedsize;
+	}
 
-							*((int8_t *)ptradd(gmb->data, offset)) = (int8_t)luaL_checkinteger(L, -1);
-							offset += sizeof(int8_t);
-						}
-						else if (strcmp(type, "u8") == 0)
-						{
-							if (gmb_resize(gmb, (offset + sizeof(uint8_t)), 0 /* FALSE */) == 0)
-							{
-								luaL_error(L, "failed to allocate blob memory");
-							}
+	start = luablob_optsize(L, (index + 1), 0);
+	if (start > *size)
+	{
+		luaL_error(L, "unable to read data; bounds out of range");
+	}
+	count = (lua_isnoneornil(L, (index + 2)) ? (*size - start) : luablob_checksize(L, (index + 2)));
+	if (count > (*size - start))
+	{
+		luaL_error(L, "unable to read data; bounds out of range");
+	}
 
-							*((uint8_t *)ptradd(gmb->data, offset)) = (uint8_t)luaL_checkunsigned(L, -1);
-							offset += sizeof(uint8_t);
-						}
-						else if (strcmp(type, "i16") == 0)
-						{
-							if (gmb_resize(gmb, (offset + sizeof(int16_t)), 0 /* FALSE */) == 0)
-							{
-								luaL_error(L, "failed to allocate blob memory");
-							}
+	*size = count;
+	return (data + start);
+}
 
-							*((int16_t *)ptradd(gmb->data, offset)) = (int16_t)luaL_checkinteger(L, -1);
-							offset += sizeof(int16_t);
-						}
-						else if (strcmp(type, "u16") == 0)
-						{
-							if (gmb_resize(gmb, (offset + sizeof(uint16_t)), 0 /* FALSE */) == 0)
-							{
-								luaL_error(L, "failed to allocate blob memory");
-							}
+LUA_CFUNCTION_F lua_blob_compress(lua_State *L)
+{	//STACK: gmb level? allocmode? ?
+	GenericMemoryBlob *src;
+	GenericMemoryBlob *result;
+	GenericMemoryBlob gmb;
+	const char *allocmode;
+	void *workspace;
+	size_t header;
+	size_t bound;
+	size_t len;
+	int level;
+
+	src = luablob_checkgmb(L, 1);
+	level = luablob_checklevel(L, 2);
+	allocmode = luaL_optstring(L, 3, NULL);
+
+	workspace = lua_newuserdata(L, blobcompress_workspace(level));	//STACK: gmb level? allocmode? ? workspace
+
+	bound = (LUABLOB_VARINT_MAX + blobcompress_bound(src->usedsize));
+	luablob_newgmb(L, &gmb, bound, allocmode);
+	luablob_pushgmb(L, gmb);										//STACK: gmb level? allocmode? ? workspace blob
+	result = luablob_togmb(L, -1);
+	if (gmb_resizeraw(result, bound, 0 /* FALSE */) == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
 
-							*((uint16_t *)ptradd(gmb->data, offset)) = (uint16_t)luaL_checkunsigned(L, -1);
-							offset += sizeof(uint16_t);
-						}
-						else if (strcmp(type, "i32") == 0)
-						{
-							if (gmb_resize(gmb, (offset + sizeof(int32_t)), 0 /* FALSE */) == 0)
-							{
-								luaL_error(L, "failed to allocate blob memory");
-							}
+	header = luablob_uvarint_encode((unsigned char *)result->data, (uint64_t)src->usedsize);
+	len = blobcompress_compress(src->data, src->usedsize, ptradd(result->data, header), (bound - header), level, workspace);
+	if (len == 0)
+	{
+		luaL_error(L, "unable to compress data");
+	}
+	if (gmb_resizeraw(result, (header + len), 1 /* TRUE */) == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
 
-							*((int32_t *)ptradd(gmb->data, offset)) = (int32_t)luaL_checkinteger(L, -1);
-							offset += sizeof(int32_t);
-						}
-						else if (strcmp(type, "u32") == 0)
-						{
-							if (gmb_resize(gmb, (offset + sizeof(uint32_t)), 0 /* FALSE */) == 0)
-							{
-								luaL_error(L, "failed to allocate blob memory");
-							}
+	return 1;														//RETURN: blob
+}
 
-							*((uint16_t *)ptradd(gmb->data, offset)) = (uint32_t)luaL_checkunsigned(L, -1);
-							offset += sizeof(uint32_t);
-						}
-						else if (strcmp(type, "i64") == 0)
-						{
-							if (gmb_resize(gmb, (offset + sizeof(int64_t)), 0 /* FALSE */) == 0)
-							{
-								luaL_error(L, "failed to allocate blob memory");
-							}
+LUA_CFUNCTION_F lua_blob_decompress(lua_State *L)
+{	//STACK: gmb allocmode? ?
+	GenericMemoryBlob *src;
+	GenericMemoryBlob *result;
+	GenericMemoryBlob gmb;
+	uint64_t rawsize;
+	size_t header;
+	size_t clen;
 
-							*((int64_t *)ptradd(gmb->data, offset)) = (int64_t)luaL_checkinteger(L, -1);
-							offset += sizeof(int64_t);
-						}
-						else if (strcmp(type, "u64") == 0)
-						{
-							if (gmb_resize(gmb, (offset + sizeof(uint64_t)), 0 /* FALSE */) == 0)
-							{
-								luaL_error(L, "failed to allocate blob memory");
-							}
+	src = luablob_checkgmb(L, 1);
 
-							*((uint64_t *)ptradd(gmb->data, offset)) = (uint64_t)luaL_checkunsigned(L, -1);
-							offset += sizeof(uint64_t);
-						}
-						else if (strcmp(type, "float") == 0)
-						{
-							if (gmb_resize(gmb, (offset + sizeof(float)), 0 /* FALSE */) == 0)
-							{
-								luaL_error(L, "failed to allocate blob memory");
-							}
+	header = luablob_uvarint_decode((const unsigned char *)src->data, src->usedsize, &rawsize);
+	if (header == 0)
+	{
+		luaL_error(L, "unable to decompress data; corrupt or truncated input");
+	}
+	clen = (src->usedsize - header);
+	if (clen == 0 || (rawsize / LUABLOB_COMPRESS_MAXRATIO) > clen || rawsize > (uint64_t)((size_t)-1))
+	{
+		luaL_error(L, "unable to decompress data; corrupt or truncated input");
+	}
 
-							*((float *)ptradd(gmb->data, offset)) = (float)luaL_checknumber(L, -1);
-							offset += sizeof(float);
-						}
-						else if (strcmp(type, "double") == 0)
-						{
-							if (gmb_resize(gmb, (offset + sizeof(double)), 0 /* FALSE */) == 0)
-							{
-								luaL_error(L, "failed to allocate blob memory");
-							}
+	luablob_newgmb(L, &gmb, ((rawsize == 0) ? 1 : (size_t)rawsize), luaL_optstring(L, 2, NULL));
+	luablob_pushgmb(L, gmb);		//STACK: gmb allocmode? ? blob
+	result = luablob_togmb(L, -1);
+	if (gmb_resizeraw(result, (size_t)rawsize, 0 /* FALSE */) == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
 
-							*((double *)ptradd(gmb->data, offset)) = (double)luaL_checknumber(L, -1);
-							offset += sizeof(double);
-						}
-						else if (strcmp(type, "str") == 0)
-						{
-							data = luaL_checklstring(L, -1, &size);
-							if (size != 0)
-							{
-								if (gmb_resize(gmb, (offset + size), 0 /* FALSE */) == 0)
-								{
-									luaL_error(L, "failed to allocate blob memory");
-								}
+	if (blobcompress_decompress(ptradd(src->data, header), clen, result->data, (size_t)rawsize) != (size_t)rawsize)
+	{
+		luaL_error(L, "unable to decompress data; corrupt or truncated input");
+	}
+
+	return 1;						//RETURN: blob
+}
+
+typedef struct luablob_compressor_s
+{
+	GenericMemoryBlob pending;	//raw bytes waiting for a full block
+	size_t blocksize;
+	int level;
+	int state;					//0 before the frame header is written, 1 while writing blocks, 2 once finished
+	//the match finder workspace follows the struct
+} luablob_compressor;
+
+typedef struct luablob_decompressor_s
+{
+	GenericMemoryBlob pending;	//input bytes of an incomplete block
+	int state;					//0 before the frame header is read, 1 while reading blocks, 2 once the end marker was read
+} luablob_decompressor;
+
+void luablob_frame_putblock(lua_State *L, luablob_compressor *c, GenericMemoryBlob *out, const void *raw, size_t rawlen)
+{
+	unsigned char *block;
+	size_t len;
+
+	block = (unsigned char *)luablob_append(L, out, (LUABLOB_FRAME_HEADERLEN + blobcompress_bound(rawlen)));
+	len = blobcompress_compress(raw, rawlen, (block + LUABLOB_FRAME_HEADERLEN), blobcompress_bound(rawlen), c->level, (void *)(c + 1));
+	luablob_frame_put32(block, (uint32_t)rawlen);
+	if (len == 0 || len >= rawlen)
+	{
+		//incompressible blocks are stored as they are so the frame never grows by more than its headers
+		memcpy((block + LUABLOB_FRAME_HEADERLEN), raw, rawlen);
+		luablob_frame_put32((block + 4), ((uint32_t)rawlen | LUABLOB_FRAME_STORED));
+		len = rawlen;
+	}
+	else
+	{
+		luablob_frame_put32((block + 4), (uint32_t)len);
+	}
+
+	out->usedsize = ((size_t)((block + LUABLOB_FRAME_HEADERLEN + len) - (unsigned char *)out->data));
+}
+
+luablob_compressor *luablob_checkcompressor(lua_State *L, int index)
+{
+	luablob_compressor *c;
+
+	c = (luablob_compressor *)luaL_checkudata(L, index, "luablob_compressor_mt");
+	if (c->state == 2)
+	{
+		luaL_error(L, "unable to write data; the stream is already finished");
+	}
+
+	return c;
+}
+
+//Pushes an empty blob for the stream objects to append their output to.
+GenericMemoryBlob *luablob_pushoutput(lua_State *L, size_t sizehint)
+{
+	GenericMemoryBlob gmb;
+	GenericMemoryBlob *out;
+
+	luablob_newgmb(L, &gmb, ((sizehint == 0) ? 1 : sizehint), NULL);
+	luablob_pushgmb(L, gmb);
+	out = luablob_togmb(L, -1);
+	out->usedsize = 0;
+
+	return out;
+}
+
+LUA_CFUNCTION_F lua_blob_newcompressor(lua_State *L)
+{	//STACK: level? blocksize? ?
+	luablob_compressor *c;
+	lua_Number blocksize;
+	int level;
+
+	level = luablob_checklevel(L, 1);
+	blocksize = luaL_optnumber(L, 2, LUABLOB_FRAME_BLOCK);
+	if (blocksize < 1 || blocksize > LUABLOB_FRAME_MAXBLOCK)
+	{
+		luaL_error(L, "argument out of range; block size must be between 1 and %d", LUABLOB_FRAME_MAXBLOCK);
+	}
+
+	luaL_checkstack(L, 2, NULL);
+	c = (luablob_compressor *)lua_newuserdata(L, (sizeof(luablob_compressor) + blobcompress_workspace(level)));	//STACK: level? blocksize? ? compressor
+	c->pending.data = NULL;
+	c->pending.free = NULL;
+	c->blocksize = (size_t)blocksize;
+	c->level = level;
+	c->state = 0;
+	luaL_setmetatable(L, "luablob_compressor_mt");
+
+	luablob_newgmb(L, &(c->pending), c->blocksize, NULL);
+
+	return 1;	//RETURN: compressor
+}
+
+LUA_CFUNCTION_F lua_blob_compressor_write(lua_State *L)
+{	//STACK: compressor value start? count? ?
+	luablob_compressor *c;
+	GenericMemoryBlob *out;
+	const char *data;
+	size_t size;
+	size_t take;
+
+	c = luablob_checkcompressor(L, 1);
+	data = luablob_checksource(L, 2, &size);
+
+	out = luablob_pushoutput(L, (LUABLOB_FRAME_MAGICLEN + blobcompress_bound(size) + ((size / c->blocksize) + 1) * LUABLOB_FRAME_HEADERLEN));	//STACK: compressor value start? count? ? blob
+	if (c->state == 0)
+	{
+		memcpy(luablob_append(L, out, LUABLOB_FRAME_MAGICLEN), LUABLOB_FRAME_MAGIC, LUABLOB_FRAME_MAGICLEN);
+		c->state = 1;
+	}
+
+	while (size > 0)
+	{
+		if (c->pending.usedsize == 0 && size >= c->blocksize)
+		{
+			//whole blocks are compressed straight from the source
+			luablob_frame_putblock(L, c, out, data, c->blocksize);
+			data += c->blocksize;
+			size -= c->blocksize;
+			continue;
+		}
+
+		take = (c->blocksize - c->pending.usedsize);
+		if (take > size)
+		{
+			take = size;
+		}
+		memcpy(ptradd(c->pending.data, c->pending.usedsize), data, take);
+		c->pending.usedsize += take;
+		data += take;
+		size -= take;
+
+		if (c->pending.usedsize == c->blocksize)
+		{
+			luablob_frame_putblock(L, c, out, c->pending.data, c->pending.usedsize);
+			c->pending.usedsize = 0;
+		}
+	}
+
+	return 1;	//RETURN: blob
+}
+
+LUA_CFUNCTION_F lua_blob_compressor_finish(lua_State *L)
+{	//STACK: compressor ?
+	luablob_compressor *c;
+	GenericMemoryBlob *out;
+
+	c = luablob_checkcompressor(L, 1);
+
+	out = luablob_pushoutput(L, (LUABLOB_FRAME_MAGICLEN + blobcompress_bound(c->pending.usedsize) + LUABLOB_FRAME_HEADERLEN + 4));	//STACK: compressor ? blob
+	if (c->state == 0)
+	{
+		memcpy(luablob_append(L, out, LUABLOB_FRAME_MAGICLEN), LUABLOB_FRAME_MAGIC, LUABLOB_FRAME_MAGICLEN);
+	}
+	if (c->pending.usedsize > 0)
+	{
+		luablob_frame_putblock(L, c, out, c->pending.data, c->pending.usedsize);
+		c->pending.usedsize = 0;
+	}
+	luablob_frame_put32((unsigned char *)luablob_append(L, out, 4), 0);	//a zero raw size ends the frame
+	c->state = 2;
+
+	return 1;	//RETURN: blob
+}
+
+LUA_CFUNCTION_F lua_luablob_compressor_mt___gc(lua_State *L)
+{	//STACK: compressor ?
+	luablob_compressor *c;
+
+	c = (luablob_compressor *)luaL_checkudata(L, 1, "luablob_compressor_mt");
+	if (c->pending.free != NULL)
+	{
+		gmb_free(&(c->pending));
+		c->pending.free = NULL;
+	}
+
+	return 0;
+}
+
+//Decodes the complete blocks in data into out and returns how many input bytes were used.
+size_t luablob_frame_read(lua_State *L, luablob_decompressor *d, GenericMemoryBlob *out, const unsigned char *data, size_t size)
+{
+	size_t pos;
+	size_t rawlen;
+	size_t clen;
+	int stored;
+	void *dest;
+
+	pos = 0;
+	if (d->state == 0)
+	{
+		if (size < LUABLOB_FRAME_MAGICLEN)
+		{
+			return 0;
+		}
+		if (memcmp(data, LUABLOB_FRAME_MAGIC, LUABLOB_FRAME_MAGICLEN) != 0)
+		{
+			luaL_error(L, "unable to decompress data; input is not a compressed frame");
+		}
+		pos = LUABLOB_FRAME_MAGICLEN;
+		d->state = 1;
+	}
+
+	while (d->state == 1 && (size - pos) >= 4)
+	{
+		rawlen = luablob_frame_get32(data + pos);
+		if (rawlen == 0)
+		{
+			pos += 4;
+			d->state = 2;
+			break;
+		}
+		if ((size - pos) < LUABLOB_FRAME_HEADERLEN)
+		{
+			break;
+		}
+
+		clen = luablob_frame_get32(data + pos + 4);
+		stored = ((clen & LUABLOB_FRAME_STORED) != 0);
+		clen &= ~LUABLOB_FRAME_STORED;
+		//a compressed block can be no smaller than the codec's best ratio and no larger than its worst case, so a header cannot make us buffer more than a block
+		if (
+			rawlen > LUABLOB_FRAME_MAXBLOCK ||
+			clen == 0 ||
+			clen > LUABLOB_FRAME_MAXBLOCK ||
+			(stored ? (clen != rawlen) : (((rawlen / LUABLOB_COMPRESS_MAXRATIO) > clen) || (clen > blobcompress_bound(rawlen))))
+		)
+		{
+			luaL_error(L, "unable to decompress data; corrupt block header");
+		}
+		if ((size - pos - LUABLOB_FRAME_HEADERLEN) < clen)
+		{
+			break;
+		}
+
+		dest = luablob_append(L, out, rawlen);
+		if (stored)
+		{
+			memcpy(dest, (data + pos + LUABLOB_FRAME_HEADERLEN), rawlen);
+		}
+		else if (blobcompress_decompress((data + pos + LUABLOB_FRAME_HEADERLEN), clen, dest, rawlen) != rawlen)
+		{
+			luaL_error(L, "unable to decompress data; corrupt block");
+		}
+		pos += (LUABLOB_FRAME_HEADERLEN + clen);
+	}
+
+	if (d->state == 2 && pos < size)
+	{
+		luaL_error(L, "unable to decompress data; unexpected data after the end of the frame");
+	}
+
+	return pos;
+}
+
+LUA_CFUNCTION_F lua_blob_newdecompressor(lua_State *L)
+{	//STACK: ?
+	luablob_decompressor *d;
+
+	luaL_checkstack(L, 2, NULL);
+	d = (luablob_decompressor *)lua_newuserdata(L, sizeof(luablob_decompressor));	//STACK: ? decompressor
+	d->pending.data = NULL;
+	d->pending.free = NULL;
+	d->state = 0;
+	luaL_setmetatable(L, "luablob_decompressor_mt");
+
+	luablob_newgmb(L, &(d->pending), LUABLOB_FRAME_BLOCK, NULL);
+	d->pending.usedsize = 0;
+
+	return 1;	//RETURN: decompressor
+}
+
+LUA_CFUNCTION_F lua_blob_decompressor_write(lua_State *L)
+{	//STACK: decompressor value start? count? ?
+	luablob_decompressor *d;
+	GenericMemoryBlob *out;
+	const char *data;
+	size_t size;
+	size_t used;
+
+	d = (luablob_decompressor *)luaL_checkudata(L, 1, "luablob_decompressor_mt");
+	data = luablob_checksource(L, 2, &size);
+	if (d->state == 2 && size > 0)
+	{
+		luaL_error(L, "unable to decompress data; unexpected data after the end of the frame");
+	}
+
+	out = luablob_pushoutput(L, size);	//STACK: decompressor value start? count? ? blob
+
+	if (d->pending.usedsize == 0)
+	{
+		//the common case decodes straight from the input and only buffers a trailing partial block
+		used = luablob_frame_read(L, d, out, (const unsigned char *)data, size);
+		memcpy(luablob_append(L, &(d->pending), (size - used)), (data + used), (size - used));
+	}
+	else
+	{
+		memcpy(luablob_append(L, &(d->pending), size), data, size);
+		used = luablob_frame_read(L, d, out, (const unsigned char *)d->pending.data, d->pending.usedsize);
+		memmove(d->pending.data, ptradd(d->pending.data, used), (d->pending.usedsize - used));
+		d->pending.usedsize -= used;
+	}
+
+	lua_pushboolean(L, (d->state == 2));	//STACK: decompressor value start? count? ? blob finished
+	return 2;								//RETURN: blob finished
+}
+
+LUA_CFUNCTION_F lua_luablob_decompressor_mt___gc(lua_State *L)
+{	//STACK: decompressor ?
+	luablob_decompressor *d;
+
+	d = (luablob_decompressor *)luaL_checkudata(L, 1, "luablob_decompressor_mt");
+	if (d->pending.free != NULL)
+	{
+		gmb_free(&(d->pending));
+		d->pending.free = NULL;
+	}
+
+	return 0;
+}
+
+//Text encodings. Each encoder and decoder either returns a fresh value or, given a destination blob and offset, writes there
+//(ending the blob at the written data, like write does) and returns the end offset.
+const char *luablob_checktext(lua_State *L, int index, size_t *size)
+{
+	GenericMemoryBlob *src;
+
+	if (lua_type(L, index) == LUA_TSTRING)
+	{
+		return lua_tolstring(L, index, size);
+	}
+
+	src = luablob_checkgmb(L, index);
+	*size = src->usedsize;
+	return (const char *)src->data;
+}
+
+//Sizes the destination blob at index for count bytes from the offset that follows it; srcindex is refetched afterwards since
+//growing the destination may move a view's storage, and the source must not be the destination itself.
+GenericMemoryBlob *luablob_checkdest(lua_State *L, int index, int srcindex, size_t count, size_t *pos)
+{
+	GenericMemoryBlob *dest;
+
+	dest = luablob_checkgmb(L, index);
+	if (lua_rawequal(L, index, srcindex))
+	{
+		luaL_error(L, "invalid argument; destination blob must not be the source blob");
+	}
+	*pos = luablob_optsize(L, (index + 1), 0);
+	if (*pos > dest->usedsize)
+	{
+		luaL_error(L, "destination blob does not contain write start offset");
+	}
+	if (gmb_resizeraw(dest, (*pos + count), 0 /* FALSE */) == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
+
+	return dest;
+}
+
+LUA_CFUNCTION_F lua_blob_tohex(lua_State *L)
+{	//STACK: gmb dest? destpos? ?
+	GenericMemoryBlob *src;
+	GenericMemoryBlob *dest;
+	luaL_Buffer b;
+	size_t pos;
+	size_t len;
 
-								memcpy(ptradd(gmb->data, offset), data, size);
-								offset += size;
-							}
-						}
-						else if (strcmp(type, "blob") == 0)
-						{
-							srcblob = luablob_checkgmb(L, -1);
-							if (srcblob->usedsize != 0)
-							{
-								lua_checkstack(L, 2);
-								lua_pushliteral(L, "start");	//STACK: gmb infos... value 'start'
-								lua_gettable(L, i);				//STACK: gmb infos... value start
-								if (lua_isnil(L, -1))
-								{
-									srcoffset = 0;
-								}
-								else
-								{
-									srcoffset = luaL_checkint(L, -1);
-								}
-								lua_pop(L, 1);					//STACK: gmb infos... value
-
-								lua_pushliteral(L, "count");	//STACK: gmb infos... value 'count'
-								lua_gettable(L, i);				//STACK: gmb infos... value count
-								if (lua_isnil(L, -1))
-								{
-									size = (srcblob->usedsize - srcoffset);
-								}
-								else
-								{
-									size = (size_t)luaL_checkint(L, -1);
-								}
-								lua_pop(L, 1);					//STACK: gmb infos... value
-
-								if ((srcoffset + size) > srcblob->usedsize)
-								{
-									luaL_error(L, "access to value luablob was out of bounds");
-								}
-
-								if (gmb_resize(gmb, (offset + size), 0 /* FALSE */) == 0)
-								{
-									luaL_error(L, "failed to allocate blob memory");
-								}
-
-								memcpy(ptradd(gmb->data, offset), ptradd(srcblob->data, srcoffset), size);
-								offset += size;
-							}
-						}
-						else
-						{
-							luaL_error(L, "unrecognized datatype specifier '%s'", type);
-						}
-					}
+	src = luablob_checkgmb(L, 1);
+	len = blobencode_hexlen(src->usedsize);
 
-					lua_pop(L, 1);	//STACK: gmb infos...
-				}
-				break;
-			case LUA_TNIL:
-				break;
-			default:
-				luaL_error(L, "invalid argument; a write information item must be nil, an offset delta integer, a data string, or a write information table");
-		}
+	if (lua_isnoneornil(L, 2))
+	{
+		luaL_buffinit(L, &b);
+		blobencode_tohex(src->data, src->usedsize, luaL_prepbuffsize(&b, len));
+		luaL_addsize(&b, len);
+		luaL_pushresult(&b);		//STACK: gmb ? str
+		return 1;					//RETURN: str
 	}
 
-	return 0;
+	dest = luablob_checkdest(L, 2, 1, len, &pos);
+	src = luablob_checkgmb(L, 1);
+	blobencode_tohex(src->data, src->usedsize, (char *)ptradd(dest->data, pos));
+
+	lua_pushinteger(L, (pos + len));	//STACK: gmb dest destpos? ? endpos
+	return 1;							//RETURN: endpos
 }
 
-LUA_CFUNCTION_F lua_blob_clear(lua_State *L)
-{	//STACK: gmb start? count?
-	GenericMemoryBlob *gmb;
-	int start;
-	size_t count;
-	size_t size;
+LUA_CFUNCTION_F lua_blob_tobase64(lua_State *L)
+{	//STACK: gmb urlsafe? dest? destpos? ?
+	GenericMemoryBlob *src;
+	GenericMemoryBlob *dest;
+	luaL_Buffer b;
+	int urlsafe;
+	size_t pos;
+	size_t len;
 
-	gmb = luablob_checkgmb(L, 1);
+	src = luablob_checkgmb(L, 1);
+	urlsafe = lua_toboolean(L, 2);
+	len = blobencode_base64len(src->usedsize, urlsafe);
 
-	if (lua_gettop(L) > 1)
+	if (lua_isnoneornil(L, 3))
 	{
-		start = luaL_checkint(L, 2);
-		if (start < 0)
-		{
-			luaL_error(L, "argument out of range; start index must be non-negative");
-		}
+		luaL_buffinit(L, &b);
+		blobencode_tobase64(src->data, src->usedsize, luaL_prepbuffsize(&b, len), urlsafe);
+		luaL_addsize(&b, len);
+		luaL_pushresult(&b);		//STACK: gmb urlsafe? ? str
+		return 1;					//RETURN: str
+	}
 
-		if (lua_gettop(L) > 2)
-		{
-			count = (size_t)luaL_checkunsigned(L, 3);
+	dest = luablob_checkdest(L, 3, 1, len, &pos);
+	src = luablob_checkgmb(L, 1);
+	blobencode_tobase64(src->data, src->usedsize, (char *)ptradd(dest->data, pos), urlsafe);
 
-			size = (start + count);
-			if (size > gmb->usedsize)
-			{
-				if (gmb_resize(gmb, size, 0 /* FALSE */) == 0)
-				{
-					luaL_error(L, "failed to allocate blob memory");
-				}
-			}
-		}
-		else
+	lua_pushinteger(L, (pos + len));	//STACK: gmb urlsafe dest destpos? ? endpos
+	return 1;							//RETURN: endpos
+}
+
+//Shared tail of fromhex and frombase64: decodes into a new blob, or into the destination blob when one is given.
+int luablob_decodetext(lua_State *L, size_t maxlen, size_t (*decode)(const char *, size_t, void *), const char *what)
+{	//STACK: text dest? destpos? ?
+	GenericMemoryBlob *result;
+	GenericMemoryBlob gmb;
+	const char *text;
+	size_t size;
+	size_t pos;
+	size_t len;
+	int todest;
+
+	todest = !lua_isnoneornil(L, 2);
+	if (!todest)
+	{
+		luablob_newgmb(L, &gmb, ((maxlen == 0) ? 1 : maxlen), NULL);
+		luablob_pushgmb(L, gmb);		//STACK: text ? blob
+		result = luablob_togmb(L, -1);
+		pos = 0;
+		if (gmb_resizeraw(result, maxlen, 0 /* FALSE */) == 0)
 		{
-			count = (gmb->usedsize - start);
+			luaL_error(L, "failed to allocate blob memory");
 		}
 	}
 	else
 	{
-		start = 0;
-		count = gmb->usedsize;
+		result = luablob_checkdest(L, 2, 1, maxlen, &pos);
 	}
 
-	memset(ptradd(gmb->data, start), 0, count);
+	text = luablob_checktext(L, 1, &size);
+	len = decode(text, size, ptradd(result->data, pos));
+	if (len == ((size_t)-1))
+	{
+		luaL_error(L, "invalid argument; malformed %s string", what);
+	}
+	gmb_resizeraw(result, (pos + len), 0 /* FALSE */);
 
-	return 0;
+	if (!todest)
+	{
+		return 1;						//RETURN: blob
+	}
+
+	lua_pushinteger(L, (pos + len));	//STACK: text dest destpos? ? endpos
+	return 1;							//RETURN: endpos
 }
 
-LUA_CFUNCTION_F lua_blob_resize(lua_State *L)
-{	//STACK: gmb newsize trim? ?
+LUA_CFUNCTION_F lua_blob_fromhex(lua_State *L)
+{	//STACK: text dest? destpos? ?
+	size_t size;
+
+	luablob_checktext(L, 1, &size);
+	return luablob_decodetext(L, (size / 2), &blobencode_fromhex, "hex");
+}
+
+LUA_CFUNCTION_F lua_blob_frombase64(lua_State *L)
+{	//STACK: text dest? destpos? ?
+	size_t size;
+
+	luablob_checktext(L, 1, &size);
+	return luablob_decodetext(L, blobencode_base64max(size), &blobencode_frombase64, "base64");
+}
+
+//Unicode. isutf8 reports the offset of the first byte that does not start a valid sequence; the UTF-16LE conversions follow the
+//text encodings above and reject malformed input.
+LUA_CFUNCTION_F lua_blob_isutf8(lua_State *L)
+{	//STACK: gmb pos? len? ?
 	GenericMemoryBlob *gmb;
-	size_t nsize;
-	int trim;
+	size_t pos;
+	size_t len;
+	size_t bad;
 
 	gmb = luablob_checkgmb(L, 1);
-	nsize = (size_t)luaL_checkunsigned(L, 2);
+	pos = luablob_optsize(L, 2, 0);
+	if (pos > gmb->usedsize)
+	{
+		luaL_error(L, "unable to read data; bounds out of range");
+	}
+	len = (lua_isnoneornil(L, 3) ? (gmb->usedsize - pos) : luablob_checksize(L, 3));
+	if (len > (gmb->usedsize - pos))
+	{
+		luaL_error(L, "unable to read data; bounds out of range");
+	}
 
-	if (nsize == 0)
+	bad = blobutf8_validate(ptradd(gmb->data, pos), len);
+	if (bad == len)
 	{
-		luaL_error(L, "invalid argument: new size must be greater than 0.");
+		lua_pushboolean(L, 1 /* TRUE */);	//STACK: gmb pos? len? ? true
+		return 1;							//RETURN: true
 	}
 
-	if (lua_gettop(L) > 2)
+	lua_pushboolean(L, 0 /* FALSE */);	//STACK: gmb pos? len? ? false
+	lua_pushinteger(L, (pos + bad));	//STACK: gmb pos? len? ? false offset
+	return 2;							//RETURN: false offset
+}
+
+LUA_CFUNCTION_F lua_blob_utf16le(lua_State *L)
+{	//STACK: gmb dest? destpos? ?
+	GenericMemoryBlob *src;
+
+	src = luablob_checkgmb(L, 1);
+	return luablob_decodetext(L, blobutf8_utf16max(src->usedsize), &blobutf8_toutf16le, "utf-8");
+}
+
+LUA_CFUNCTION_F lua_blob_fromutf16le(lua_State *L)
+{	//STACK: text dest? destpos? ?
+	size_t size;
+
+	luablob_checktext(L, 1, &size);
+	return luablob_decodetext(L, blobutf8_utf8max(size), &blobutf8_fromutf16le, "utf-16le");
+}
+
+//Numeric text. The parsers read at an offset and return the value with the number of characters consumed, or nil when no number
+//starts there; the writers format at an offset (ending the blob at the written text, like write does) and return its length.
+int luablob_checkbase(lua_State *L, int index)
+{
+	lua_Integer base;
+
+	base = luaL_optinteger(L, index, 10);
+	if (base < BLOBNUMBER_MINBASE || base > BLOBNUMBER_MAXBASE)
 	{
-		luaL_checktype(L, 3, LUA_TBOOLEAN);
-		trim = lua_toboolean(L, 3);
+		luaL_error(L, "argument out of range; base must be between 2 and 36");
 	}
-	else
+
+	return (int)base;
+}
+
+GenericMemoryBlob *luablob_checkparsepos(lua_State *L, size_t *pos)
+{	//STACK: gmb pos ?
+	GenericMemoryBlob *gmb;
+
+	gmb = luablob_checkgmb(L, 1);
+	*pos = luablob_checksize(L, 2);
+	if (*pos > gmb->usedsize)
 	{
-		trim = 0;
+		luaL_error(L, "unable to read data; bounds out of range");
 	}
 
-	if (gmb_resize(gmb, nsize, trim) == 0)
+	return gmb;
+}
+
+int luablob_pushparsed(lua_State *L, double value, size_t len)
+{	//STACK: ?
+	if (len == 0)
 	{
-		luaL_error(L, "failed to allocate blob memory");
+		lua_pushnil(L);						//STACK: ? nil
+		return 1;							//RETURN: nil
 	}
 
-	return 0;
+	lua_pushnumber(L, (lua_Number)value);	//STACK: ? value
+	lua_pushinteger(L, len);				//STACK: ? value len
+	return 2;								//RETURN: value len
 }
 
-LUA_CFUNCTION_F lua_blob_freeblob(lua_State *L)
-{	//STACK: gmb ?
-	gmb_free(luablob_checkgmb(L, 1));
+LUA_CFUNCTION_F lua_blob_parseint(lua_State *L)
+{	//STACK: gmb pos base? ?
+	GenericMemoryBlob *gmb;
+	double value;
+	size_t pos;
+	size_t len;
+	int base;
 
-	return 0;	//RETURN
+	gmb = luablob_checkparsepos(L, &pos);
+	base = luablob_checkbase(L, 3);
+
+	len = blobnumber_parseint((const char *)ptradd(gmb->data, pos), (gmb->usedsize - pos), base, &value);
+	return luablob_pushparsed(L, value, len);	//RETURN: value len | nil
+}
+
+LUA_CFUNCTION_F lua_blob_parsenum(lua_State *L)
+{	//STACK: gmb pos ?
+	GenericMemoryBlob *gmb;
+	double value;
+	size_t pos;
+	size_t len;
+
+	gmb = luablob_checkparsepos(L, &pos);
+
+	len = blobnumber_parsenum((const char *)ptradd(gmb->data, pos), (gmb->usedsize - pos), &value);
+	return luablob_pushparsed(L, value, len);	//RETURN: value len | nil
+}
+
+//Writes len bytes of text at the offset in index 2; the value being formatted sits at index 3.
+int luablob_writetext(lua_State *L, const char *text, size_t len)
+{	//STACK: gmb pos value ?
+	GenericMemoryBlob *gmb;
+	size_t pos;
+
+	gmb = luablob_checkdest(L, 1, 3, len, &pos);
+	memcpy(ptradd(gmb->data, pos), text, len);
+	luablob_countbytes(writebytes, len);
+
+	lua_pushinteger(L, len);	//STACK: gmb pos value ? len
+	return 1;					//RETURN: len
+}
+
+LUA_CFUNCTION_F lua_blob_writeint(lua_State *L)
+{	//STACK: gmb pos n base? ?
+	char text[BLOBNUMBER_UINTMAX + 1];
+	lua_Number n;
+	size_t len;
+	int base;
+
+	n = luaL_checknumber(L, 3);
+	base = luablob_checkbase(L, 4);
+	//the range test comes first since converting an out of range double to an integer type is undefined
+	if (!(n >= -9223372036854775808.0 && n < 18446744073709551616.0) ||
+		n != ((n < 0) ? (lua_Number)((int64_t)n) : (lua_Number)((uint64_t)n)))
+	{
+		luaL_error(L, "invalid argument; value must be an integer that fits in 64 bits");
+	}
+
+	len = 0;
+	if (n < 0)
+	{
+		text[len++] = '-';
+		n = -n;
+	}
+	len += blobnumber_formatuint((text + len), (uint64_t)n, base);
+
+	return luablob_writetext(L, text, len);	//RETURN: len
+}
+
+//Integers take the digit pair formatter; everything else (and zero, to keep its sign) is formatted exactly as tostring would.
+LUA_CFUNCTION_F lua_blob_writenum(lua_State *L)
+{	//STACK: gmb pos x ?
+	char text[LUAI_MAXNUMBER2STR];
+	lua_Number x;
+	size_t len;
+
+	x = luaL_checknumber(L, 3);
+	if (x > -1e14 && x < 1e14 && x != 0 && x == (lua_Number)((int64_t)x))
+	{
+		len = 0;
+		if (x < 0)
+		{
+			text[len++] = '-';
+			x = -x;
+		}
+		len += blobnumber_formatuint((text + len), (uint64_t)x, 10);
+	}
+	else
+	{
+		len = (size_t)lua_number2str(text, x);
+	}
+
+	return luablob_writetext(L, text, len);	//RETURN: len
 }
 
 LUABLOB_API(void) luablob_pushgmb(lua_State *L, GenericMemoryBlob blob)
@@ -1031,6 +6256,8 @@ LUABLOB_API(int) luablob_isgmb(lua_State *L, int index)
 
 LUABLOB_API(GenericMemoryBlob *) luablob_togmb(lua_State *L, int index)
 {	//STACK: ? blob
+	GenericMemoryBlob *gmb;
+
 	luaL_checkstack(L, 2, NULL);
 
 	lua_getmetatable(L, -1);			//STACK: ? blob blob_mt
@@ -1039,7 +6266,12 @@ LUABLOB_API(GenericMemoryBlob *) luablob_togmb(lua_State *L, int index)
 	if (lua_compare(L, -1, -2, LUA_OPEQ))
 	{
 		lua_pop(L, 2); //STACK: ? blob
-		return (GenericMemoryBlob *)lua_touserdata(L, -1);
+		gmb = (GenericMemoryBlob *)lua_touserdata(L, -1);
+		if (gmb->data != NULL && gmb->free == &luablob_view_free)
+		{
+			luablob_view_sync(L, gmb);
+		}
+		return gmb;
 	}
 	else
 	{
@@ -1057,31 +6289,98 @@ LUABLOB_API(GenericMemoryBlob *) luablob_checkgmb(lua_State *L, int index)
 	{
 		luaL_error(L, "unable to use freed blob");
 	}
+	if (gmb->free == &luablob_view_free)
+	{
+		luablob_view_sync(L, gmb);
+	}
 
 	//STACK: ? blob
 	return gmb;
 }
 
-LUABLOB_API(int) gmb_resize(GenericMemoryBlob *blob, size_t nsize, int trim)
+//Shared by gmb_resize and gmb_resizeraw; zero decides whether bytes past the old used size are cleared.
+int luablob_resize(GenericMemoryBlob *blob, size_t nsize, int trim, int zero)
 {
 	int result;
-	if ((nsize > blob->usedsize) || trim)
+
+	if (blob->free == &luablob_shared_free)
 	{
-		result = gmb_realloc(blob, nsize);
-		if (nsize > blob->usedsize)
+		if (luablob_unshare(blob, nsize) == 0)
+		{
+			return 0;
+		}
+	}
+	else if (blob->free == &luablob_view_free)
+	{
+		if (gmb_unshare(blob) == 0)
 		{
-			memset(ptradd(blob->data, blob->usedsize), 0, (nsize - blob->usedsize));
+			return 0;
 		}
+	}
+
+	if (trim || nsize > blob->allocsize)
+	{
+		result = gmb_realloc(blob, nsize);
 		if (result != 1)
 		{
 			return result;
 		}
 	}
+	if (zero && nsize > blob->usedsize)
+	{
+		memset(ptradd(blob->data, blob->usedsize), 0, (nsize - blob->usedsize));
+		luablob_countbytes(zerobytes, (nsize - blob->usedsize));
+	}
 
 	blob->usedsize = nsize;
 	return 1;
 }
 
+LUABLOB_API(int) gmb_resize(GenericMemoryBlob *blob, size_t nsize, int trim)
+{
+	return luablob_resize(blob, nsize, trim, 1 /* TRUE */);
+}
+
+LUABLOB_API(int) gmb_resizeraw(GenericMemoryBlob *blob, size_t nsize, int trim)
+{
+	return luablob_resize(blob, nsize, trim, 0 /* FALSE */);
+}
+
+LUABLOB_API(int) gmb_unshare(GenericMemoryBlob *blob)
+{
+	luablob_viewinfo *info;
+
+	if (blob->free == &luablob_shared_free)
+	{
+		return luablob_unshare(blob, 0);
+	}
+	if (blob->free == &luablob_view_free)
+	{
+		//writes through a view land in the parent, so it is the parent that must own its storage
+		info = (luablob_viewinfo *)blob->userdata;
+		if (info->parent->free == &luablob_shared_free)
+		{
+			if (luablob_unshare(info->parent, 0) == 0)
+			{
+				return 0;
+			}
+			blob->data = ptradd(info->parent->data, info->start);
+		}
+	}
+
+	return 1;
+}
+
+LUABLOB_API(int) gmb_reserve(GenericMemoryBlob *blob, size_t nsize)
+{
+	if (nsize <= blob->allocsize)
+	{
+		return 1;
+	}
+
+	return gmb_realloc(blob, nsize);
+}
+
 LUABLOB_API(int) gmb_realloc(GenericMemoryBlob *blob, size_t nsize)
 {
 	size_t allocsize;
@@ -1092,7 +6391,7 @@ LUABLOB_API(int) gmb_realloc(GenericMemoryBlob *blob, size_t nsize)
 		return -1;
 	}
 
-	allocsize = blob->realloc(blob, nsize);
+	allocsize = luablob_callrealloc(blob, nsize);
 	if (allocsize == 0)
 	{
 		return 0;
@@ -1114,19 +6413,28 @@ LUABLOB_API(void) gmb_free(GenericMemoryBlob *blob)
 {
 	if (blob->free != NULL)
 	{
-		blob->free(blob);
+		luablob_callfree(blob);
 	}
 
 	blob->data = NULL;
 	blob->free = NULL;
 	blob->realloc = NULL;
+	blob->statmode = 0;
 	blob->usedsize = 0;
 	blob->allocsize = 0;
 }
 
+LUA_CFUNCTION_F lua_luablob_mod___call(lua_State *L)
+{	//STACK: mod initialsize? allocmode? ?
+	lua_remove(L, 1);	//STACK: initialsize? allocmode? ?
+	return lua_blob_newblob(L);
+}
+
 const luaL_Reg luablob_mt_funcs[] = {
 	{"__len", &lua_luablob_mt___len},
 	{"__eq", &lua_luablob_mt___eq},
+	{"__lt", &lua_luablob_mt___lt},
+	{"__le", &lua_luablob_mt___le},
 	{"__gc", &lua_luablob_mt___gc},
 	{"__tostring", &lua_luablob_mt___tostring},
 	{NULL, NULL}
@@ -1136,25 +6444,248 @@ const luaL_Reg luablob_mt___index_funcs[] =
 {
 	{"read", &lua_blob_read},
 	{"write", &lua_blob_write},
+	{"readarray", &lua_blob_readarray},
+	{"writearray", &lua_blob_writearray},
+	{"asarray", &lua_blob_asarray},
+	{"cursor", &lua_blob_cursor},
+	{"bitcursor", &lua_blob_bitcursor},
+	{"readbits", &lua_blob_readbits},
+	{"writebits", &lua_blob_writebits},
+	{"unpackbits", &lua_blob_unpackbits},
+	{"find", &lua_blob_find},
+	{"findbyte", &lua_blob_findbyte},
+	{"findany", &lua_blob_findany},
+	{"count", &lua_blob_count},
+	{"compare", &lua_blob_compare},
+	{"compress", &lua_blob_compress},
+	{"decompress", &lua_blob_decompress},
+	{"tohex", &lua_blob_tohex},
+	{"tobase64", &lua_blob_tobase64},
+	{"parseint", &lua_blob_parseint},
+	{"parsenum", &lua_blob_parsenum},
+	{"writeint", &lua_blob_writeint},
+	{"writenum", &lua_blob_writenum},
+	{"isutf8", &lua_blob_isutf8},
+	{"utf16le", &lua_blob_utf16le},
 	{"clear", &lua_blob_clear},
 	{"resize", &lua_blob_resize},
+	{"reserve", &lua_blob_reserve},
+	{"view", &lua_blob_view},
+	{"clone", &lua_blob_clone},
 	{"free", &lua_blob_freeblob},
 	{NULL, NULL}
 };
 
+const luaL_Reg luablob_plan_mt___index_funcs[] =
+{
+	{"read", &lua_blob_plan_read},
+	{"write", &lua_blob_plan_write},
+	{NULL, NULL}
+};
+
+const luaL_Reg luablob_array_mt_funcs[] =
+{
+	{"__index", &lua_luablob_array_mt___index},
+	{"__newindex", &lua_luablob_array_mt___newindex},
+	{"__len", &lua_luablob_array_mt___len},
+	{"__ipairs", &lua_luablob_array_mt___ipairs},
+	{"__gc", &lua_luablob_array_mt___gc},
+	{NULL, NULL}
+};
+
+const luaL_Reg luablob_chain_mt_funcs[] =
+{
+	{"__len", &lua_luablob_chain_mt___len},
+	{"__gc", &lua_luablob_chain_mt___gc},
+	{NULL, NULL}
+};
+
+const luaL_Reg luablob_chain_mt___index_funcs[] =
+{
+	{"append", &lua_blob_chain_append},
+	{"flatten", &lua_blob_chain_flatten},
+	{"clear", &lua_blob_chain_clear},
+	{NULL, NULL}
+};
+
+const luaL_Reg luablob_cursor_mt___index_funcs[] =
+{
+	{"pos", &lua_blob_cursor_pos},
+	{"seek", &lua_blob_cursor_seek},
+	{"skip", &lua_blob_cursor_skip},
+	{"remaining", &lua_blob_cursor_remaining},
+	{NULL, NULL}
+};
+
+const luaL_Reg luablob_bitcursor_mt___index_funcs[] =
+{
+	{"read", &lua_blob_bitcursor_read},
+	{"unpack", &lua_blob_bitcursor_unpack},
+	{"pos", &lua_blob_bitcursor_pos},
+	{"seek", &lua_blob_bitcursor_seek},
+	{"skip", &lua_blob_bitcursor_skip},
+	{"align", &lua_blob_bitcursor_align},
+	{"remaining", &lua_blob_bitcursor_remaining},
+	{NULL, NULL}
+};
+
+const luaL_Reg luablob_ring_mt_funcs[] =
+{
+	{"__len", &lua_luablob_ring_mt___len},
+	{"__tostring", &lua_luablob_ring_mt___tostring},
+	{"__gc", &lua_luablob_ring_mt___gc},
+	{NULL, NULL}
+};
+
+const luaL_Reg luablob_ring_mt___index_funcs[] =
+{
+	{"write", &lua_blob_ring_write},
+	{"peek", &lua_blob_ring_peek},
+	{"read", &lua_blob_ring_read},
+	{"consume", &lua_blob_ring_consume},
+	{"find", &lua_blob_ring_find},
+	{"clear", &lua_blob_ring_clear},
+	{"capacity", &lua_blob_ring_capacity},
+	{"writefrom", &lua_blob_ring_writefrom},
+	{"readto", &lua_blob_ring_readto},
+	{NULL, NULL}
+};
+
+const luaL_Reg luablob_funcs[] =
+{
+	{"new", &lua_blob_newblob},
+	{"compile", &lua_blob_compile},
+	{"setgrowth", &lua_blob_setgrowth},
+	{"mapfile", &lua_blob_mapfile},
+	{"setdefaultmode", &lua_blob_setdefaultmode},
+	{"sethugepages", &lua_blob_sethugepages},
+	{"poolstats", &lua_blob_poolstats},
+	{"stats", &lua_blob_stats},
+	{"resetstats", &lua_blob_resetstats},
+	{"ring", &lua_blob_newring},
+	{"chain", &lua_blob_newchain},
+	{"compressor", &lua_blob_newcompressor},
+	{"decompressor", &lua_blob_newdecompressor},
+	{"fromhex", &lua_blob_fromhex},
+	{"frombase64", &lua_blob_frombase64},
+	{"fromutf16le", &lua_blob_fromutf16le},
+	{NULL, NULL}
+};
+
+const luaL_Reg luablob_compressor_mt___index_funcs[] =
+{
+	{"write", &lua_blob_compressor_write},
+	{"finish", &lua_blob_compressor_finish},
+	{NULL, NULL}
+};
+
+const luaL_Reg luablob_decompressor_mt___index_funcs[] =
+{
+	{"write", &lua_blob_decompressor_write},
+	{NULL, NULL}
+};
+
 
 LUA_MODLOADER_F luaopen_blob(lua_State *L)
 {	//STACK: modname ?
+	int i;
 
 	luaL_newmetatable(L, "luablob_mt");			//STACK: modname ? luablob_mt
 	luaL_setfuncs(L, luablob_mt_funcs, 0);
 	lua_pushliteral(L, "__index");				//STACK: modname ?  luablob_mt '__index'
-	lua_createtable(L, 0, 5);					//STACK: modname ? luablob_mt '__index' {~0}
+	lua_createtable(L, 0, 31);					//STACK: modname ? luablob_mt '__index' {~0}
 	luaL_setfuncs(L, luablob_mt___index_funcs, 0);
 	lua_settable(L, -3);						//STACK: modname ? luablob_mt
 	lua_pop(L, 1);								//STACK: modname ?
 
-	lua_pushcfunction(L, &lua_blob_newblob);	//STACK: modname ? newblob
+	lua_pushliteral(L, "luablob_parentref");	//STACK: modname ? 'luablob_parentref'
+	lua_newtable(L);							//STACK: modname ? 'luablob_parentref' {~1}
+	lua_settable(L, LUA_REGISTRYINDEX);			//STACK: modname ?
+
+	luaL_newmetatable(L, "luablob_plan_mt");	//STACK: modname ? luablob_plan_mt
+	lua_pushliteral(L, "__gc");					//STACK: modname ? luablob_plan_mt '__gc'
+	lua_pushcfunction(L, &lua_luablob_plan_mt___gc);	//STACK: modname ? luablob_plan_mt '__gc' gc
+	lua_settable(L, -3);						//STACK: modname ? luablob_plan_mt
+	lua_pushliteral(L, "__index");				//STACK: modname ? luablob_plan_mt '__index'
+	lua_createtable(L, 0, 2);					//STACK: modname ? luablob_plan_mt '__index' {~2}
+	luaL_setfuncs(L, luablob_plan_mt___index_funcs, 0);
+	lua_settable(L, -3);						//STACK: modname ? luablob_plan_mt
+	lua_pop(L, 1);								//STACK: modname ?
+
+	luaL_newmetatable(L, "luablob_array_mt");	//STACK: modname ? luablob_array_mt
+	luaL_setfuncs(L, luablob_array_mt_funcs, 0);
+	lua_pop(L, 1);								//STACK: modname ?
+
+	luaL_newmetatable(L, "luablob_cursor_mt");	//STACK: modname ? luablob_cursor_mt
+	lua_pushliteral(L, "__gc");					//STACK: modname ? luablob_cursor_mt '__gc'
+	lua_pushcfunction(L, &lua_luablob_cursor_mt___gc);	//STACK: modname ? luablob_cursor_mt '__gc' gc
+	lua_settable(L, -3);						//STACK: modname ? luablob_cursor_mt
+	lua_pushliteral(L, "__index");				//STACK: modname ? luablob_cursor_mt '__index'
+	lua_createtable(L, 0, (LUABLOB_TYPE_BLOB + 4));	//STACK: modname ? luablob_cursor_mt '__index' {~9}
+	luaL_setfuncs(L, luablob_cursor_mt___index_funcs, 0);
+	for (i = 1; i <= LUABLOB_TYPE_BLOB; ++i)
+	{
+		lua_pushinteger(L, i);					//STACK: modname ? luablob_cursor_mt '__index' {~9} typeid
+		lua_pushcclosure(L, &lua_blob_cursor_read, 1);	//STACK: modname ? luablob_cursor_mt '__index' {~9} read
+		lua_setfield(L, -2, luablob_typenames[i]);	//STACK: modname ? luablob_cursor_mt '__index' {~9}
+	}
+	lua_settable(L, -3);						//STACK: modname ? luablob_cursor_mt
+	lua_pop(L, 1);								//STACK: modname ?
+
+	luaL_newmetatable(L, "luablob_bitcursor_mt");	//STACK: modname ? luablob_bitcursor_mt
+	lua_pushliteral(L, "__gc");					//STACK: modname ? luablob_bitcursor_mt '__gc'
+	lua_pushcfunction(L, &lua_luablob_bitcursor_mt___gc);	//STACK: modname ? luablob_bitcursor_mt '__gc' gc
+	lua_settable(L, -3);						//STACK: modname ? luablob_bitcursor_mt
+	lua_pushliteral(L, "__index");				//STACK: modname ? luablob_bitcursor_mt '__index'
+	lua_createtable(L, 0, 7);					//STACK: modname ? luablob_bitcursor_mt '__index' {~10}
+	luaL_setfuncs(L, luablob_bitcursor_mt___index_funcs, 0);
+	lua_settable(L, -3);						//STACK: modname ? luablob_bitcursor_mt
+	lua_pop(L, 1);								//STACK: modname ?
+
+	luaL_newmetatable(L, "luablob_chain_mt");	//STACK: modname ? luablob_chain_mt
+	luaL_setfuncs(L, luablob_chain_mt_funcs, 0);
+	lua_pushliteral(L, "__index");				//STACK: modname ? luablob_chain_mt '__index'
+	lua_createtable(L, 0, 3);					//STACK: modname ? luablob_chain_mt '__index' {~3}
+	luaL_setfuncs(L, luablob_chain_mt___index_funcs, 0);
+	lua_settable(L, -3);						//STACK: modname ? luablob_chain_mt
+	lua_pop(L, 1);								//STACK: modname ?
+
+	luaL_newmetatable(L, "luablob_ring_mt");	//STACK: modname ? luablob_ring_mt
+	luaL_setfuncs(L, luablob_ring_mt_funcs, 0);
+	lua_pushliteral(L, "__index");				//STACK: modname ? luablob_ring_mt '__index'
+	lua_createtable(L, 0, 9);					//STACK: modname ? luablob_ring_mt '__index' {~4}
+	luaL_setfuncs(L, luablob_ring_mt___index_funcs, 0);
+	lua_settable(L, -3);						//STACK: modname ? luablob_ring_mt
+	lua_pop(L, 1);								//STACK: modname ?
+
+	luaL_newmetatable(L, "luablob_compressor_mt");	//STACK: modname ? luablob_compressor_mt
+	lua_pushliteral(L, "__gc");					//STACK: modname ? luablob_compressor_mt '__gc'
+	lua_pushcfunction(L, &lua_luablob_compressor_mt___gc);	//STACK: modname ? luablob_compressor_mt '__gc' gc
+	lua_settable(L, -3);						//STACK: modname ? luablob_compressor_mt
+	lua_pushliteral(L, "__index");				//STACK: modname ? luablob_compressor_mt '__index'
+	lua_createtable(L, 0, 2);					//STACK: modname ? luablob_compressor_mt '__index' {~5}
+	luaL_setfuncs(L, luablob_compressor_mt___index_funcs, 0);
+	lua_settable(L, -3);						//STACK: modname ? luablob_compressor_mt
+	lua_pop(L, 1);								//STACK: modname ?
+
+	luaL_newmetatable(L, "luablob_decompressor_mt");	//STACK: modname ? luablob_decompressor_mt
+	lua_pushliteral(L, "__gc");					//STACK: modname ? luablob_decompressor_mt '__gc'
+	lua_pushcfunction(L, &lua_luablob_decompressor_mt___gc);	//STACK: modname ? luablob_decompressor_mt '__gc' gc
+	lua_settable(L, -3);						//STACK: modname ? luablob_decompressor_mt
+	lua_pushliteral(L, "__index");				//STACK: modname ? luablob_decompressor_mt '__index'
+	lua_createtable(L, 0, 1);					//STACK: modname ? luablob_decompressor_mt '__index' {~6}
+	luaL_setfuncs(L, luablob_decompressor_mt___index_funcs, 0);
+	lua_settable(L, -3);						//STACK: modname ? luablob_decompressor_mt
+	lua_pop(L, 1);								//STACK: modname ?
+
+	//the module table is callable so that 'require("blob-lua")(...)' keeps creating blobs as it always has
+	lua_createtable(L, 0, 16);					//STACK: modname ? {~7}
+	luaL_setfuncs(L, luablob_funcs, 0);
+	lua_createtable(L, 0, 1);					//STACK: modname ? {~7} {~8}
+	lua_pushliteral(L, "__call");				//STACK: modname ? {~7} {~8} '__call'
+	lua_pushcfunction(L, &lua_luablob_mod___call);	//STACK: modname ? {~7} {~8} '__call' call
+	lua_settable(L, -3);						//STACK: modname ? {~7} {~8}
+	lua_setmetatable(L, -2);					//STACK: modname ? {~7}
 
-	return 1;									//RETURN: newblob
-}
\ No newline at end of file
+	return 1;									//RETURN: {~7}
+}
@@ -43,6 +43,8 @@ struct GenericMemoryBlob_s
 
 	void *userdata;
 	void* data;
+
+	int statmode;		//set by luablob_newgmb; blobs built by hand leave it 0 so they are not counted by blob.stats()
 };
 
 LUABLOB_API(void) luablob_newgmb(lua_State *L, GenericMemoryBlob *gmb, size_t initialsize, const char *allocmode);
@@ -50,8 +52,30 @@ LUABLOB_API(void) luablob_pushgmb(lua_State *L, GenericMemoryBlob blob);
 LUABLOB_API(int) luablob_isgmb(lua_State *L, int index);
 LUABLOB_API(GenericMemoryBlob *) luablob_togmb(lua_State *L, int index);
 LUABLOB_API(GenericMemoryBlob *) luablob_checkgmb(lua_State *L, int index);
+LUABLOB_API(size_t) luablob_checksize(lua_State *L, int index);		//a non-negative, addressable offset or size; errors otherwise
+
+struct luablob_ring_s;
+typedef struct luablob_ring_s luablob_ring;
+
+LUABLOB_API(luablob_ring *) luablob_checkring(lua_State *L, int index);
+LUABLOB_API(size_t) luablob_ring_readspan(luablob_ring *ring, void **data);				//contiguous unread bytes at the read position
+LUABLOB_API(size_t) luablob_ring_writespan(luablob_ring *ring, size_t minsize, void **data);	//contiguous free bytes; grows the ring when fewer than minsize are free, returns 0 on allocation failure
+LUABLOB_API(void) luablob_ring_produce(luablob_ring *ring, size_t count);
+LUABLOB_API(void) luablob_ring_consume(luablob_ring *ring, size_t count);
+
+struct luablob_chain_s;
+typedef struct luablob_chain_s luablob_chain;
+
+LUABLOB_API(luablob_chain *) luablob_tochain(lua_State *L, int index);
+LUABLOB_API(luablob_chain *) luablob_checkchain(lua_State *L, int index);
+LUABLOB_API(size_t) luablob_chain_count(luablob_chain *chain);
+LUABLOB_API(size_t) luablob_chain_size(luablob_chain *chain);
+LUABLOB_API(const void *) luablob_chain_segment(lua_State *L, luablob_chain *chain, size_t i, size_t *len);	//errors if the linked blob was freed or shrank
 
 LUABLOB_API(int) gmb_resize(GenericMemoryBlob *blob, size_t nsize, int trim);
+LUABLOB_API(int) gmb_resizeraw(GenericMemoryBlob *blob, size_t nsize, int trim);		//like gmb_resize, but bytes past the old size are left uninitialized for callers that overwrite them all
+LUABLOB_API(int) gmb_unshare(GenericMemoryBlob *blob);
+LUABLOB_API(int) gmb_reserve(GenericMemoryBlob *blob, size_t nsize);
 LUABLOB_API(int) gmb_realloc(GenericMemoryBlob *blob, size_t nsize);
 LUABLOB_API(void) gmb_free(GenericMemoryBlob *blob);
 
@@ -0,0 +1,12 @@
+--Runs every lib-blob behaviour test; an optional argument limits the run to cases whose name contains it.
+--	../bench/blobbench all.lua [filter]
+local testlib = require("testlib")
+
+require("roundtrip")
+require("storage")
+require("errors")
+
+io.write(string.format("%d passed, %d failed\n", testlib.passed, testlib.failed))
+if testlib.failed ~= 0 then
+	error("lib-blob tests failed", 0)
+end
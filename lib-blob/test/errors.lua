@@ -0,0 +1,135 @@
+--Bad arguments and corrupt input must raise a Lua error and leave the blob as it was, never crash or wrap around.
+do
+	local blob = require("blob")
+	local testlib = require("testlib")
+	local case, eq, raises = testlib.case, testlib.eq, testlib.raises
+	local nan, inf = (0 / 0), (1 / 0)
+	
+	case("uvarint range", function()
+		local b = blob.new(16)
+		for _, v in ipairs({ nan, inf, -inf, -1, (2 ^ 64) }) do
+			raises("uvarint values must not be negative", b.write, b, { type = "uvarint", value = v })
+			raises("uvarint values must not be negative", b.writearray, b, "uvarint", 0, { 1, v })
+		end
+		eq(#b, 0, "blob size after rejected uvarints")
+	end)
+	
+	case("svarint range", function()
+		local b = blob.new(16)
+		for _, v in ipairs({ nan, inf, -inf, (2 ^ 63), -(2 ^ 64) }) do
+			raises("svarint values must be from -2^63", b.write, b, { type = "svarint", value = v })
+			raises("svarint values must be from -2^63", b.writearray, b, "svarint", 0, { 1, v })
+		end
+		eq(#b, 0, "blob size after rejected svarints")
+	end)
+	
+	case("truncated varint", function()
+		local b = testlib.blob("\128\128")
+		raises("truncated or malformed varint", b.read, b, { pos = 0, type = "uvarint" })
+	end)
+	
+	case("writearray failure keeps the size", function()
+		local b = testlib.blob("abcd")
+		local ok = pcall(b.writearray, b, "u32", 4, { 1, 2, "x", 4 })
+		eq(ok, false, "non-number element")
+		eq(#b, 4, "blob size")
+		eq(tostring(b), "abcd", "blob contents")
+		
+		--a failure past the first chunk keeps the chunks already written, but nothing after them
+		local t = {}
+		for i = 1, 600 do
+			t[i] = i
+		end
+		t[500] = {}
+		ok = pcall(b.writearray, b, "u16", 4, t)
+		eq(ok, false, "table element")
+		eq(#b, (4 + 256 * 2), "blob size after partial write")
+	end)
+	
+	case("varints into an exactly sized view", function()
+		local parent = testlib.blob(("\0"):rep(16))
+		local v = parent:view(0, 16)
+		local values = {}
+		for i = 1, 16 do
+			values[i] = i
+		end
+		eq(v:writearray("uvarint", 0, values), 16, "bytes written")
+		eq(v:readarray("uvarint", 0, 16)[16], 16, "last value")
+		eq(parent:read({ pos = 15, type = "u8" }), 16, "parent sees the write")
+	end)
+	
+	case("offsets must be addressable", function()
+		local b = testlib.blob("abcdefgh")
+		for _, v in ipairs({ nan, inf, -1, (2 ^ 64) }) do
+			raises("offsets and sizes must be non-negative and addressable", b.read, b, { pos = v, type = "u8" })
+			raises("offsets and sizes must be non-negative and addressable", b.view, b, v, 1)
+		end
+	end)
+	
+	case("ring capacity", function()
+		for _, v in ipairs({ nan, inf, -1, (2 ^ 64) }) do
+			raises("offsets and sizes must be non-negative and addressable", blob.ring, v)
+		end
+		raises("ring capacity must be greater than 0", blob.ring, 0)
+		
+		local r = blob.ring(8)
+		r:write("abc")
+		raises("ring contains only", r.consume, r, 4)
+		raises("offsets and sizes must be non-negative and addressable", r.read, r, nan)
+		eq(tostring(r:read(3)), "abc", "ring contents")
+	end)
+	
+	case("corrupt compressed input", function()
+		--a block header claiming a 2gb compressed length must be rejected before anything is allocated
+		local d = blob.decompressor()
+		raises("unable to decompress data", d.write, d, "LZB\1\1\0\0\0\255\255\255\127")
+		
+		--a compressed length larger than the worst case for its block
+		d = blob.decompressor()
+		raises("unable to decompress data", d.write, d, "LZB\1\1\0\0\0\20\0\0\0")
+		
+		local packed = tostring(testlib.blob(("abcdefgh"):rep(100)):compress())
+		raises("unable to decompress data", function()
+			return testlib.blob(packed:sub(1, (#packed - 3))):decompress()
+		end)
+		
+		raises("compression level must be between", blob.compressor, nan)
+		raises("block size must be between", blob.compressor, 1, 0)
+	end)
+	
+	case("cursor skip distance", function()
+		local c = testlib.blob("abcdefgh"):cursor(0)
+		for _, v in ipairs({ nan, inf, -inf, (2 ^ 64), -(2 ^ 64) }) do
+			raises("skip distances must be addressable", c.skip, c, v)
+		end
+		raises("cannot skip past the end of the blob", c.skip, c, 9)
+		raises("cannot skip back past the start of the blob", c.skip, c, -1)
+		c:skip(3)
+		c:skip(-2)
+		eq(c:remaining(), 7, "remaining after skips")
+	end)
+	
+	case("bit width", function()
+		local b = testlib.blob("abcdefgh")
+		for _, w in ipairs({ nan, 0, 65, 1.5 }) do
+			raises("bit width must be a whole number from 1 to 64", b.readbits, b, 0, w)
+		end
+		eq(b:readbits(0, 8), 97, "first byte")
+	end)
+	
+	case("comparing freed blobs", function()
+		local a = testlib.blob("ab")
+		local b = testlib.blob("ab")
+		eq((a == b), true, "equal contents")
+		
+		a:free()
+		eq((a == a), true, "freed blob equals itself")
+		eq((a == b), false, "freed blob against live blob")
+		eq((b == a), false, "live blob against freed blob")
+		
+		local c = blob.new(4)
+		c:free()
+		eq((a == c), false, "two freed blobs")
+		raises("", function() return (a < b) end)
+	end)
+end
@@ -0,0 +1,139 @@
+--Round trips through the encoders, plans and compressors: whatever goes in must come back out unchanged.
+do
+	local blob = require("blob")
+	local testlib = require("testlib")
+	local case, eq = testlib.case, testlib.eq
+	
+	case("plan round trip", function()
+		local plan = blob.compile("u8", "cstr", "u16", "cstr", "cstr")
+		local b = blob.new(4)
+		local size = plan:write(b, 0, 7, "hello", 513, "", "x\0")
+		eq(size, (1 + 6 + 2 + 1 + 2), "bytes written")
+		
+		local a, s, n, s2, s3 = plan:read(b, 0)
+		eq(a, 7) eq(s, "hello") eq(n, 513) eq(s2, "") eq(s3, "x")
+		
+		--values read back from a plan must write the same bytes again
+		local c = blob.new(4)
+		plan:write(c, 0, plan:read(b, 0))
+		eq(tostring(c), tostring(b), "rewritten plan")
+	end)
+	
+	case("plan cstr rejects embedded nul", function()
+		local plan = blob.compile("cstr")
+		testlib.raises("internal null character", plan.write, plan, blob.new(4), 0, "a\0b")
+	end)
+	
+	case("varint round trip", function()
+		local values = { 0, 1, 127, 128, 300, 16383, 16384, (2 ^ 32), (2 ^ 53) }
+		local b = blob.new(4)
+		for _, v in ipairs(values) do
+			b:clear()
+			b:write(0, { type = "uvarint", value = v })
+			eq(b:read({ pos = 0, type = "uvarint" }), v, "uvarint " .. v)
+			b:write(0, { type = "svarint", value = -v })
+			eq(b:read({ pos = 0, type = "svarint" }), -v, "svarint " .. -v)
+		end
+		
+		b:write(0, { type = "svarint", value = -(2 ^ 63) })
+		eq(b:read({ pos = 0, type = "svarint" }), -(2 ^ 63), "svarint minimum")
+		b:write(0, { type = "uvarint", value = (2 ^ 63) })
+		eq(b:read({ pos = 0, type = "uvarint" }), (2 ^ 63), "uvarint 2^63")
+	end)
+	
+	case("varint array round trip", function()
+		local values = {}
+		for i = 1, 1000 do
+			values[i] = (((i % 2 == 0) and 1 or -1) * i * 1000)
+		end
+		
+		local b = blob.new(4)
+		local size = b:writearray("svarint", 0, values)
+		eq(#b, size, "blob size")
+		
+		local back = b:readarray("svarint", 0, #values)
+		for i = 1, #values do
+			eq(back[i], values[i], "svarint[" .. i .. "]")
+		end
+	end)
+	
+	case("compress round trip", function()
+		local inputs = { "", "a", ("abcdefgh"):rep(500), ("\0"):rep(70000) }
+		local state = 12345
+		local noise = {}
+		for i = 1, 4096 do
+			state = ((state * 1103515245 + 12345) % 2147483648)
+			noise[i] = string.char(state % 256)
+		end
+		inputs[#inputs + 1] = table.concat(noise)
+		
+		for _, s in ipairs(inputs) do
+			local packed = testlib.blob(s):compress()
+			eq(testlib.str(packed:decompress()), s, "compress of " .. #s .. " bytes")
+		end
+	end)
+	
+	case("compressor frames round trip", function()
+		local data = ("abcdefgh"):rep(500) .. ("xyz"):rep(1000)
+		local c = blob.compressor(1, 1000)
+		local out = {}
+		for i = 1, #data, 777 do
+			out[#out + 1] = testlib.str(c:write(data:sub(i, (i + 776))))
+		end
+		out[#out + 1] = testlib.str(c:finish())
+		
+		--feed the frames back a few bytes at a time so blocks straddle writes
+		local framed = table.concat(out)
+		local d = blob.decompressor()
+		local back = {}
+		for i = 1, #framed, 5 do
+			back[#back + 1] = testlib.str(d:write(framed:sub(i, (i + 4))))
+		end
+		eq(table.concat(back), data, "decompressed frames")
+	end)
+	
+	case("hex and base64 round trip", function()
+		eq(tostring(testlib.blob("hi"):tohex()), "6869")
+		eq(tostring(blob.fromhex("6869")), "hi")
+		eq(tostring(testlib.blob("hi"):tobase64()), "aGk=")
+		eq(tostring(blob.frombase64("aGk=")), "hi")
+		
+		local all = {}
+		for i = 0, 255 do
+			all[#all + 1] = string.char(i)
+		end
+		all = table.concat(all)
+		
+		for len = 0, 7 do
+			local s = all:sub(1, (250 + len))
+			local b = testlib.blob(s)
+			eq(testlib.str(blob.fromhex(testlib.str(b:tohex()))), s, "hex of " .. #s .. " bytes")
+			eq(testlib.str(blob.frombase64(testlib.str(b:tobase64()))), s, "base64 of " .. #s .. " bytes")
+		end
+	end)
+	
+	case("utf8 and utf16 round trip", function()
+		local s = "ascii \xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80 end"
+		local u = testlib.blob(s)
+		eq(u:isutf8(), true, "valid utf8")
+		
+		local w = u:utf16le()
+		eq(tostring(blob.fromutf16le(w)), s, "utf16le round trip")
+		
+		local ok, at = testlib.blob("ab\xC3"):isutf8()
+		eq(ok, false, "truncated sequence")
+		eq((at ~= nil), true, "error offset")
+		eq(testlib.blob("\xED\xA0\x80"):isutf8(), false, "encoded surrogate")
+	end)
+	
+	case("integer text round trip", function()
+		local b = blob.new(32)
+		for _, v in ipairs({ 0, 1, -1, 1234, -98765, (2 ^ 53) }) do
+			b:clear()
+			local len = b:writeint(0, v)
+			local back, used = b:parseint(0)
+			eq(back, v, "parseint")
+			eq(used, len, "parseint length")
+		end
+	end)
+end
@@ -0,0 +1,81 @@
+--Copy-on-write sharing, views and mapped files: a write through one handle must never show up through another.
+do
+	local blob = require("blob")
+	local testlib = require("testlib")
+	local case, eq = testlib.case, testlib.eq
+	
+	case("clone is copy on write", function()
+		local a = testlib.blob(("a"):rep(300))
+		local b = a:clone()
+		a:write(0, "b")
+		eq(tostring(a), "b", "written blob")
+		eq(tostring(b), ("a"):rep(300), "clone")
+		
+		b:write(0, "c")
+		eq(tostring(a), "b", "original after clone write")
+	end)
+	
+	case("unshare keeps the allocation mode", function()
+		for _, mode in ipairs({ "pool", "hugepage", "aligned", "tight" }) do
+			collectgarbage()
+			collectgarbage()
+			
+			local b = testlib.blob(("m"):rep(300), mode)
+			local c = b:clone()
+			local before = blob.stats().modes[mode].live
+			b:write(0, "x")
+			local after = blob.stats().modes[mode].live
+			eq((after > before), true, mode .. " copy counted in its mode")
+			eq(b:read({ pos = 0, type = "u8" }), 120, mode .. " written blob")
+			eq(c:read({ pos = 0, type = "u8" }), 109, mode .. " clone")
+			
+			b = nil
+			c = nil
+			collectgarbage()
+			collectgarbage()
+			eq(blob.stats().modes[mode].live, 0, mode .. " live bytes after collection")
+		end
+	end)
+	
+	case("copying a blob keeps the destination mode", function()
+		collectgarbage()
+		collectgarbage()
+		local before = blob.stats().modes.aligned.live
+		local a = blob.new(512, "aligned")
+		a:write({ pos = 0, type = "blob", value = testlib.blob(("q"):rep(300)) })
+		eq((blob.stats().modes.aligned.live >= (before + 300)), true, "aligned live bytes")
+		eq(tostring(a), ("q"):rep(300), "copied contents")
+	end)
+	
+	case("view copied into its parent", function()
+		local b = testlib.blob("0123456789")
+		local v = b:view(2, 4)
+		b:write({ pos = 5, type = "blob", value = v })
+		eq(tostring(b), "012342345", "overlapping copy")
+		eq(tostring(v), "2342", "view after copy")
+	end)
+	
+	case("mapped file clone", function()
+		local path = os.tmpname()
+		local f = assert(io.open(path, "wb"))
+		f:write(("\0"):rep(64))
+		f:close()
+		
+		local m = blob.mapfile(path, "rw")
+		local c = m:clone()
+		m:write(0, "hello")
+		eq(c:read({ pos = 0, type = "u8" }), 0, "clone of mapped file")
+		c:write(0, "zz")
+		
+		m = nil
+		c = nil
+		collectgarbage()
+		collectgarbage()
+		
+		f = assert(io.open(path, "rb"))
+		local data = f:read("*a")
+		f:close()
+		os.remove(path)
+		eq(data:sub(1, 5), "hello", "file contents")
+	end)
+end
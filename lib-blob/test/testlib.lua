@@ -0,0 +1,58 @@
+--Shared harness for the lib-blob behaviour tests; run them through the blobbench host in ../bench, which preloads 'blob'.
+--Each case that fails prints its name and traceback; all.lua raises once every file has run, so the host exits non-zero.
+do
+	local testlib =
+	{
+		passed = 0,
+		failed = 0,
+		filter = (arg and arg[1]) or nil	--only run cases whose name contains this
+	}
+	
+	function testlib.case(name, fn)
+		if testlib.filter ~= nil and not string.find(name, testlib.filter, 1, true) then
+			return
+		end
+		
+		local ok, err = xpcall(fn, debug.traceback)
+		if ok then
+			testlib.passed = (testlib.passed + 1)
+		else
+			testlib.failed = (testlib.failed + 1)
+			io.write("FAIL ", name, "\n", tostring(err), "\n")
+		end
+	end
+	
+	function testlib.eq(actual, expected, what)
+		if actual ~= expected then
+			error(string.format("%s: expected %s, got %s", (what or "value"), tostring(expected), tostring(actual)), 2)
+		end
+	end
+	
+	--Calls fn(...) and checks that it raises an error whose message contains text.
+	function testlib.raises(text, fn, ...)
+		local ok, err = pcall(fn, ...)
+		if ok then
+			error(string.format("expected an error containing '%s'", text), 2)
+		end
+		if not string.find(tostring(err), text, 1, true) then
+			error(string.format("expected an error containing '%s', got: %s", text, tostring(err)), 2)
+		end
+	end
+	
+	--Builds a blob holding exactly the bytes of s.
+	function testlib.blob(s, allocmode)
+		local b = ((allocmode == nil) and require("blob").new(#s + 1) or require("blob").new((#s + 1), allocmode))
+		b:write(s)
+		return b
+	end
+	
+	--Returns the contents of b as a string; tostring gives a placeholder for empty blobs.
+	function testlib.str(b)
+		if #b == 0 then
+			return ""
+		end
+		return tostring(b)
+	end
+	
+	return testlib
+end
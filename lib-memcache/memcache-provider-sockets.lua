@@ -53,6 +53,82 @@ do
 		return proto_text_parseresult(tostring(result), expected)
 	end
 	
+	function proto_text_isdigit(byte)
+		return (byte >= 48) and (byte <= 57)
+	end
+	
+	function proto_text_isspace(byte)
+		-- the same set as the %s pattern class
+		return (byte == 32) or ((byte >= 9) and (byte <= 13))
+	end
+	
+	function proto_text_parsenum(data, pos, last)
+		-- an unsigned decimal that a single space or the end of the line must follow; returns its value and length
+		-- parseint would also take a sign, so the first character must already be a digit
+		if (pos >= last) or not proto_text_isdigit(data:read({ type = "u8", pos = pos })) then
+			return nil
+		end
+		local value, len = data:parseint(pos)
+		if (value == nil) or ((pos + len) > last) then
+			return nil
+		end
+		if ((pos + len) < last) and (data:read({ type = "u8", pos = (pos + len) }) ~= 32) then
+			return nil
+		end
+		
+		return value, len
+	end
+	
+	function proto_text_parsevalue(data, gets)
+		-- parses "VALUE <key> <flags> <bytes> [<cas unique>]\r\n" in place rather than through a string copy of the whole line;
+		-- flags and the cas unique are still handed back as strings since a cas unique does not fit in a lua number
+		local last = (#data - 2)
+		if (last <= 6) or (data:read({ type = "str", pos = 0, len = 6 }) ~= "VALUE ") or (data:read({ type = "str", pos = last, len = 2 }) ~= "\r\n") then
+			return nil
+		end
+		
+		local keyend = data:findbyte(32, 6)
+		if (keyend == nil) or (keyend == 6) or (keyend >= last) then
+			return nil
+		end
+		
+		local key = data:read({ type = "str", pos = 6, len = (keyend - 6) })
+		if key:match("[%c%s]") then
+			return nil
+		end
+		
+		local result = { }
+		local pos = (keyend + 1)
+		local value, len = proto_text_parsenum(data, pos, last)
+		if not value then
+			return nil
+		end
+		result.flags = data:read({ type = "str", pos = pos, len = len })
+		pos = (pos + len + 1)
+		
+		local size
+		size, len = proto_text_parsenum(data, pos, last)
+		if not size then
+			return nil
+		end
+		pos = (pos + len)
+		
+		if gets then
+			pos = (pos + 1)
+			value, len = proto_text_parsenum(data, pos, last)
+			if not value then
+				return nil
+			end
+			result.unqiue = data:read({ type = "str", pos = pos, len = len })
+			pos = (pos + len)
+		end
+		if pos ~= last then
+			return nil
+		end
+		
+		return key, result, size
+	end
+	
 	function proto_text_clean(val)
 		if type(val) == "number" then
 			return tostring(val)
@@ -132,20 +208,13 @@ do
 				break
 			end
 			
-			data = tostring(data)
-			if data:match("^END\r\n$") then
+			if (#data == 5) and (tostring(data) == "END\r\n") then
 				break
 			end
 			
-			result = { }
-			if gets then
-				key, result.flags, size, result.unqiue = data:match("^VALUE ([^%c%s]+) (%d+) (%d+) (%d+)\r\n$")
-			else
-				key, result.flags, size = data:match("^VALUE ([^%c%s]+) (%d+) (%d+)\r\n$")
-			end
-			
+			key, result, size = proto_text_parsevalue(data, gets)
 			if key then
-				alive, result.value = cache.net.recv(cache, tonumber(size))
+				alive, result.value = cache.net.recv(cache, size)
 				if not result.value then
 					break
 				end
@@ -156,7 +225,7 @@ do
 				
 				results[key] = result
 			else
-				results.error = proto_text_parseresult(data, nil)
+				results.error = proto_text_parseresult(tostring(data), nil)
 				break
 			end
 			
@@ -220,6 +289,8 @@ do
 			local alive
 			local result
 			local value
+			local size
+			local pos
 		
 			key = proto_text_clean(key)
 			if type(amount) ~= "number" then
@@ -238,12 +309,18 @@ do
 				if not result then
 					return nil
 				end
-				result = tostring(result)
-				value = result:match("%s*(%d+)%s*\r\n")
-				if value then
-					return tonumber(value)
+				-- the new value is parsed in place; servers that rewrite it in place may pad it with spaces
+				pos = 0
+				while (pos < #result) and proto_text_isspace(result:read({ type = "u8", pos = pos })) do
+					pos = (pos + 1)
+				end
+				if (pos < #result) and proto_text_isdigit(result:read({ type = "u8", pos = pos })) then
+					value, size = result:parseint(pos)
+				end
+				if value and result:read({ type = "str", pos = (pos + size), len = (#result - pos - size) }):match("^%s*\r\n$") then
+					return value
 				else
-					return proto_text_parseresult(result, nil)
+					return proto_text_parseresult(tostring(result), nil)
 				end
 			end
 		end,
@@ -270,6 +347,7 @@ do
 			cache.connected = false
 			pcall(cache.socket.close, cache.socket)
 			cache.socket = nil
+			cache.tcpstream = nil
 		end
 	end
 	
@@ -291,37 +369,41 @@ do
 		end,
 		recv = function(cache, size)
 			checkconnected(cache)
-		
+			
+			if cache.tcpstream == nil then
+				cache.tcpstream = newblob.ring(4096)
+			end
+			local stream = cache.tcpstream
+			
 			if size == -1 then	--read a line
-				local buffer = newblob("loose")
-				local alive
-				local data
+				local searchstart = 0
+				local matchstart = stream:find("\n")
 				
-				while true do
-					alive, data = cache.socket:receive(1)
-					buffer:write(#buffer, { type = "blob", value = data })
-					
-					if tostring(data) == "\n" then
-						data:free()
-						return true, buffer
-					else
-						data:free()
-					end
-					
-					if not alive then
+				while matchstart == nil do
+					searchstart = #stream
+					if stream:writefrom(cache.socket) == 0 then
 						closesocket(cache)
-						return false, buffer
+						return false, stream:read()
 					end
+					matchstart = stream:find("\n", searchstart)
 				end
+				size = (matchstart + 1)
 			else
-				return cache.socket:receive(size)
+				while #stream < size do
+					if stream:writefrom(cache.socket, (size - #stream)) == 0 then
+						closesocket(cache)
+						return false, stream:read()
+					end
+				end
 			end
+			
+			return true, stream:read(size)
 		end,
 		close = closesocket
 	}
 	
 	local net_udp_send_header = newblob(6, "tight")
-	net_udp_send_header:write(net.tonet(0, "us"), net.tonet(1, "us"), net.tonet(0, "us"))
+	net_udp_send_header:write({ type = "u16be", value = 0 }, { type = "u16be", value = 1 }, { type = "u16be", value = 0 })
 	
 	local function freeblobs(tbl)
 		for k, v in pairs(tbl) do
@@ -356,12 +438,9 @@ do
 			]]
 			hasdata, data = cache.socket:receive(65527, true)
 			if hasdata then
-				reqid, seqnum, dataexdgrams = data:read({ type = "str", len = 2 }, { type = "str", len = 2 }, { type = "str", len = 2 })
-				
-				if net.fromnet(reqid, true) == cache.curreq then
-					seqnum = net.fromnet(seqnum, true)
-					dataexdgrams = net.fromnet(dataexdgrams, true)
+				reqid, seqnum, dataexdgrams = data:read("u16be", "u16be", "u16be")
 				
+				if reqid == cache.curreq then
 					if exdgrams == -1 then
 						exdgrams = dataexdgrams
 						if exdgrams == 0 then
@@ -389,11 +468,9 @@ do
 					
 					--check to see if assembly is complete, we can do this with the # operator as it will stop counting at the first gap
 					if #datagrams == exdgrams then
-						local writeops = { }
 						for i = 1, exdgrams do
-							writeops[i] = { type = "blob", value = datagrams[i], start = 8 }
+							cache.udpstream:write(datagrams[i], 8)
 						end
-						cache.udpstream:write(table.unpack(writeops))
 						freeblobs(datagrams)
 						return true
 					end
@@ -408,7 +485,7 @@ do
 			checkconnected(cache)
 		
 			local buffer = newblob()
-			buffer:write(net.tonet(cache.reqnum, "us"), { type = "blob", value = net_udp_send_header }, ...)
+			buffer:write({ type = "u16be", value = cache.reqnum }, { type = "blob", value = net_udp_send_header }, ...)
 			
 			--[[
 				the memcache protocol requires that a request fit into a single datagram
@@ -431,59 +508,35 @@ do
 		end,
 		recv = function(cache, size)
 			if cache.udpstream == nil then
-				cache.udpstream = newblob("loose")
-				cache.streamempty = true
+				cache.udpstream = newblob.ring(65536)
 			end
+			local stream = cache.udpstream
 			
 			if size == -1 then
-				local searchstart = 1
-				local matchstart
+				local searchstart = 0
+				local matchstart = stream:find("\n")
 			
-				while true do
-					if not cache.streamempty then
-						--size is the offset of the \n from the end of the stream, which is the size of the line
-						matchstart, size = tostring(cache.udpstream):find("\n", searchstart, true)
-					end
-					if cache.streamempty or matchstart == nil then
-						searchstart = #cache.udpstream
-						if recvudpmessage(cache) then
-							cache.streamempty = false
-						else
-							--the entire stream is bad now :(
-							cache.streamempty = true
-							cache.udpstream:resize(1, false)	
-							return true, nil
-						end
-					else
-						break
+				while matchstart == nil do
+					searchstart = #stream
+					if not recvudpmessage(cache) then
+						--the entire stream is bad now :(
+						stream:clear()
+						return true, nil
 					end
+					matchstart = stream:find("\n", searchstart)
 				end
+				size = (matchstart + 1)
 			else
-				while cache.streamempty or #cache.udpstream < size do
-					if recvudpmessage(cache) then
-						cache.streamempty = false
-					else
+				while #stream < size do
+					if not recvudpmessage(cache) then
 						--the entire stream is bad now :(
-						cache.streamempty = true
-						cache.udpstream:resize(1, false)	
+						stream:clear()
 						return true, nil
 					end
 				end
 			end
 			
-			local result = newblob(size, "tight")
-			result:write({ type = "blob", value = cache.udpstream, count = size })
-			
-			--this is very inefficient, but it is a quick and dirty way of ensuring that the size of the cached stream does not grow indefinately
-			cache.udpstream:write({ type = blob, value = cache.udpstream, start = size })
-			if #cache.udpstream == size then
-				cache.streamempty = true
-				cache.udpstream:resize(1, false)
-			else
-				cache.udpstream:resize((#cache.udpstream  - size), false)
-			end
-			
-			return true, result
+			return true, stream:read(size)
 		end,
 		close = closesocket
 	}
@@ -18,6 +18,7 @@
 
 #include <lauxlib.h>
 #include <math.h>
+#include <limits.h>
 
 //This avoids the complaints of some compliers when performing pointer addition
 #define ptradd(p, o) ((void *)(((char *)(p)) + (o)))
@@ -46,6 +47,7 @@ void luaerrorec(lua_State *L, int ec)
 # include <netinet/in.h>
 # include <netdb.h>
 # include <unistd.h>
+# include <sys/uio.h>
 
 //definitions to match cross platform api
 # define sockerr errno
@@ -740,17 +742,24 @@ LUA_CFUNCTION_F lua_sockets_accept(lua_State *L)
 	return 2;													//RETURN: remoteud ep
 }
 
-void lua_sockets_send_gmb(lua_State *L, SOCKET sock, struct sockaddr_storage *dest, int flags, GenericMemoryBlob *msggmb, int start, int count)
+#define LUASOCKETS_MAXIO INT_MAX	//send and recv take int lengths on Windows, so large blobs go through in pieces of at most this size
+
+void lua_sockets_send_gmb(lua_State *L, SOCKET sock, struct sockaddr_storage *dest, int flags, GenericMemoryBlob *msggmb, size_t start, size_t count)
 {
 	int sent;
-	int totalsent = 0;
+	int chunk;
+	size_t totalsent = 0;
 	const char *datastart;
 
-	if (count < 0)
+	if (start > msggmb->usedsize)
+	{
+		luaL_error(L, "access to luablob was out of bounds");
+	}
+	if (count == ((size_t)-1))
 	{
 		count = (msggmb->usedsize - start);
 	}
-	if (start < 0 || ((unsigned int)(count + start)) > msggmb->usedsize)
+	if (count > (msggmb->usedsize - start))
 	{
 		luaL_error(L, "access to luablob was out of bounds");
 	}
@@ -760,13 +769,14 @@ void lua_sockets_send_gmb(lua_State *L, SOCKET sock, struct sockaddr_storage *de
 		datastart = (const char *)ptradd(msggmb->data, start);
 		do
 		{
+			chunk = (((count - totalsent) > LUASOCKETS_MAXIO) ? LUASOCKETS_MAXIO : (int)(count - totalsent));
 			if (dest == NULL)
 			{
-				sent = send(sock, (datastart + totalsent), (count - totalsent), flags);
+				sent = send(sock, (datastart + totalsent), chunk, flags);
 			}
 			else
 			{
-				sent = sendto(sock, (datastart + totalsent), (count - totalsent), flags, (const struct sockaddr *)dest, sizeof(struct sockaddr_storage));
+				sent = sendto(sock, (datastart + totalsent), chunk, flags, (const struct sockaddr *)dest, sizeof(struct sockaddr_storage));
 			}
 			if (sent <= 0)
 			{
@@ -776,11 +786,117 @@ void lua_sockets_send_gmb(lua_State *L, SOCKET sock, struct sockaddr_storage *de
 		} while(totalsent < count);
 	}
 }
+#define LUASOCKETS_CHAIN_BATCH 64	//segments handed to a single writev-style call
+
+//Sends every segment of a blob chain with gather writes, so the segments are never copied into one buffer.
+void lua_sockets_send_chain(lua_State *L, SOCKET sock, struct sockaddr_storage *dest, int flags, luablob_chain *chain)
+{
+#ifdef _WIN32
+	WSABUF bufs[LUASOCKETS_CHAIN_BATCH];
+	DWORD sent;
+#else
+	struct iovec bufs[LUASOCKETS_CHAIN_BATCH];
+	struct msghdr msg;
+	ssize_t sent;
+#endif
+	size_t count;
+	size_t seg;
+	size_t segoffset;
+	size_t nbufs;
+	size_t len;
+	size_t i;
+	const char *data;
+
+	count = luablob_chain_count(chain);
+	seg = 0;
+	segoffset = 0;
+	while (seg < count)
+	{
+		nbufs = 0;
+		for (i = seg; i < count && nbufs < LUASOCKETS_CHAIN_BATCH; ++i)
+		{
+			data = (const char *)luablob_chain_segment(L, chain, i, &len);
+			if (i == seg)
+			{
+				data += segoffset;
+				len -= segoffset;
+			}
+			if (len == 0)
+			{
+				continue;
+			}
+#ifdef _WIN32
+			bufs[nbufs].buf = (char *)data;
+			bufs[nbufs].len = (ULONG)len;
+#else
+			bufs[nbufs].iov_base = (void *)data;
+			bufs[nbufs].iov_len = len;
+#endif
+			++nbufs;
+		}
+		if (nbufs == 0)
+		{
+			break;
+		}
+
+#ifdef _WIN32
+		if (dest == NULL)
+		{
+			if (WSASend(sock, bufs, (DWORD)nbufs, &sent, (DWORD)flags, NULL, NULL) != 0)
+			{
+				luaerrorec(L, sockerr);
+			}
+		}
+		else
+		{
+			if (WSASendTo(sock, bufs, (DWORD)nbufs, &sent, (DWORD)flags, (const struct sockaddr *)dest, sizeof(struct sockaddr_storage), NULL, NULL) != 0)
+			{
+				luaerrorec(L, sockerr);
+			}
+		}
+#else
+		memset(&msg, 0, sizeof(struct msghdr));
+		msg.msg_iov = bufs;
+		msg.msg_iovlen = nbufs;
+		if (dest != NULL)
+		{
+			msg.msg_name = dest;
+			msg.msg_namelen = sizeof(struct sockaddr_storage);
+		}
+		sent = sendmsg(sock, &msg, flags);
+		if (sent <= 0)
+		{
+			luaerrorec(L, sockerr);
+		}
+#endif
+
+		//advance past whatever the stack accepted; a short write resumes inside the segment it stopped in
+		len = (size_t)sent;
+		while (len > 0 && seg < count)
+		{
+			luablob_chain_segment(L, chain, seg, &i);
+			i -= segoffset;
+			if (len < i)
+			{
+				segoffset += len;
+				len = 0;
+			}
+			else
+			{
+				len -= i;
+				++seg;
+				segoffset = 0;
+			}
+		}
+	}
+}
+
 void lua_sockets_send_table(lua_State *L, SOCKET sock, struct sockaddr_storage *dest, int flags)
 {	//STACK: ? tbl
 	int i;
-	int udstart = 0;
-	int udcount = -1;
+	size_t udstart = 0;
+	size_t udcount = ((size_t)-1);
+	lua_Number n;
 	int count = luaL_len(L, -1);
 
 	for (i = 1; i <= count; ++i)
@@ -790,7 +906,14 @@ void lua_sockets_send_table(lua_State *L, SOCKET sock, struct sockaddr_storage *
 		switch(lua_type(L, -1))
 		{
 			case LUA_TUSERDATA:
-				lua_sockets_send_gmb(L, sock, dest, flags, luablob_checkgmb(L, -1), 0, -1);
+				if (luablob_tochain(L, -1) != NULL)
+				{
+					lua_sockets_send_chain(L, sock, dest, flags, luablob_tochain(L, -1));
+				}
+				else
+				{
+					lua_sockets_send_gmb(L, sock, dest, flags, luablob_checkgmb(L, -1), 0, ((size_t)-1));
+				}
 				lua_pop(L, 1);
 				break;
 			case LUA_TTABLE:
@@ -807,11 +930,12 @@ void lua_sockets_send_table(lua_State *L, SOCKET sock, struct sockaddr_storage *
 						switch(lua_type(L, -1))
 						{
 							case LUA_TNUMBER:
-								udstart = lua_tointeger(L, -1);
-								if (udstart < 0)
+								n = lua_tonumber(L, -1);
+								if (!(n >= 0) || n >= (lua_Number)((size_t)-1))
 								{
 									luaL_error(L, "invalid count; expected a positive integer size");
 								}
+								udstart = (size_t)n;
 								break;
 							case LUA_TNIL:
 								break;
@@ -825,11 +949,12 @@ void lua_sockets_send_table(lua_State *L, SOCKET sock, struct sockaddr_storage *
 						switch(lua_type(L, -1))
 						{
 							case LUA_TNUMBER:
-								udcount = lua_tointeger(L, -1);
-								if (udcount <= 0)
+								n = lua_tonumber(L, -1);
+								if (!(n >= 1) || n >= (lua_Number)((size_t)-1))
 								{
 									luaL_error(L, "invalid count; expected a positive integer size");
 								}
+								udcount = (size_t)n;
 								break;
 							case LUA_TNIL:
 								break;
@@ -877,10 +1002,17 @@ LUA_CFUNCTION_F lua_sockets_send(lua_State *L)
 			
 			break;
 		case LUA_TUSERDATA:
-			lua_sockets_send_gmb(L, sock, NULL, flags, luablob_checkgmb(L, 2), 0, -1);
+			if (luablob_tochain(L, 2) != NULL)
+			{
+				lua_sockets_send_chain(L, sock, NULL, flags, luablob_tochain(L, 2));
+			}
+			else
+			{
+				lua_sockets_send_gmb(L, sock, NULL, flags, luablob_checkgmb(L, 2), 0, ((size_t)-1));
+			}
 			break;
 		default:
-			luaL_error(L, "invalid message; expected a table or luablob");
+			luaL_error(L, "invalid message; expected a table, luablob or luablob chain");
 	}
 
 	return 0;
@@ -901,42 +1033,61 @@ LUA_CFUNCTION_F lua_sockets_sendto(lua_State *L)
 			lua_sockets_send_table(L, sock, dest->addr, 0);
 			break;
 		case LUA_TUSERDATA:
-			lua_sockets_send_gmb(L, sock, dest->addr, 0, luablob_checkgmb(L, 2), 0, -1);
+			if (luablob_tochain(L, 2) != NULL)
+			{
+				lua_sockets_send_chain(L, sock, dest->addr, 0, luablob_tochain(L, 2));
+			}
+			else
+			{
+				lua_sockets_send_gmb(L, sock, dest->addr, 0, luablob_checkgmb(L, 2), 0, ((size_t)-1));
+			}
 			break;
 		default:
-			luaL_error(L, "invalid message; expected a table or luablob");
+			luaL_error(L, "invalid message; expected a table, luablob or luablob chain");
 	}
 
 	return 0;
 }
 
-int lua_sockets_recv_gmbdata(lua_State *L, SOCKET sock, struct sockaddr_storage *src, int flags, GenericMemoryBlob *gmbresult, int start, int count, int complete)
+int lua_sockets_recv_gmbdata(lua_State *L, SOCKET sock, struct sockaddr_storage *src, int flags, GenericMemoryBlob *gmbresult, size_t start, size_t count, int complete)
 {	//STACK: ?
 	char *datastart;
 	int read;
-	int totalread = 0;
+	int chunk;
+	size_t totalread = 0;
 	size_t gmbsz;
 	int fromlen = sizeof(struct sockaddr_storage);
 
-	if (start < 0 || ((unsigned int)start) > gmbresult->usedsize)
+	if (start > gmbresult->usedsize)
 	{
 		luaL_error(L, "access to luablob was out of bounds");
 	}
-	if (count == -1)
+	if (gmb_unshare(gmbresult) == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
+	if (count == ((size_t)-1))
 	{
 		count = (gmbresult->usedsize - start);
 	}
 	else
 	{
-		if (count <= 0)
+		if (count == 0)
 		{
 			luaL_error(L, "count to read must be greater than 0");
 		}
-		gmbsz = (size_t)(start + count);
+		if (count > (((size_t)-1) - start))
+		{
+			luaL_error(L, "access to luablob was out of bounds");
+		}
+		gmbsz = (start + count);
 
 		if (gmbsz > gmbresult->usedsize)
 		{
-			gmb_resize(gmbresult, gmbsz, 0);
+			if (gmb_resizeraw(gmbresult, gmbsz, 0) == 0)
+			{
+				luaL_error(L, "failed to allocate blob memory");
+			}
 		}
 	}
 	
@@ -945,13 +1096,14 @@ int lua_sockets_recv_gmbdata(lua_State *L, SOCKET sock, struct sockaddr_storage
 	{
 		do
 		{
+			chunk = (((count - totalread) > LUASOCKETS_MAXIO) ? LUASOCKETS_MAXIO : (int)(count - totalread));
 			if (src == NULL)
 			{
-				read = recv(sock, (datastart + totalread), (count - totalread), flags);
+				read = recv(sock, (datastart + totalread), chunk, flags);
 			}
 			else
 			{
-				read = recvfrom(sock, (datastart + totalread), (count - totalread), flags, (struct sockaddr *)src, &fromlen);
+				read = recvfrom(sock, (datastart + totalread), chunk, flags, (struct sockaddr *)src, &fromlen);
 			}
 			if (read < 0)
 			{
@@ -971,13 +1123,14 @@ int lua_sockets_recv_gmbdata(lua_State *L, SOCKET sock, struct sockaddr_storage
 	}
 	else
 	{
+		chunk = ((count > LUASOCKETS_MAXIO) ? LUASOCKETS_MAXIO : (int)count);
 		if (src == NULL)
 		{
-			read = recv(sock, datastart, count, flags);
+			read = recv(sock, datastart, chunk, flags);
 		}
 		else
 		{
-			read = recvfrom(sock, datastart, count, flags, (struct sockaddr *)src, &fromlen);
+			read = recvfrom(sock, datastart, chunk, flags, (struct sockaddr *)src, &fromlen);
 		}
 		if (read < 0)
 		{
@@ -991,7 +1144,7 @@ int lua_sockets_recv_gmbdata(lua_State *L, SOCKET sock, struct sockaddr_storage
 			lua_pushnil(L);										//STACK: ? false nil
 			return 2;											//RETURN: false nil
 		}
-		else if (read < count)
+		else if ((size_t)read < count)
 		{
 			gmb_resize(gmbresult, (size_t)read, 1);
 		}
@@ -1006,12 +1159,13 @@ int lua_sockets_recv_generic(lua_State *L, int recvfrom)
 {	//STACK: sock count|blob|tblinfo partial? oob? ?
 	SOCKET sock;
 	int flags = 0;
-	int start = 0;
-	int count = -1;
+	size_t start = 0;
+	size_t count = ((size_t)-1);
+	lua_Number n;
 	int rescount;
 	int complete = 1;
 	GenericMemoryBlob gmbresult;
-	struct lua_sockaddr_info *src;
+	struct lua_sockaddr_info *src = NULL;
 	void *allocud = NULL;
 
 	sock = *((SOCKET *)luaL_checkudata(L, 1, "luasockets_socket_mt"));
@@ -1043,8 +1197,13 @@ int lua_sockets_recv_generic(lua_State *L, int recvfrom)
 	switch(lua_type(L, 2))
 	{
 		case LUA_TNUMBER:
-			count = lua_tointeger(L, 2);
-			luablob_newgmb(L, &gmbresult, (size_t)count, "tight");
+			n = lua_tonumber(L, 2);
+			if (!(n >= 1) || n >= (lua_Number)((size_t)-1))
+			{
+				luaL_error(L, "count to read must be greater than 0");
+			}
+			count = (size_t)n;
+			luablob_newgmb(L, &gmbresult, count, "tight");
 			if (recvfrom)
 			{
 				rescount = lua_sockets_recv_gmbdata(L, sock, src->addr, flags, &gmbresult, 0, count, complete);	//STACK: sock count ? src? [rescount]	
@@ -1060,11 +1219,12 @@ int lua_sockets_recv_generic(lua_State *L, int recvfrom)
 			switch(lua_type(L, -1))
 			{
 				case LUA_TNUMBER:
-					start = lua_tointeger(L, -1);
-					if (start < 0)
+					n = lua_tonumber(L, -1);
+					if (!(n >= 0) || n >= (lua_Number)((size_t)-1))
 					{
 						luaL_error(L, "invalid buffer start offset; expected a non-negative integer offset");
 					}
+					start = (size_t)n;
 					break;
 				case LUA_TNIL:
 					break;
@@ -1078,11 +1238,12 @@ int lua_sockets_recv_generic(lua_State *L, int recvfrom)
 			switch(lua_type(L, -1))
 			{
 				case LUA_TNUMBER:
-					count = lua_tointeger(L, -1);
-					if (count <= 0)
+					n = lua_tonumber(L, -1);
+					if (!(n >= 1) || n >= (lua_Number)((size_t)-1))
 					{
 						luaL_error(L, "invalid buffer count; expected a positive integer size");
 					}
+					count = (size_t)n;
 					break;
 				case LUA_TNIL:
 					break;
@@ -1105,11 +1266,11 @@ int lua_sockets_recv_generic(lua_State *L, int recvfrom)
 		case LUA_TUSERDATA:
 			if (recvfrom)
 			{
-				rescount = lua_sockets_recv_gmbdata(L, sock, src->addr, flags, luablob_checkgmb(L, 2), 0, -1, complete);			//STACK: sock count ? src? [rescount]
+				rescount = lua_sockets_recv_gmbdata(L, sock, src->addr, flags, luablob_checkgmb(L, 2), 0, ((size_t)-1), complete);			//STACK: sock count ? src? [rescount]
 			}
 			else
 			{
-				rescount = lua_sockets_recv_gmbdata(L, sock, NULL, flags, luablob_checkgmb(L, 2), 0, -1, complete);					//STACK: sock count oob? ? src? [rescount]
+				rescount = lua_sockets_recv_gmbdata(L, sock, NULL, flags, luablob_checkgmb(L, 2), 0, ((size_t)-1), complete);					//STACK: sock count oob? ? src? [rescount]
 			}
 			break;
 		default:
@@ -1134,6 +1295,105 @@ LUA_CFUNCTION_F lua_sockets_recvfrom(lua_State *L)
 	return lua_sockets_recv_generic(L, 1 /* true */);
 }
 
+//Ring buffer hooks; blob rings call these for ring:writefrom(sock) and ring:readto(sock).
+LUA_CFUNCTION_F luasockets_socket_mt___ringrecv(lua_State *L)
+{	//STACK: sock ring count? oob? ?
+	SOCKET sock;
+	luablob_ring *ring;
+	int flags = 0;
+	size_t count = 0;
+	int read;
+	size_t span;
+	void *data;
+
+	sock = *((SOCKET *)luaL_checkudata(L, 1, "luasockets_socket_mt"));
+	ring = luablob_checkring(L, 2);
+	if (!lua_isnoneornil(L, 3))
+	{
+		count = luablob_checksize(L, 3);
+		if (count == 0)
+		{
+			luaL_error(L, "count to read must be greater than 0");
+		}
+	}
+	if (lua_toboolean(L, 4))
+	{
+		flags |= MSG_OOB;
+	}
+
+	span = luablob_ring_writespan(ring, ((count == 0) ? 1 : count), &data);
+	if (span == 0)
+	{
+		luaL_error(L, "failed to allocate blob memory");
+	}
+	if (count == 0 || span < count)
+	{
+		count = span;
+	}
+
+	read = recv(sock, (char *)data, ((count > INT_MAX) ? INT_MAX : (int)count), flags);
+	if (read < 0)
+	{
+		luaerrorec(L, sockerr);
+	}
+	luablob_ring_produce(ring, (size_t)read);
+
+	lua_pushinteger(L, read);	//STACK: sock ring count? oob? ? read
+	return 1;					//RETURN: read
+}
+
+LUA_CFUNCTION_F luasockets_socket_mt___ringsend(lua_State *L)
+{	//STACK: sock ring count? oob? ?
+	SOCKET sock;
+	luablob_ring *ring;
+	int flags = 0;
+	size_t count;
+	size_t totalsent = 0;
+	size_t span;
+	int sent;
+	void *data;
+
+	sock = *((SOCKET *)luaL_checkudata(L, 1, "luasockets_socket_mt"));
+	ring = luablob_checkring(L, 2);
+	count = (lua_isnoneornil(L, 3) ? ((size_t)-1) : luablob_checksize(L, 3));
+	if (lua_toboolean(L, 4))
+	{
+		flags |= MSG_OOB;
+	}
+
+	while (totalsent < count)
+	{
+		span = luablob_ring_readspan(ring, &data);
+		if (span == 0)
+		{
+			break;
+		}
+		if (span > (count - totalsent))
+		{
+			span = (count - totalsent);
+		}
+		if (span > INT_MAX)
+		{
+			span = INT_MAX;
+		}
+
+		sent = send(sock, (const char *)data, (int)span, flags);
+		if (sent < 0)
+		{
+			luaerrorec(L, sockerr);
+		}
+		if (sent == 0)
+		{
+			break;
+		}
+		luablob_ring_consume(ring, (size_t)sent);
+		totalsent += sent;
+	}
+
+	lua_pushinteger(L, totalsent);	//STACK: sock ring count? oob? ? sent
+	return 1;						//RETURN: sent
+}
+
 LUA_CFUNCTION_F lua_sockets_close(lua_State *L)
 {	//STACK: sock ?
 	if (close(*((SOCKET *)luaL_checkudata(L, 1, "luasockets_socket_mt"))) != 0)
@@ -1488,6 +1748,8 @@ const luaL_Reg luasockets_addrinfo_mt_funcs[] =
 const luaL_Reg luasockts_socket_mt_funcs[] =
 {
 	{"__gc", &luasockets_socket_mt___gc},
+	{"__ringrecv", &luasockets_socket_mt___ringrecv},
+	{"__ringsend", &luasockets_socket_mt___ringsend},
 	{NULL, NULL}
 };
 
@@ -1561,15 +1823,15 @@ LUA_MODLOADER_F luaopen_sockets(lua_State *L)
 	lua_settable(L, LUA_REGISTRYINDEX);						//STACK: modname ?
 
 	lua_pushliteral(L, "luasockets_socket_mt");				//STACK: modname ? 'luasockets_socket_mt'
-	lua_createtable(L, 0, 3);								//STACK: modname ? 'luasockets_socket_mt' {~3}
+	lua_createtable(L, 0, 5);								//STACK: modname ? 'luasockets_socket_mt' {~5}
 	luaL_setfuncs(L, luasockts_socket_mt_funcs, 0);
-	lua_pushliteral(L, "__metatable");						//STACK: modname ? 'luasockets_socket_mt' {~3} '__metatable'
-	lua_pushliteral(L, "protected (luasockets socket)");	//STACK: modname ? 'luasockets_socket_mt' {~3} '__metatable' 'protected...'
-	lua_settable(L, -3);									//STACK: modname ? 'luasockets_socket_mt' {~3}
-	lua_pushliteral(L, "__index");							//STACK: modname ? 'luasockets_socket_mt' {~3} '__index'
-	lua_createtable(L, 0, 10);								//STACK: modname ? 'luasockets_socket_mt' {~3} '__index' {~4}
+	lua_pushliteral(L, "__metatable");						//STACK: modname ? 'luasockets_socket_mt' {~5} '__metatable'
+	lua_pushliteral(L, "protected (luasockets socket)");	//STACK: modname ? 'luasockets_socket_mt' {~5} '__metatable' 'protected...'
+	lua_settable(L, -3);									//STACK: modname ? 'luasockets_socket_mt' {~5}
+	lua_pushliteral(L, "__index");							//STACK: modname ? 'luasockets_socket_mt' {~5} '__index'
+	lua_createtable(L, 0, 10);								//STACK: modname ? 'luasockets_socket_mt' {~5} '__index' {~4}
 	luaL_setfuncs(L, luasockets_socket_mt____index_funcs, 0);
-	lua_settable(L, -3);									//STACK: modname ? 'luasockets_socket_mt' {~3}
+	lua_settable(L, -3);									//STACK: modname ? 'luasockets_socket_mt' {~5}
 	lua_settable(L, LUA_REGISTRYINDEX);						//STACK: modname ?
 
 	lua_createtable(L, 0, 5);								//STACK: modname ? {~5}